@@ -5,6 +5,10 @@
  *
  * @details CRC 16 and 32 support.
  *
+ * The 16 bit CRC is CRC-16/ARC and the 32 bit CRC is CRC-32, the same as
+ * boost::crc_16_type and boost::crc_32_type; both are computed with the
+ * CRCEngine.
+ *
  * @copyright University of Alberta 2021
  *
  * @license
@@ -15,8 +19,8 @@
 #define EX2_SDR_ERROR_CONTROL_CRC_H_
 
 #include <cstdint>
-#include <boost/crc.hpp>
 
+#include "crc_engine.hpp"
 #include "ppdu_u8.hpp"
 
 namespace ex2 {
@@ -33,6 +37,27 @@ namespace ex2 {
         CRC_32_BITS = 32
       };
 
+      /*!
+       * @brief Outcome of a CRC verification
+       */
+      enum crc_status_t
+      {
+        CRC_PASS = 0,     // the computed and received CRCs match
+        CRC_FAIL,         // they do not
+        CRC_TOO_SHORT,    // the data is shorter than the CRC
+        CRC_BAD_SIZE      // crcSize is not a crc_size_t value
+      };
+
+      /*!
+       * @brief Result of a CRC verification
+       */
+      struct crc_result_t
+      {
+        crc_status_t status;
+        uint32_t computed; // CRC of the data before the trailer
+        uint32_t received; // CRC in the trailer
+      };
+
       crc ();
       virtual
       ~crc ();
@@ -60,10 +85,107 @@ namespace ex2 {
        */
       void check(PPDU_u8 &pdu, crc_size_t crcSize);
 
+      /*!
+       * @brief Verify data that ends with the CRC that add() appends.
+       *
+       * @details Nothing is copied, allocated or thrown, so this is cheap
+       * enough for every received frame however many fail.
+       *
+       * @param[in] data The data followed by the CRC
+       * @param[in] length The number of bytes in @p data, CRC included
+       * @param[in] crcSize
+       * @return The status and, for CRC_PASS and CRC_FAIL, the computed and
+       * received CRCs
+       */
+      static crc_result_t verify(const uint8_t *data, size_t length,
+        crc_size_t crcSize) noexcept;
+
+      /*!
+       * @brief Incremental CRC of a payload that arrives in pieces.
+       *
+       * @details Update a context with each fragment as it arrives, in order.
+       * Fragments that arrive out of order can each be given their own
+       * context and the contexts combined in order once they are all in;
+       * neither way needs the payload to be contiguous or a second pass over
+       * the data. The CRC is the same as crc::add computes for the whole
+       * payload.
+       */
+      class Context
+      {
+      public:
+
+        /*!
+         * @brief Constructor, for an empty payload
+         *
+         * @param[in] crcSize
+         */
+        Context(crc_size_t crcSize);
+
+        /*!
+         * @brief Add the next bytes of the payload.
+         *
+         * @param[in] data The bytes
+         * @param[in] length The number of bytes in @p data
+         */
+        void update(const uint8_t *data, size_t length);
+
+        /*!
+         * @brief Add the next fragment of the payload.
+         *
+         * @param[in] fragment The fragment, 8 bits per symbol
+         */
+        void update(const PPDU_u8 &fragment);
+
+        /*!
+         * @brief Add a payload fragment whose CRC was computed on its own.
+         *
+         * @details This context then covers its payload followed by that of
+         * @p next. Only the two CRC registers and the length of @p next are
+         * used, so this is cheap for any fragment length.
+         *
+         * @param[in] next The context of the following fragment
+         * @throws std::runtime_error if the CRC sizes differ
+         */
+        void combine(const Context &next);
+
+        /*!
+         * @brief The CRC of the payload so far, as crc::add would compute it
+         */
+        uint32_t checksum() const;
+
+        /*!
+         * @brief Compare the CRC with a received trailer
+         *
+         * @param[in] trailer The crcSize / 8 bytes that crc::add appended to
+         * the payload
+         * @return True if they match
+         */
+        bool matches(const uint8_t *trailer) const;
+
+        /*!
+         * @brief The number of payload bytes so far
+         */
+        uint64_t length() const {
+          return m_length;
+        }
+
+      private:
+        crc_size_t m_crcSize;
+        uint32_t m_state;
+        uint64_t m_length;
+      };
+
     private:
 
-      boost::crc_16_type m_crc16Impl;
-      boost::crc_32_type m_crc32Impl;
+      /*!
+       * @brief The CRC of @p length bytes of @p data
+       */
+      static uint32_t syndrome(const uint8_t *data, size_t length, crc_size_t crcSize);
+
+      /*!
+       * @brief The CRC in a trailer appended by add(), in host byte order
+       */
+      static uint32_t trailerSyndrome(const uint8_t *trailer, crc_size_t crcSize);
 
       union dataSyndrome16_t {
         uint8_t lastBytes[2];
@@ -0,0 +1,409 @@
+/*!
+ * @file crc_engine.hpp
+ * @author Steven Knudsen
+ * @date June 23, 2021
+ *
+ * @details Table driven CRC engine for 16 and 32 bit CRCs.
+ *
+ * A CRC is defined as in the Rocksoft model by its width, polynomial
+ * (without the x^Width term), whether the bits of each byte are taken least
+ * significant first (reflected), the initial register value and the value
+ * XORed with the register to give the checksum.
+ *
+ * Short buffers are processed 8 bytes at a time with slicing-by-8 tables.
+ * Long buffers are folded 64 bytes at a time with carry-less multiplication
+ * (PCLMULQDQ) when the CPU has it, which reduces them to 16 bytes with the
+ * same remainder; those 16 bytes are then finished with the tables.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#ifndef EX2_SDR_ERROR_CONTROL_CRC_ENGINE_H_
+#define EX2_SDR_ERROR_CONTROL_CRC_ENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ex2 {
+  namespace sdr {
+
+    /*!
+     * @brief Constants for folding 16 byte blocks with carry-less
+     * multiplication.
+     *
+     * @details Each pair multiplies the low and high 64 bits of a block, as
+     * loaded by the folding kernel, to move it 512 or 128 bits further along
+     * the message.
+     */
+    struct CRCFoldConstants
+    {
+      uint64_t fold512[2];
+      uint64_t fold128[2];
+    };
+
+    /*!
+     * @brief Shortest buffer, in bytes, worth folding.
+     */
+    const size_t CRC_FOLD_MIN_LENGTH = 256;
+
+    /*!
+     * @brief Is the carry-less multiplication folding kernel usable?
+     *
+     * @return true if the CPU has PCLMULQDQ, false otherwise.
+     */
+    bool crcFoldAvailable();
+
+    /*!
+     * @brief Fold a message of 16 byte blocks down to one block with the same
+     * remainder modulo the CRC polynomial.
+     *
+     * @details Call only if crcFoldAvailable() is true.
+     *
+     * @param[in] constants The folding constants for the polynomial
+     * @param[in] reflected True if the bits of each byte are least
+     * significant first
+     * @param[in] first The first block, with the CRC register already added
+     * @param[in] data The following blocks
+     * @param[in] numBlocks The number of blocks in @p data
+     * @param[out] out 16 bytes, in message order
+     */
+    void crcFold(const CRCFoldConstants &constants, bool reflected,
+      const uint8_t *first, const uint8_t *data, size_t numBlocks, uint8_t *out);
+
+    /*!
+     * @brief CRC engine for one CRC definition.
+     *
+     * @tparam Width 16 or 32 bits
+     * @tparam Poly The generator polynomial, without the x^Width term
+     * @tparam Reflected True if the bits of each byte are least significant
+     * first
+     * @tparam Init The initial register value
+     * @tparam XorOut The value XORed with the register to give the checksum
+     */
+    template<uint32_t Width, uint32_t Poly, bool Reflected, uint32_t Init, uint32_t XorOut>
+    class CRCEngine
+    {
+      static_assert(Width == 16 || Width == 32, "CRCEngine supports 16 and 32 bit CRCs");
+
+    public:
+
+      typedef typename std::conditional<Width == 16, uint16_t, uint32_t>::type checksum_t;
+
+      /*!
+       * @brief The register value before any data
+       */
+      static const uint32_t INITIAL = Init;
+
+      /*!
+       * @brief Calculate the checksum of a buffer.
+       *
+       * @param[in] data The buffer
+       * @param[in] length The number of bytes in @p data
+       * @return The checksum
+       */
+      static checksum_t
+      compute(const uint8_t *data, size_t length)
+      {
+        return finish(update(INITIAL, data, length));
+      }
+
+      /*!
+       * @brief Run the CRC register over more data.
+       *
+       * @param[in] state The register after the preceding data, or INITIAL
+       * @param[in] data The buffer
+       * @param[in] length The number of bytes in @p data
+       * @return The register after @p data
+       */
+      static uint32_t
+      update(uint32_t state, const uint8_t *data, size_t length)
+      {
+        if (length >= CRC_FOLD_MIN_LENGTH && crcFoldAvailable()) {
+          // Adding the register to the first bytes makes it part of the
+          // message, so the folded block is finished from a zero register
+          uint8_t first[16];
+          memcpy(first, data, sizeof(first));
+          for (uint32_t i = 0; i < Width / 8; i++)
+            first[i] ^= Reflected ? state >> (8 * i) : state >> (Width - 8 - 8 * i);
+
+          size_t numBlocks = length / 16;
+          uint8_t folded[16];
+          crcFold(s_foldConstants, Reflected, first, data + 16, numBlocks - 1, folded);
+          state = slice(0, folded, sizeof(folded));
+          data += 16 * numBlocks;
+          length -= 16 * numBlocks;
+        }
+        return slice(state, data, length);
+      }
+
+      /*!
+       * @brief The checksum for a register value
+       */
+      static checksum_t
+      finish(uint32_t state)
+      {
+        return (checksum_t) (state ^ XorOut);
+      }
+
+      /*!
+       * @brief The register after @p length zero bytes.
+       *
+       * @details This multiplies the register by x^(8 length) modulo the
+       * polynomial, one multiplication per 1 bit of 8 length, without
+       * touching any data.
+       */
+      static uint32_t
+      shift(uint32_t state, uint64_t length)
+      {
+        uint64_t a = Reflected ? reflect(state, Width) : state;
+        uint64_t bits = length * 8;
+        for (uint32_t k = 0; bits != 0; k++, bits >>= 1)
+          if (bits & 1)
+            a = mulMod(a, s_powers.x2k[k]);
+        return (uint32_t) (Reflected ? reflect(a, Width) : a);
+      }
+
+      /*!
+       * @brief The register for two buffers, one after the other, from their
+       * registers alone.
+       *
+       * @details By linearity, running the register over B from stateA is
+       * running it over @p lengthB zeros from stateA plus over B from zero,
+       * and the latter is stateB less the run over the zeros from INITIAL.
+       *
+       * @param[in] stateA The register after buffer A, from INITIAL
+       * @param[in] stateB The register after buffer B, from INITIAL
+       * @param[in] lengthB The number of bytes in buffer B
+       * @return The register after A then B, from INITIAL
+       */
+      static uint32_t
+      combine(uint32_t stateA, uint32_t stateB, uint64_t lengthB)
+      {
+        return shift(stateA ^ INITIAL, lengthB) ^ stateB;
+      }
+
+    private:
+
+      static const uint32_t MASK = Width == 32 ? 0xffffffff : (1u << Width) - 1;
+
+      /*!
+       * @brief t[k][b] is the register after byte b and k zero bytes,
+       * starting from zero
+       */
+      struct Tables
+      {
+        uint32_t t[8][256];
+      };
+
+      static constexpr Tables
+      makeTables()
+      {
+        Tables tables {};
+        for (uint32_t b = 0; b < 256; b++) {
+          uint32_t r = 0;
+          if (Reflected) {
+            uint32_t poly = reflect(Poly, Width);
+            r = b;
+            for (uint32_t i = 0; i < 8; i++)
+              r = (r & 1) ? (r >> 1) ^ poly : r >> 1;
+          }
+          else {
+            r = b << (Width - 8);
+            for (uint32_t i = 0; i < 8; i++)
+              r = (r & (1u << (Width - 1))) ? ((r << 1) ^ Poly) & MASK : (r << 1) & MASK;
+          }
+          tables.t[0][b] = r;
+        }
+        for (uint32_t k = 1; k < 8; k++)
+          for (uint32_t b = 0; b < 256; b++) {
+            uint32_t r = tables.t[k - 1][b];
+            tables.t[k][b] = Reflected ?
+              tables.t[0][r & 0xff] ^ (r >> 8) :
+              tables.t[0][r >> (Width - 8)] ^ ((r << 8) & MASK);
+          }
+        return tables;
+      }
+
+      static constexpr uint64_t
+      reflect(uint64_t v, uint32_t bits)
+      {
+        uint64_t r = 0;
+        for (uint32_t i = 0; i < bits; i++)
+          if ((v >> i) & 1)
+            r |= (uint64_t) 1 << (bits - 1 - i);
+        return r;
+      }
+
+      /*!
+       * @brief x^n mod the polynomial, as a polynomial with bit i the
+       * coefficient of x^i
+       */
+      static constexpr uint64_t
+      xPowMod(uint32_t n)
+      {
+        uint64_t r = 1;
+        for (uint32_t i = 0; i < n; i++) {
+          r <<= 1;
+          if (r & ((uint64_t) 1 << Width))
+            r ^= ((uint64_t) 1 << Width) | Poly;
+        }
+        return r;
+      }
+
+      /*!
+       * @brief a b mod the polynomial, for a and b of degree less than Width
+       */
+      static constexpr uint64_t
+      mulMod(uint64_t a, uint64_t b)
+      {
+        uint64_t r = 0;
+        for (uint32_t i = Width; i-- > 0; ) {
+          r <<= 1;
+          if (r & ((uint64_t) 1 << Width))
+            r ^= ((uint64_t) 1 << Width) | Poly;
+          if ((b >> i) & 1)
+            r ^= a;
+        }
+        return r;
+      }
+
+      /*!
+       * @brief x2k[k] is x^(2^k) mod the polynomial
+       */
+      struct Powers
+      {
+        uint64_t x2k[64];
+      };
+
+      static constexpr Powers
+      makePowers()
+      {
+        Powers powers {};
+        powers.x2k[0] = xPowMod(1);
+        for (uint32_t k = 1; k < 64; k++)
+          powers.x2k[k] = mulMod(powers.x2k[k - 1], powers.x2k[k - 1]);
+        return powers;
+      }
+
+      /*!
+       * @brief The constant that moves a 64 bit half block x^n further along.
+       *
+       * @details The reflected kernel keeps the highest degree coefficient in
+       * bit 0; the product of two such 64 bit values lands one bit short of
+       * the 128 bit layout, which multiplies it by x, so the constant is
+       * x^(n-1) instead.
+       */
+      static constexpr uint64_t
+      foldConstant(uint32_t n)
+      {
+        return Reflected ? reflect(xPowMod(n - 1), 64) : xPowMod(n);
+      }
+
+      /*!
+       * @details The reflected kernel has the higher degree half of a block in
+       * its low 64 bits, the other kernel in its high 64 bits.
+       */
+      static constexpr CRCFoldConstants
+      makeFoldConstants()
+      {
+        return Reflected ?
+          CRCFoldConstants { { foldConstant(512 + 64), foldConstant(512) },
+                             { foldConstant(128 + 64), foldConstant(128) } } :
+          CRCFoldConstants { { foldConstant(512), foldConstant(512 + 64) },
+                             { foldConstant(128), foldConstant(128 + 64) } };
+      }
+
+      static constexpr Tables s_tables = makeTables();
+      static constexpr CRCFoldConstants s_foldConstants = makeFoldConstants();
+      static constexpr Powers s_powers = makePowers();
+
+      static inline uint32_t
+      load32(const uint8_t *p)
+      {
+        return Reflected ?
+          (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24) :
+          ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+      }
+
+      /*!
+       * @brief Slicing-by-8: the register after 8 bytes is the sum of the
+       * table entries for each byte and the zeros that follow it.
+       */
+      static uint32_t
+      slice(uint32_t state, const uint8_t *data, size_t length)
+      {
+        const uint32_t (*t)[256] = s_tables.t;
+        for (; length >= 8; data += 8, length -= 8) {
+          if (Reflected) {
+            uint32_t one = load32(data) ^ state;
+            uint32_t two = load32(data + 4);
+            state = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^
+                    t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+                    t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^
+                    t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+          }
+          else {
+            uint32_t one = load32(data) ^ (state << (32 - Width));
+            uint32_t two = load32(data + 4);
+            state = t[7][one >> 24] ^ t[6][(one >> 16) & 0xff] ^
+                    t[5][(one >> 8) & 0xff] ^ t[4][one & 0xff] ^
+                    t[3][two >> 24] ^ t[2][(two >> 16) & 0xff] ^
+                    t[1][(two >> 8) & 0xff] ^ t[0][two & 0xff];
+          }
+        }
+        for (; length > 0; data++, length--) {
+          state = Reflected ?
+            t[0][(state ^ *data) & 0xff] ^ (state >> 8) :
+            t[0][((state >> (Width - 8)) ^ *data) & 0xff] ^ ((state << 8) & MASK);
+        }
+        return state;
+      }
+
+    };
+
+    template<uint32_t Width, uint32_t Poly, bool Reflected, uint32_t Init, uint32_t XorOut>
+    constexpr typename CRCEngine<Width, Poly, Reflected, Init, XorOut>::Tables
+    CRCEngine<Width, Poly, Reflected, Init, XorOut>::s_tables;
+
+    template<uint32_t Width, uint32_t Poly, bool Reflected, uint32_t Init, uint32_t XorOut>
+    constexpr CRCFoldConstants
+    CRCEngine<Width, Poly, Reflected, Init, XorOut>::s_foldConstants;
+
+    template<uint32_t Width, uint32_t Poly, bool Reflected, uint32_t Init, uint32_t XorOut>
+    constexpr typename CRCEngine<Width, Poly, Reflected, Init, XorOut>::Powers
+    CRCEngine<Width, Poly, Reflected, Init, XorOut>::s_powers;
+
+    /*!
+     * @brief CRC-16/ARC, boost::crc_16_type
+     */
+    typedef CRCEngine<16, 0x8005, true, 0x0000, 0x0000> CRC16ARC;
+
+    /*!
+     * @brief CRC-16-CCITT as the AX.25 frame check sequence (CRC-16/X-25)
+     */
+    typedef CRCEngine<16, 0x1021, true, 0xffff, 0xffff> CRC16AX25;
+
+    /*!
+     * @brief CRC-16-CCITT as used by CCSDS (CRC-16/CCITT-FALSE)
+     */
+    typedef CRCEngine<16, 0x1021, false, 0xffff, 0x0000> CRC16CCSDS;
+
+    /*!
+     * @brief CRC-32 (IEEE 802.3), boost::crc_32_type
+     */
+    typedef CRCEngine<32, 0x04c11db7, true, 0xffffffff, 0xffffffff> CRC32;
+
+    /*!
+     * @brief CRC-32C (Castagnoli)
+     */
+    typedef CRCEngine<32, 0x1edc6f41, true, 0xffffffff, 0xffffffff> CRC32C;
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif /* EX2_SDR_ERROR_CONTROL_CRC_ENGINE_H_ */
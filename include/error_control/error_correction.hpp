@@ -64,9 +64,9 @@ namespace ex2 {
         CCSDS_TURBO_8920_R_1_3              = 0x001E, // CCSDS Turbo coding k=8920 rate 1/3
         CCSDS_TURBO_8920_R_1_4              = 0x001F, // CCSDS Turbo coding k=8920 rate 1/4
         CCSDS_TURBO_8920_R_1_6              = 0x0020, // CCSDS Turbo coding k=8920 rate 1/6
-        CCSDS_LDPC_ORANGE_BOOK_1280         = 0x0021, // CCSDS Orange Book LDPC n=1280
-        CCSDS_LDPC_ORANGE_BOOK_1356         = 0x0022, // CCSDS Orange Book LDPC n=1356
-        CCSDS_LDPC_ORANGE_BOOK_2048         = 0x0023, // CCSDS Orange Book LDPC n=2048
+        CCSDS_LDPC_ORANGE_BOOK_1280         = 0x0021, // CCSDS AR4JA LDPC k=1024 n=1280 rate 4/5
+        CCSDS_LDPC_ORANGE_BOOK_1536         = 0x0022, // CCSDS AR4JA LDPC k=1024 n=1536 rate 2/3
+        CCSDS_LDPC_ORANGE_BOOK_2048         = 0x0023, // CCSDS AR4JA LDPC k=1024 n=2048 rate 1/2
         IEEE_802_11N_QCLDPC_648_R_1_2       = 0x0024, // IEEE 802.11n QC-LDPC n=648 rate 1/2
         IEEE_802_11N_QCLDPC_648_R_2_3       = 0x0025, // IEEE 802.11n QC-LDPC n=648 rate 2/3
         IEEE_802_11N_QCLDPC_648_R_3_4       = 0x0026, // IEEE 802.11n QC-LDPC n=648 rate 3/4
@@ -81,7 +81,10 @@ namespace ex2 {
         IEEE_802_11N_QCLDPC_1944_R_5_6      = 0x002F, // IEEE 802.11n QC-LDPC n=1944 rate 5/6
         LAST                                = 0x0030,
 
-        NO_FEC                              = 0x003F // No FEC
+        NO_FEC                              = 0x003F, // No FEC
+
+        // Former name of CCSDS_LDPC_ORANGE_BOOK_1536; there is no n=1356 code
+        CCSDS_LDPC_ORANGE_BOOK_1356 [[deprecated("use CCSDS_LDPC_ORANGE_BOOK_1536")]] = CCSDS_LDPC_ORANGE_BOOK_1536
       };
 
       static const std::string ErrorCorrectionName(ErrorCorrectionScheme ecScheme);
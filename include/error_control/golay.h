@@ -38,7 +38,8 @@
 uint32_t golay_encode(uint16_t w);
 
 /* return a mask showing the bits which are in error in a received
- * 24-bit codeword, or -1 if 4 errors were detected.
+ * 24-bit codeword, or -1 if 4 errors were detected. Bits above the 24th
+ * are ignored.
  */
 int32_t golay_errors(uint32_t codeword);
 
@@ -48,4 +49,40 @@ int32_t golay_errors(uint32_t codeword);
 */
 int16_t golay_decode(uint32_t w);
 
+/* maximum likelihood decoding of a codeword received as soft BPSK samples,
+ * one per bit, most significant (first transmitted) bit first; a positive
+ * sample favours a 1, and the magnitude is its reliability. The codeword
+ * with the largest correlation with the samples is chosen from all 4096,
+ * so this always returns a 12-bit data word, even where golay_decode would
+ * detect 4 errors in the hard decisions.
+ */
+uint16_t golay_decode_soft(const float *samples);
+
+/* Bulk encoding and decoding of byte buffers.
+ *
+ * The 12-bit data words are packed two to three bytes, most significant bit
+ * first: bytes b0 b1 b2 hold the words b0<<4 | b1>>4 and (b1&0xf)<<8 | b2.
+ * An odd last word takes two bytes, the low 4 bits of the second being 0.
+ * A data buffer of num_words words is therefore (3*num_words+1)/2 bytes.
+ *
+ * Each 24-bit codeword takes three bytes, most significant byte first, so a
+ * codeword buffer is 3*num_words bytes.
+ *
+ * Where the CPU supports it, eight words at a time are done with SIMD
+ * instructions.
+ */
+
+/* encodes num_words packed 12-bit data words to num_words codewords
+ */
+void golay_encode_bulk(const uint8_t *data, uint32_t num_words,
+    uint8_t *codewords);
+
+/* decodes num_words received codewords to num_words packed 12-bit data
+ * words, correcting up to 3 errors in each. A word with 4 errors detected
+ * is left as the received data bits. Returns the number of such
+ * uncorrectable words.
+ */
+uint32_t golay_decode_bulk(const uint8_t *codewords, uint32_t num_words,
+    uint8_t *data);
+
 #endif // EX2_SDR__GOLAY_H__
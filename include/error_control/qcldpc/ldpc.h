@@ -14,11 +14,17 @@
 #ifndef EX2_SDR_ERROR_CONTROL_QCLDPC_QCLDPC_H_
 #define EX2_SDR_ERROR_CONTROL_QCLDPC_QCLDPC_H_
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
 #include <eigen3/Eigen/Sparse>
 
 #include "../../phy_layer/pdu/ppdu_f.hpp"
 #include "../../phy_layer/pdu/ppdu_u8.hpp"
+#include "ldpc_code.h"
 #include "parity_check.h"
+#include "tanner_graph.h"
 
 namespace ex2
 {
@@ -32,12 +38,188 @@ namespace ex2
     public:
 
       static const uint32_t DECODE_ITERATIONS_DEFAULT = 12;
+
+      /*!
+       * @brief Iterations without progress before a codeword is given up on;
+       * 0 disables the stall check.
+       */
+      static const uint32_t DECODE_STALL_ITERATIONS_DEFAULT = 0;
+
+      /*!
+       * @brief Codewords handed to a @p decodeParallel worker at a time.
+       * A multiple of the widest interleaved kernel's frameLanes.
+       */
+      static constexpr uint32_t DECODE_BLOCK_CODEWORDS = 32;
+
+      /*!
+       * @brief The decoding algorithms that may be selected.
+       *
+       * @details
+       *   PROBABILITY_DOMAIN_BP is the original sum-product belief propagation
+       *     decoder working on bit probabilities.
+       *   NORMALIZED_MIN_SUM is the LLR-domain min-sum decoder with check node
+       *     magnitudes scaled by the normalization factor.
+       *   OFFSET_MIN_SUM is the LLR-domain min-sum decoder with the offset
+       *     subtracted from check node magnitudes (floored at zero).
+       *   FIXED_POINT_MIN_SUM is a layered offset min-sum decoder on 8 bit
+       *     LLRs that processes the Z check nodes of a layer in parallel using
+       *     the SIMD kernels in ldpc_kernel.h. It ignores the decode schedule.
+       *   INTERLEAVED_MIN_SUM gives each codeword the same result as
+       *     FIXED_POINT_MIN_SUM, but decodes 16 or 32 codewords at once, one
+       *     per SIMD lane, which keeps every lane busy whatever Z is. Decoded
+       *     codewords are frozen while the rest of the group carries on.
+       */
+      enum class DecodeAlgorithm : uint16_t {
+        PROBABILITY_DOMAIN_BP = 0x0000,
+        NORMALIZED_MIN_SUM    = 0x0001,
+        OFFSET_MIN_SUM        = 0x0002,
+        FIXED_POINT_MIN_SUM   = 0x0003,
+        INTERLEAVED_MIN_SUM   = 0x0004
+      };
+
+      /*!
+       * @brief The order in which the min-sum decoders update check nodes.
+       *
+       * @details
+       *   FLOODING updates every check node from the a-posteriori LLRs of the
+       *     previous iteration, then every symbol node.
+       *   LAYERED walks the prototype matrix one block row (layer) of Z check
+       *     nodes at a time and updates the a-posteriori LLRs as soon as each
+       *     check node is done, so later layers in the same iteration already
+       *     see the new information. It typically needs about half the
+       *     iterations of FLOODING.
+       *
+       * The schedule applies to NORMALIZED_MIN_SUM and OFFSET_MIN_SUM;
+       * PROBABILITY_DOMAIN_BP always floods.
+       */
+      enum class DecodeSchedule : uint16_t {
+        FLOODING = 0x0000,
+        LAYERED  = 0x0001
+      };
+
+      static constexpr float MIN_SUM_NORMALIZATION_DEFAULT = 0.75f;
+      static constexpr float MIN_SUM_OFFSET_DEFAULT = 0.5f;
+
+      /*!
+       * @brief Fixed point LLR steps per unit LLR used by FIXED_POINT_MIN_SUM.
+       * LLRs are saturated to +/-127 steps.
+       */
+      static constexpr float FIXED_POINT_LLR_SCALE = 4.0f;
+
+      /*!
+       * @brief Scratch buffers for the decoders.
+       *
+       * @details Each decoder keeps its messages and hard decisions here
+       * rather than allocating them per call. A workspace grows to fit the
+       * first codes and algorithms it is used with and then stays that size,
+       * so once it has been used (or given to @p prepareWorkspace) decoding
+       * with it does no heap allocation. A workspace may move between LDPC
+       * objects and threads, but only one decode may use it at a time.
+       */
+      class DecoderWorkspace
+      {
+      public:
+        DecoderWorkspace () {}
+
+        /*!
+         * @brief Make a workspace sized for the algorithm @p ldpc currently
+         * has selected.
+         */
+        explicit DecoderWorkspace (const LDPC &ldpc);
+
+      private:
+        friend class LDPC;
+
+        // Floating point decoders
+        std::vector<float> m_channelLLR;
+        std::vector<float> m_posteriorLLR;
+        std::vector<float> m_min1;
+        std::vector<float> m_min2;
+        std::vector<uint32_t> m_min1Index;
+        std::vector<uint8_t> m_signProduct;
+        std::vector<uint8_t> m_edgeSign;
+        std::vector<float> m_q;
+        std::vector<uint32_t> m_symbol;
+        std::vector<uint8_t> m_dHat;
+        std::vector<uint8_t> m_syndrome;
+
+        // Probability domain decoder
+        std::vector<double> m_r;
+        std::vector<double> m_f0;
+        std::vector<double> m_f1;
+        std::vector<double> m_Q0;
+        std::vector<double> m_Q1;
+        std::vector<double> m_deltaQ;
+        std::vector<double> m_R0;
+        std::vector<double> m_R1;
+
+        // Fixed point decoders; see ldpc_kernel.h
+        std::vector<int8_t> m_posterior;
+        std::vector<int8_t> m_messages;
+        std::vector<int8_t> m_scratch;
+        std::vector<int8_t> m_channel;
+        std::vector<int8_t> m_active;
+        std::vector<uint16_t> m_unsatisfied;
+        std::vector<uint32_t> m_best;
+        std::vector<uint32_t> m_stalled;
+
+        // decodeShortened; the full codewords it hands to the decoders
+        std::vector<float> m_fullCodewords;
+        std::vector<uint8_t> m_fullMessages;
+      };
+
+      /*!
+       * @brief LLR magnitude given to the decoders for the shortened bits,
+       * which are known to be zero. It is large enough to saturate every
+       * decoder, but finite so that min-sum never subtracts infinities.
+       */
+      static constexpr float KNOWN_BIT_LLR = 100.0f;
+
+      /*!
+       * @brief How a message of any length is carried by whole codewords
+       *
+       * @details The message needs numCodewords codewords. Instead of zero
+       * padding the last one and sending the padding, the
+       * @p shortenedBits padding bits are spread as evenly as possible
+       * over all the codewords. Each codeword carries its share of message
+       * bits followed by its share of known zeros. The zeros are not
+       * transmitted; the decoder is told they are zero with certainty.
+       * Optionally, @p puncturedBits parity bits are also not transmitted,
+       * spread the same way and taken from the end of each codeword; the
+       * decoder treats them as erasures. This follows the 802.11n LDPC
+       * shortening and puncturing rules. Codes that puncture symbols
+       * themselves, the CCSDS AR4JA codes, never send their last
+       * @p codePuncturedBits symbols either; @p puncturedBits come from
+       * just before them.
+       *
+       * Codeword c transmits m_k - shortened(c) message bits and then
+       * m_n - m_k - punctured(c) parity bits.
+       */
+      struct RateMatching
+      {
+        uint32_t messageBits;
+        uint32_t numCodewords;
+        uint32_t shortenedBits;
+        uint32_t puncturedBits;
+        uint32_t codePuncturedBits; // per codeword
+        uint32_t transmittedBits;
+
+        uint32_t shortened(uint32_t codeword) const {
+          return shortenedBits / numCodewords + (codeword < shortenedBits % numCodewords ? 1 : 0);
+        }
+
+        uint32_t punctured(uint32_t codeword) const {
+          return codePuncturedBits + puncturedBits / numCodewords +
+              (codeword < puncturedBits % numCodewords ? 1 : 0);
+        }
+      };
+
       /*!
        * @brief Constructor
        *
        * @param[in] testMode If true, the encoder doesn't encode, it just returns
-       * @param[in] errorCorrectionCoding An IEEE 802.11n LDPC codeword size
-       * @param[in] codingRate An IEEE 802.11n LDPC rate
+       * @param[in] ecScheme An IEEE 802.11n QC-LDPC or CCSDS AR4JA LDPC error
+       * correction scheme
        * @param[in] decodeIterations The number of iterations to use for decoding
        * the input data padded out to the codeword size
        *
@@ -47,8 +229,21 @@ namespace ex2
        */
       LDPC (
         bool testMode = false,
-        ErrorCorrection::ErrorCorrectionCoding errorCorrectionCoding = ErrorCorrection::ErrorCorrectionCoding::LDPC_IEEE_1944,
-        ErrorCorrection::CodingRate codingRate = ErrorCorrection::CodingRate::RATE_1_2,
+        ErrorCorrection::ErrorCorrectionScheme ecScheme = ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_1_2,
+        uint32_t decodeIterations = DECODE_ITERATIONS_DEFAULT);
+
+      /*!
+       * @brief Constructor for a code that did not come from
+       * LDPCCode::get, e.g., one read by LDPCCode::load
+       *
+       * @param[in] code The code to use
+       * @param[in] testMode If true, the encoder doesn't encode, it just returns
+       * the input data padded out to the codeword size
+       * @param[in] decodeIterations The number of iterations to use for decoding
+       */
+      LDPC (
+        std::shared_ptr<const LDPCCode> code,
+        bool testMode = false,
         uint32_t decodeIterations = DECODE_ITERATIONS_DEFAULT);
 
       virtual
@@ -59,7 +254,11 @@ namespace ex2
        *
        * @details The implementation is based on Richardson, T., Urbanke, R.,
        * "Efficient Encoding of Low-Density Parity-Check Codes". IEEE Trans.
-       * on Information Theory, Feb. 2001
+       * on Information Theory, Feb. 2001. Codes without the 802.11n parity
+       * structure are encoded as by @p encodeQC.
+       *
+       * The codewords include any punctured symbols; see
+       * @p encodeShortened for what is transmitted.
        *
        * @param[in] inPDU
        * @return The encoded PDU
@@ -71,16 +270,112 @@ namespace ex2
        *
        * @details The implementation is based on Richardson, T., Urbanke, R.,
        * "Efficient Encoding of Low-Density Parity-Check Codes". IEEE Trans.
-       * on Information Theory, Feb. 2001
+       * on Information Theory, Feb. 2001. Codes without the 802.11n parity
+       * structure are encoded as by @p encodeQC.
+       *
+       * The codewords include any punctured symbols; see
+       * @p encodeShortened for what is transmitted.
        *
        * @param[in] inPDU
        * @return The encoded PDU
        */
       const PPDU_u8 encodeSparse(PPDU_u8 &inPDU);
 
+      /*!
+       * @brief Encode the input PDU in GF(2) using the quasi-cyclic structure
+       *
+       * @details Works on 64 bit words of packed bits rather than on one bit
+       * per double. Each block row's parity is the XOR of the message's Z bit
+       * blocks, cyclically rotated by the prototype matrix shifts. The 802.11n
+       * parity part of the prototype matrix is dual-diagonal apart from its
+       * first block column, so the XOR of all block rows gives the first
+       * parity block and the others follow by back-substitution, one block
+       * row at a time. Codes without that structure, such as the CCSDS AR4JA
+       * codes, multiply the message by the systematic generator inv(P) Q
+       * instead, where H = [Q P], one XOR of packed parity words per message
+       * bit set.
+       *
+       * The codewords are the same as those of @p encode and
+       * @p encodeSparse, message then parity bits, but packed.
+       *
+       * @param[in] inPDU The message bits, repacked to BPSymb_8 if need be.
+       * If not a multiple of the message length it is zero padded.
+       * @return The encoded PDU, packed (BPSymb_8), most significant bit first
+       */
+      const PPDU_u8 encodeQC(PPDU_u8 &inPDU);
+
+      /*!
+       * @brief The codeword layout for a message of @p messageBits bits.
+       *
+       * @details The sender and receiver must agree on the message length;
+       * for a MAC frame it follows from the user packet length in the
+       * MPDUHeader, in bytes, times 8.
+       *
+       * @param[in] messageBits The message length in bits; at least 1
+       * @param[in] puncturedBits The number of parity bits, over all the
+       * codewords, not to transmit
+       * @return The layout; see RateMatching
+       * @throws LDPCException If @p messageBits is 0 or @p puncturedBits
+       * would leave a codeword without parity bits.
+       */
+      RateMatching rateMatching(uint32_t messageBits, uint32_t puncturedBits = 0) const;
+
+      /*!
+       * @brief Encode a message of any length without transmitting padding
+       *
+       * @details The message is laid out as given by @p rateMatching and
+       * encoded with @p encodeQC; the shortened and punctured bits are
+       * then dropped. A message a little longer than a whole number of
+       * codewords no longer costs most of a codeword of zeros.
+       *
+       * @param[in] inPDU The message bits, repacked to BPSymb_1 if need be.
+       * Every bit is message; nothing is assumed to be padding.
+       * @param[in] puncturedBits The number of parity bits not to transmit,
+       * besides any the code itself punctures
+       * @return The rateMatching(...).transmittedBits transmitted bits, one
+       * per byte (BPSymb_1), codeword by codeword
+       * @throws LDPCException See @p rateMatching
+       */
+      const PPDU_u8 encodeShortened(PPDU_u8 &inPDU, uint32_t puncturedBits = 0);
+
+      /*!
+       * @brief Decode a message sent by @p encodeShortened
+       *
+       * @details The full codewords are rebuilt, with the shortened bits
+       * given the LLR KNOWN_BIT_LLR and the punctured bits an LLR of 0,
+       * and decoded as by @p decode.
+       *
+       * @param[in] encodedPayload The transmitted samples
+       * @param[in] snrEstimate The estimated signal to noise ratio for the encoded
+       * payload
+       * @param[in] messageBits The message length in bits
+       * @param[in] puncturedBits The number of parity bits not transmitted
+       * @param[out] decodedPayload The @p messageBits decoded message bits
+       * @return The number of bit errors in the decoded codewords. If 0, the
+       * payload was properly decoded.
+       * @throws LDPCException If @p encodedPayload is not the length
+       * @p rateMatching gives.
+       */
+      uint32_t decodeShortened(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+          uint32_t messageBits, uint32_t puncturedBits,
+          PPDU_u8::payload_t& decodedPayload);
+
+      /*!
+       * @brief Decode a message sent by @p encodeShortened using the
+       * caller's scratch buffers
+       *
+       * @details See @p decodeShortened and @p decode.
+       */
+      uint32_t decodeShortened(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+          uint32_t messageBits, uint32_t puncturedBits,
+          PPDU_u8::payload_t& decodedPayload, DecoderWorkspace &workspace);
+
       /*!
        * @brief Decode the input PDU
        *
+       * @details The algorithm used is the one selected by
+       * @p setDecodeAlgorithm, belief propagation by default.
+       *
        * @param[in] encodedPayload The encoded payload
        * @param[in] snrEstimate The estimated signal to noise ratio for the encoded
        * payload
@@ -91,6 +386,138 @@ namespace ex2
       uint32_t decode(PPDU_f::payload_t& encodedPayload, float snrEstimate,
           PPDU_u8::payload_t& decodedPayload);
 
+      /*!
+       * @brief Decode the input PDU using the caller's scratch buffers
+       *
+       * @details As @p decode, but with the buffers in @p workspace instead
+       * of the LDPC object's own. Once @p workspace and @p decodedPayload
+       * are big enough, no memory is allocated.
+       *
+       * @param[in] encodedPayload The encoded payload
+       * @param[in] snrEstimate The estimated signal to noise ratio for the encoded
+       * payload
+       * @param[out] decodedPayload The decoded payload
+       * @param[in,out] workspace The decoder scratch buffers
+       * @return The number of bit errors in the decoded payload. If 0, the
+       * payload was properly decoded.
+       */
+      uint32_t decode(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+          PPDU_u8::payload_t& decodedPayload, DecoderWorkspace &workspace);
+
+      /*!
+       * @brief Decode the input PDU and also return the a-posteriori LLRs
+       *
+       * @details As @p decode, but the decoder's final a-posteriori LLR of
+       * every codeword bit, message and parity, is written to
+       * @p posteriorLLRs so that it can be passed on to an outer decoder or
+       * used as a reliability measure. The LLRs are log(P(0)/P(1)), so a
+       * negative LLR is a 1 bit, on the same scale as the channel LLRs
+       * -2r/sigma^2. For FIXED_POINT_MIN_SUM and INTERLEAVED_MIN_SUM they
+       * are the 8 bit values scaled back, so they saturate at
+       * +/-127 / FIXED_POINT_LLR_SCALE.
+       *
+       * @param[in] encodedPayload The encoded payload
+       * @param[in] snrEstimate The estimated signal to noise ratio for the encoded
+       * payload
+       * @param[out] decodedPayload The decoded payload
+       * @param[out] posteriorLLRs Caller's buffer of at least
+       * encodedPayload.size() floats; LLR i is for encoded sample i
+       * @return The number of bit errors in the decoded payload. If 0, the
+       * payload was properly decoded.
+       */
+      uint32_t decodeSoft(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+          PPDU_u8::payload_t& decodedPayload, float *posteriorLLRs);
+
+      /*!
+       * @brief Decode the input PDU and also return the a-posteriori LLRs,
+       * using the caller's scratch buffers
+       *
+       * @details See @p decodeSoft and @p decode.
+       */
+      uint32_t decodeSoft(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+          PPDU_u8::payload_t& decodedPayload, float *posteriorLLRs,
+          DecoderWorkspace &workspace);
+
+      /*!
+       * @brief Decode the input PDU using a pool of worker threads
+       *
+       * @details The codewords are independent, so blocks of
+       * @p DECODE_BLOCK_CODEWORDS of them are handed out to
+       * @p getDecodeThreads() workers. Each worker uses its own scratch
+       * buffers and writes each block straight into its place in
+       * @p decodedPayload, so the output is the same as for @p decode.
+       *
+       * @param[in] encodedPayload The encoded payload
+       * @param[in] snrEstimate The estimated signal to noise ratio for the encoded
+       * payload
+       * @param[out] decodedPayload The decoded payload
+       * @return The number of bit errors in the decoded payload. If 0, the
+       * payload was properly decoded.
+       */
+      uint32_t decodeParallel(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+          PPDU_u8::payload_t& decodedPayload);
+
+      /*!
+       * @brief Decode a batch of input PDUs
+       *
+       * @details Equivalent to calling @p decode on each payload in turn, but
+       * with INTERLEAVED_MIN_SUM the codewords of all payloads share the SIMD
+       * lanes, so many short payloads decode as fast as one long one. The
+       * iteration statistics cover the whole batch.
+       *
+       * @param[in] encodedPayloads The @p numPayloads encoded payloads
+       * @param[in] numPayloads The number of payloads
+       * @param[in] snrEstimate The estimated signal to noise ratio for the encoded
+       * payloads
+       * @param[out] decodedPayloads The @p numPayloads decoded payloads
+       * @return The number of bit errors in all decoded payloads. If 0, the
+       * payloads were properly decoded.
+       */
+      uint32_t decodeBatch(const PPDU_f::payload_t *encodedPayloads,
+          uint32_t numPayloads, float snrEstimate,
+          PPDU_u8::payload_t *decodedPayloads);
+
+      /*!
+       * @brief Decode a batch of input PDUs using the caller's scratch
+       * buffers
+       *
+       * @details See @p decodeBatch and @p decode.
+       */
+      uint32_t decodeBatch(const PPDU_f::payload_t *encodedPayloads,
+          uint32_t numPayloads, float snrEstimate,
+          PPDU_u8::payload_t *decodedPayloads, DecoderWorkspace &workspace);
+
+      /*!
+       * @brief Size @p workspace for the selected decode algorithm, so that
+       * the first decode with it does not allocate either.
+       *
+       * @param[in,out] workspace The decoder scratch buffers
+       */
+      void prepareWorkspace(DecoderWorkspace &workspace) const;
+
+      /*!
+       * @brief Number of worker threads used by @p decodeParallel
+       * @return The number of threads; 0 means one per hardware thread
+       */
+      uint32_t
+      getDecodeThreads () const
+      {
+        return m_decodeThreads;
+      }
+
+      /*!
+       * @brief Set the number of worker threads used by @p decodeParallel
+       *
+       * @param[in] decodeThreads Number of threads; 0 means one per hardware
+       * thread
+       */
+      void
+      setDecodeThreads (
+        uint32_t decodeThreads)
+      {
+        m_decodeThreads = decodeThreads;
+      }
+
       /*!
        * @brief Decode the input PDU using the logarithmic algorithm
        *
@@ -117,12 +544,167 @@ namespace ex2
        * @brief Set the number of decode iterations.
        *
        * @details If @p decodeIterations is zero, the number of decode iterations is set to @p DECODE_ITERATIONS_DEFAULT.
+       * Safe to call from another thread while decoding; a decode already
+       * running keeps the limit it started with.
        * @param[in] decodeIterations Number of decode iterations
        */
       void
       setDecodeIterations (
         uint32_t decodeIterations);
 
+      /*!
+       * @brief Decode time budget accessor
+       * @return The wall-clock time each decode call may take; 0 if there is
+       * no time limit
+       */
+      std::chrono::microseconds
+      getDecodeTimeBudget () const
+      {
+        return std::chrono::microseconds(m_decodeTimeBudget.load());
+      }
+
+      /*!
+       * @brief Give every decode call a wall-clock time budget.
+       *
+       * @details Each call to decode, decodeShortened, decodeSoft,
+       * decodeParallel or decodeBatch then aims to finish within
+       * @p budget. Codewords are decoded in order, and each may use an
+       * equal share of the time left for the codewords not started yet
+       * (times the number of workers for @p decodeParallel), still
+       * limited by the decode iterations. A codeword that decodes early
+       * leaves its time to the codewords after it, so hard codewords get
+       * more iterations than easy ones. A codeword whose time runs out
+       * stops with its current hard decisions, and is counted by
+       * @p getExpiredCodewords; it always gets at least one iteration, so a
+       * budget too small for the payload is overrun by one iteration per
+       * codeword.
+       *
+       * Safe to call from another thread while decoding; a decode already
+       * running keeps the budget it started with.
+       *
+       * @param[in] budget The time per call; 0 turns the limit off
+       */
+      void
+      setDecodeTimeBudget (
+        std::chrono::microseconds budget)
+      {
+        m_decodeTimeBudget = budget.count() > 0 ? budget.count() : 0;
+      }
+
+      /*!
+       * @brief Codewords stopped by the time budget in the most recent
+       * decode call.
+       */
+      uint32_t
+      getExpiredCodewords () const
+      {
+        return m_decodedExpired;
+      }
+
+      /*!
+       * @brief Stall iterations accessor
+       * @return The stall iterations; 0 if the stall check is off
+       */
+      uint32_t
+      getStallIterations () const
+      {
+        return m_stallIterations;
+      }
+
+      /*!
+       * @brief Stop decoding a codeword early once it stops making progress.
+       *
+       * @details Decoding stops when the number of unsatisfied check nodes
+       * has not gone below its smallest value so far for @p stallIterations
+       * iterations in a row. Frames that cannot be decoded at low SNR then
+       * give up after a few iterations instead of running to the iteration
+       * limit. The price is a slightly higher frame error rate near the
+       * waterfall, where a decoder sometimes recovers after a plateau.
+       *
+       * @param[in] stallIterations Iterations without progress; 0 turns the
+       * check off
+       */
+      void
+      setStallIterations (
+        uint32_t stallIterations)
+      {
+        m_stallIterations = stallIterations;
+      }
+
+      /*!
+       * @brief Decode algorithm accessor
+       * @return The algorithm used by @p decode
+       */
+      DecodeAlgorithm
+      getDecodeAlgorithm () const
+      {
+        return m_decodeAlgorithm;
+      }
+
+      /*!
+       * @brief Select the algorithm used by @p decode
+       *
+       * @param[in] decodeAlgorithm The decode algorithm
+       */
+      void
+      setDecodeAlgorithm (
+        DecodeAlgorithm decodeAlgorithm)
+      {
+        m_decodeAlgorithm = decodeAlgorithm;
+      }
+
+      /*!
+       * @brief Decode schedule accessor
+       * @return The check node schedule used by the min-sum decoders
+       */
+      DecodeSchedule
+      getDecodeSchedule () const
+      {
+        return m_decodeSchedule;
+      }
+
+      /*!
+       * @brief Select the check node schedule used by the min-sum decoders
+       *
+       * @param[in] decodeSchedule The decode schedule
+       */
+      void
+      setDecodeSchedule (
+        DecodeSchedule decodeSchedule)
+      {
+        m_decodeSchedule = decodeSchedule;
+      }
+
+      /*!
+       * @brief Average number of iterations per codeword used by the most
+       * recent call to @p decode
+       *
+       * @details Decoding a codeword stops early once all parity checks are
+       * satisfied, so this is at most the number of decode iterations.
+       *
+       * @return The average iterations per codeword, or 0 if nothing has been
+       * decoded.
+       */
+      double
+      getAverageIterations () const
+      {
+        return m_decodedCodewords == 0 ? 0.0 :
+            (double) m_decodedIterations / m_decodedCodewords;
+      }
+
+      /*!
+       * @brief Set the min-sum check node correction factors.
+       *
+       * @param[in] normalization Scale applied to check node magnitudes by the
+       * normalized min-sum decoder, in (0, 1]
+       * @param[in] offset LLR offset subtracted from check node magnitudes by the
+       * offset min-sum decoder, >= 0
+       */
+      void
+      setMinSumCorrection (
+        float normalization,
+        float offset);
+
       /*!
        * @brief Parity Check matrix accessor
        *
@@ -134,6 +716,10 @@ namespace ex2
         return m_k;
       }
 
+      /*!
+       * @brief The codeword length, including any punctured symbols; see
+       * LDPCCode::getPuncturedLength
+       */
       uint32_t getCodewordLength() const {
         return m_n;
       }
@@ -142,43 +728,186 @@ namespace ex2
 
       bool m_testMode;
 
-      ErrorCorrection::ErrorCorrectionCoding m_ECCoding;
-      ErrorCorrection::CodingRate m_codingRate;
+      // The code's structures, shared with every other LDPC object using
+      // the same scheme; see LDPCCode
+      std::shared_ptr<const LDPCCode> m_code;
+
+      ErrorCorrection::ErrorCorrectionScheme m_ECScheme;
 
       uint32_t m_k; // message length
       uint32_t m_n; // codeword length
 
-      ParityCheck * m_pchk;
-      Eigen::MatrixXi m_parityCheckMatrix;
-      Eigen::SparseMatrix<int> m_parityCheckMatrixSparse;
-
-      // Dense matrices needed for encoding
-      Eigen::MatrixXd m_A, m_B, m_EinvTA_C, m_invTA, m_invTB;
+      // Encoder scratch
       Eigen::VectorXd m_p1, m_p2;//, m_msg;
-      // Sparse matrices needed for encoding
-      Eigen::SparseMatrix<double> m_sA, m_sB, m_sEinvTA_C, m_sinvTA, m_sinvTB;
       Eigen::SparseVector<double> m_sp1, m_sp2;
 
-      // Matrices needed for decoding
-      // M(j) represents the set of indexes of all the children parity check nodes
-      // connected to the symbol node d(j)
-      Eigen::MatrixXi m_M;
-      Eigen::VectorXi m_M_numCheckNodes;
-      // N(i) represents the set of indexes of all the parent symbol nodes connected
-      // to the parity check node h(i)
-      Eigen::MatrixXi m_N;
-      Eigen::VectorXi m_N_numSymbolNodes;
+      // encode and encodeSparse for codes without the dual-diagonal
+      // structure; @p message is numCodewords zero padded messages
+      const PPDU_u8 m_encodeGenerator(const PDU<uint8_t>::payload_t &message,
+          uint32_t numCodewords);
 
       /*!
-       * The number of LDPC decoder iterations
+       * The number of LDPC decoder iterations, and the time budget in
+       * microseconds. Atomic so that they can be changed while another
+       * thread decodes; see DecodeBudget.
        */
-      uint32_t m_decodeIterations;
+      std::atomic<uint32_t> m_decodeIterations;
+      std::atomic<uint32_t> m_stallIterations;
+      std::atomic<int64_t> m_decodeTimeBudget;
+
+      DecodeAlgorithm m_decodeAlgorithm;
+      DecodeSchedule m_decodeSchedule;
+      uint32_t m_decodeThreads;
+      float m_minSumNormalization;
+      float m_minSumOffset;
 
       uint32_t m_parityCheckMatrix_rank;
 
-      void m_makeDecoderMatrices();
+      // Iteration statistics for the most recent decode
+      uint64_t m_decodedIterations;
+      uint32_t m_decodedCodewords;
+      uint32_t m_decodedExpired;
+
+      /*!
+       * @brief The iteration limits of one decode call.
+       *
+       * @details The limits are read from the LDPC object once, when the
+       * call starts. With a time budget, each codeword, or group of
+       * interleaved codewords, claims its share of the time left before it
+       * starts; see setDecodeTimeBudget. Shared by the decodeParallel
+       * workers.
+       */
+      class DecodeBudget
+      {
+      public:
+        typedef std::chrono::steady_clock Clock;
+
+        /*!
+         * @param[in] ldpc The limits to use
+         * @param[in] numCodewords The codewords the call will decode
+         * @param[in] workers The codewords decoded side by side
+         */
+        DecodeBudget (const LDPC &ldpc, uint32_t numCodewords, uint32_t workers = 1);
 
-      void m_makeEncoderMatrices();
+        /*!
+         * @brief Claim the time for the next @p codewords codewords.
+         * @return The time by which to stop decoding them
+         */
+        Clock::time_point claim(uint32_t codewords);
+
+        /*!
+         * @brief Check the clock after an iteration.
+         * @return true if @p deadline has passed, in which case the
+         * @p codewords still decoding are counted as expired.
+         */
+        bool expired(Clock::time_point deadline, uint32_t codewords = 1)
+        {
+          if (!m_timed || Clock::now() < deadline)
+            return false;
+          m_expired += codewords;
+          return true;
+        }
+
+        uint32_t expiredCodewords() const {
+          return m_expired;
+        }
+
+        const uint32_t maxIterations;
+        const uint32_t stallIterations;
+
+      private:
+        const bool m_timed;
+        const uint32_t m_workers;
+        const Clock::time_point m_end;
+        std::atomic<uint32_t> m_unclaimed;
+        std::atomic<uint32_t> m_expired;
+      };
+
+      // Scratch buffers for decode and decodeBatch, and for each
+      // decodeParallel worker
+      DecoderWorkspace m_workspace;
+      std::vector<DecoderWorkspace> m_workerWorkspaces;
+
+      /*!
+       * @brief Decode @p numCodewords consecutive codewords with the selected
+       * algorithm.
+       *
+       * @details This and the decoders it calls only read the LDPC object,
+       * so any number of threads may use them at once, each with its own
+       * workspace.
+       *
+       * @param[in] encoded The encoded samples, numCodewords * n of them
+       * @param[in] numCodewords The number of codewords to decode
+       * @param[in] snrEstimate The estimated signal to noise ratio
+       * @param[out] decoded The decoded messages, numCodewords * k of them
+       * @param[out] posteriorLLRs If not nullptr, the a-posteriori LLRs,
+       * numCodewords * n of them
+       * @param[in,out] workspace Scratch buffers, sized by this call
+       * @param[in,out] budget The call's iteration limits
+       * @param[in,out] iterations Incremented by the iterations used
+       * @return The number of unsatisfied parity checks over all codewords
+       */
+      uint32_t m_decodeCodewords(const float *encoded, uint32_t numCodewords,
+          float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+          DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const;
+
+      /*!
+       * @brief Probability domain belief propagation decoder.
+       *
+       * @details See @p decode for parameters
+       */
+      uint32_t m_decodeProbabilityDomain(const float *encoded, uint32_t numCodewords,
+          float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+          DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const;
+
+      /*!
+       * @brief LLR domain normalized or offset min-sum decoder.
+       *
+       * @details Each check node keeps only the two smallest incoming
+       * magnitudes, the index of the smallest and the product of the incoming
+       * signs, plus the sign of each incoming message. The outgoing message to
+       * any symbol node is rebuilt from those, so a check node costs O(d)
+       * rather than O(d^2). See @p decode for parameters.
+       */
+      uint32_t m_decodeMinSum(const float *encoded, uint32_t numCodewords,
+          float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+          DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const;
+
+      /*!
+       * @brief LLR domain normalized or offset min-sum decoder using the
+       * layered schedule.
+       *
+       * @details Check node state is kept in the same compressed form as
+       * @p m_decodeMinSum. See @p decode for parameters.
+       */
+      uint32_t m_decodeLayeredMinSum(const float *encoded, uint32_t numCodewords,
+          float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+          DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const;
+
+      /*!
+       * @brief Fixed point layered offset min-sum decoder using the SIMD
+       * kernels.
+       *
+       * @details See @p decode for parameters.
+       */
+      uint32_t m_decodeFixedPointMinSum(const float *encoded, uint32_t numCodewords,
+          float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+          DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const;
+
+      /*!
+       * @brief Fixed point layered offset min-sum decoder using the
+       * interleaved SIMD kernels.
+       *
+       * @details Codeword i is read from encoded[i], its message written
+       * to decoded[i] and, if @p posteriorLLRs is not nullptr, its
+       * a-posteriori LLRs to posteriorLLRs[i], so the codewords need not be
+       * contiguous. See
+       * @p m_decodeCodewords for the other parameters.
+       */
+      uint32_t m_decodeInterleavedMinSum(const float * const *encoded,
+          uint8_t * const *decoded, float * const *posteriorLLRs,
+          uint32_t numCodewords, float snrEstimate, DecoderWorkspace &workspace,
+          DecodeBudget &budget, uint64_t &iterations) const;
 
     };
 
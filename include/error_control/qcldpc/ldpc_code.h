@@ -0,0 +1,248 @@
+/*!
+ * @file ldpc_code.h
+ * @author Steven Knudsen
+ * @date June 17, 2021
+ *
+ * @details The structures of a QC-LDPC code that do not change once built,
+ * shared by every LDPC object that uses the code.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#ifndef EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_CODE_H_
+#define EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_CODE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Sparse>
+
+#include "parity_check.h"
+#include "tanner_graph.h"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    /*!
+     * @brief The parity check matrix, encoder matrices, Tanner graph and
+     * layer tables of one QC-LDPC code.
+     *
+     * @details Building these dominates the cost of making an LDPC object,
+     * and they depend only on the error correction scheme. @p get builds
+     * each scheme's code the first time it is asked for and keeps it for
+     * the life of the process; after that every LDPC object, in any
+     * thread, shares the same read-only copy.
+     */
+    class LDPCCode
+    {
+    public:
+      /*!
+       * @brief The code for an error correction scheme, built on first use.
+       *
+       * @details Thread safe. Codes are built one at a time, so a thread
+       * asking for a code that is not built yet may wait for another
+       * thread building a different one.
+       *
+       * @param[in] ecScheme One of the IEEE 802.11n QC-LDPC or CCSDS AR4JA
+       * LDPC error correction schemes
+       * @return The shared, read-only code
+       * @throws std::runtime_error If there is a problem with the prototype
+       * matrix; nothing is kept and the next call tries again.
+       */
+      static std::shared_ptr<const LDPCCode> get(
+          ErrorCorrection::ErrorCorrectionScheme ecScheme);
+
+      /*!
+       * @brief Keep the codes @p get builds in files in @p directory.
+       *
+       * @details Once set, @p get loads a code from its file in
+       * @p directory instead of building it, and writes the file if it is
+       * missing, out of date or damaged, so only the first process to use
+       * a code pays for building its encoder matrices. A problem with the
+       * cache is never an error; the code is then built as if there were no
+       * cache. Codes already built are not affected. An empty string, the
+       * default, turns the cache off.
+       *
+       * @param[in] directory An existing, writable directory
+       */
+      static void setCacheDirectory(const std::string &directory);
+
+      /*!
+       * @brief The name of the file for @p ecScheme in a cache directory.
+       */
+      static std::string cacheFileName(
+          ErrorCorrection::ErrorCorrectionScheme ecScheme);
+
+      /*!
+       * @brief Read a code written by @p save.
+       *
+       * @details The file is memory mapped and its encoder tables are
+       * copied out as they are. The decoder tables are cheap to build from
+       * the prototype matrix, so they are built and the file's copies are
+       * only checked against them.
+       *
+       * @param[in] path The file to read
+       * @return A new code; it is not added to the registry used by @p get
+       * @throws std::runtime_error If the file cannot be read, was written
+       * by another file version or for another byte order, does not match
+       * the prototype matrix built into this library, holds tables that do
+       * not fit it, or is damaged.
+       */
+      static std::shared_ptr<const LDPCCode> load(const std::string &path);
+
+      /*!
+       * @brief Write the code's tables to a binary file @p load can map.
+       *
+       * @details The file holds the Tanner graph, M, N, the layer tables
+       * and either the Richardson-Urbanke encoder matrices or the
+       * systematic generator, whichever the code encodes with, built first
+       * if need be. It is written in native byte order for use on the
+       * same kind of machine. The file is written under a temporary name
+       * and renamed, so another process never sees part of a file.
+       *
+       * @param[in] path The file to write
+       * @throws std::runtime_error If the file cannot be written.
+       */
+      void save(const std::string &path) const;
+
+      /*!
+       * @brief The version of the file format written by @p save; bump it
+       * whenever the format or the meaning of a table changes.
+       */
+      static const uint32_t FILE_VERSION = 3;
+
+      /*!
+       * @brief Build the code for @p ecScheme.
+       *
+       * @details Use @p get instead, unless a private copy is wanted.
+       */
+      explicit LDPCCode (
+          ErrorCorrection::ErrorCorrectionScheme ecScheme);
+
+      LDPCCode (const LDPCCode &) = delete;
+      LDPCCode & operator= (const LDPCCode &) = delete;
+
+      ErrorCorrection::ErrorCorrectionScheme getErrorCorrectionScheme() const {
+        return m_ECScheme;
+      }
+
+      uint32_t getMessageLength() const {
+        return m_k;
+      }
+
+      /*!
+       * @brief The codeword length, including any punctured symbols
+       */
+      uint32_t getCodewordLength() const {
+        return m_n;
+      }
+
+      /*!
+       * @brief The number of parity symbols at the end of every codeword
+       * that the code never transmits; M for the CCSDS AR4JA codes, 0 for
+       * the 802.11n codes.
+       */
+      uint32_t getPuncturedLength() const {
+        return m_punctured;
+      }
+
+      /*!
+       * @brief Parity Check matrix accessor
+       *
+       * @details Built the first time it is asked for; see
+       * ParityCheck::parityCheckMatrix.
+       */
+      const Eigen::MatrixXi & getParityMatrix() const {
+        return m_pchk.parityCheckMatrix();
+      }
+
+    private:
+      friend class LDPC;
+
+      ErrorCorrection::ErrorCorrectionScheme m_ECScheme;
+
+      uint32_t m_k; // message length
+      uint32_t m_n; // codeword length, including the punctured symbols
+      uint32_t m_punctured; // symbols at the end of the codeword never sent
+
+      ParityCheck m_pchk;
+
+      // Dense and sparse matrices needed for encode and encodeSparse, built
+      // by m_prepareEncoderMatrices the first time either is used
+      mutable std::once_flag m_encoderMatricesOnce;
+      mutable Eigen::MatrixXd m_A, m_B, m_EinvTA_C, m_invTA, m_invTB;
+      mutable Eigen::SparseMatrix<double> m_sA, m_sB, m_sEinvTA_C, m_sinvTA, m_sinvTB;
+
+      // Matrices needed for decoding
+      // M(j) represents the set of indexes of all the children parity check nodes
+      // connected to the symbol node d(j)
+      Eigen::MatrixXi m_M;
+      Eigen::VectorXi m_M_numCheckNodes;
+      // N(i) represents the set of indexes of all the parent symbol nodes connected
+      // to the parity check node h(i)
+      Eigen::MatrixXi m_N;
+      Eigen::VectorXi m_N_numSymbolNodes;
+      // Edge-indexed view of M and N; the decoders keep their messages per edge
+      TannerGraph m_graph;
+
+      // The nonzero submatrices (circulants) of each prototype matrix row
+      // (layer), used by the layered decoders. The circulants of layer l are
+      // [m_layerStart[l], m_layerStart[l + 1]). Check node t of layer l
+      // connects to symbol node m_circulantColumn[c] * Z +
+      // (t + m_circulantShift[c]) % Z for each of its circulants c.
+      std::vector<uint32_t> m_layerStart;
+      std::vector<uint32_t> m_circulantColumn;
+      std::vector<uint32_t> m_circulantShift;
+      uint32_t m_maxLayerDegree;
+      uint32_t m_submatrixSize; // Z
+
+      // Set by m_makeQCEncoder if encodeQC can use the dual-diagonal parity
+      // structure. The XOR of the first parity block column's circulants is
+      // then the single circulant with shift m_qcParityShift.
+      bool m_qcEncoder;
+      uint32_t m_qcParityShift;
+
+      // Codes without the dual-diagonal structure are encoded with the
+      // systematic generator, built by m_prepareQCGenerator on first use.
+      // Message bit i adds the m_n - m_k parity bits at
+      // m_qcGenerator[i * m_qcGeneratorWords], packed most significant bit
+      // first. m_qcGeneratorWords is 0 if the parity part of H is singular.
+      mutable std::once_flag m_qcGeneratorOnce;
+      mutable std::vector<uint64_t> m_qcGenerator;
+      mutable uint32_t m_qcGeneratorWords;
+
+      void m_makeDecoderMatrices();
+
+      void m_prepareEncoderMatrices() const;
+
+      void m_makeEncoderMatrices() const;
+
+      void m_makeQCEncoder();
+
+      void m_prepareQCGenerator() const;
+
+      void m_makeQCGenerator() const;
+
+      // Used by load; the tables come from a file image instead of being
+      // built
+      LDPCCode (
+          ErrorCorrection::ErrorCorrectionScheme ecScheme,
+          const uint8_t *image,
+          size_t imageSize);
+
+      void m_loadTables(const uint8_t *image, size_t imageSize);
+    };
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif /* EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_CODE_H_ */
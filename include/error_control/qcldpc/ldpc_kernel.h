@@ -0,0 +1,182 @@
+/*!
+ * @file ldpc_kernel.h
+ * @author Steven Knudsen
+ * @date June 10, 2021
+ *
+ * @details SIMD kernels for the fixed point layered QC-LDPC min-sum decoder.
+ *
+ * Every nonzero prototype matrix entry is a cyclically shifted Z x Z identity,
+ * so the Z check nodes of a layer (prototype row) all do the same work on
+ * rotated copies of the same block columns. The kernels process those Z
+ * check nodes as Z SIMD lanes of saturating 8 bit arithmetic.
+ *
+ * Data layout, with Z the submatrix size:
+ *   - The a-posteriori LLRs of block column j start at posterior + j * stride
+ *     and are stored twice, at offsets [0, Z) and [Z, 2Z). The Z LLRs seen by
+ *     a circulant with shift s are then the contiguous, unaligned load at
+ *     offset s. @p stride must be at least 2Z + LDPC_KERNEL_LANE_ALIGN.
+ *   - The check to symbol messages of circulant c of a layer start at
+ *     messages + c * laneStride, one per check node, where laneStride is Z
+ *     rounded up to LDPC_KERNEL_LANE_ALIGN.
+ *   - Lanes past Z are padding; they are computed but never used.
+ *
+ * The interleaved kernels instead put one codeword in each lane, so a vector
+ * holds the same LLR of frameLanes codewords of the same code:
+ *   - The a-posteriori LLRs of symbol node i start at posterior +
+ *     i * frameLanes.
+ *   - The messages of check node t of circulant c of a layer start at
+ *     messages + (c * Z + t) * frameLanes.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#ifndef EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_KERNEL_H_
+#define EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_KERNEL_H_
+
+#include <cstdint>
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    /*!
+     * @brief Largest SIMD width in bytes; buffers are padded to multiples of it.
+     */
+    const uint32_t LDPC_KERNEL_LANE_ALIGN = 32;
+
+    /*!
+     * @brief Largest check to symbol message magnitude.
+     *
+     * @details The a-posteriori LLRs saturate at +/-127. Keeping messages well
+     * inside that range means removing a message from a saturated LLR still
+     * leaves a strong symbol to check message; without the limit the decoder
+     * gets worse as the SNR goes up.
+     */
+    const int8_t LDPC_KERNEL_MESSAGE_MAX = 31;
+
+    /*!
+     * @brief Rounds @p Z up to a whole number of the widest SIMD vectors.
+     */
+    inline uint32_t ldpcKernelLaneStride(uint32_t Z)
+    {
+      return (Z + LDPC_KERNEL_LANE_ALIGN - 1) & ~(LDPC_KERNEL_LANE_ALIGN - 1);
+    }
+
+    /*!
+     * @brief Decoder kernels for one instruction set.
+     */
+    struct LDPCKernels
+    {
+      /*!
+       * @brief Offset min-sum update of all Z check nodes of one layer.
+       *
+       * @details The layer's previous messages are removed from the
+       * a-posteriori LLRs of its block columns, new messages are computed and
+       * added back, and both copies of each block column are left consistent.
+       *
+       * @param[in] blockColumns Block column of each circulant in the layer
+       * @param[in] shifts Cyclic shift of each circulant in the layer
+       * @param[in] degree Number of circulants in the layer
+       * @param[in] Z Submatrix size
+       * @param[in] stride Distance between block columns in @p posterior
+       * @param[in] offset Offset subtracted from message magnitudes
+       * @param[in,out] posterior The a-posteriori LLRs
+       * @param[in,out] messages The layer's check to symbol messages
+       * @param[out] scratch At least degree * LDPC_KERNEL_LANE_ALIGN bytes
+       */
+      void (*layerUpdate)(const uint32_t *blockColumns, const uint32_t *shifts,
+          uint32_t degree, uint32_t Z, uint32_t stride, int8_t offset,
+          int8_t *posterior, int8_t *messages, int8_t *scratch);
+
+      /*!
+       * @brief Count the unsatisfied check nodes of one layer.
+       *
+       * @details A bit is taken to be 1 where its a-posteriori LLR is
+       * negative. See @p layerUpdate for parameters.
+       *
+       * @return The number of the layer's Z check nodes that are not satisfied.
+       */
+      uint32_t (*layerSyndrome)(const uint32_t *blockColumns,
+          const uint32_t *shifts, uint32_t degree, uint32_t Z, uint32_t stride,
+          const int8_t *posterior);
+
+      /*!
+       * @brief Codewords per vector for the interleaved kernels; a divisor of
+       * LDPC_KERNEL_LANE_ALIGN
+       */
+      uint32_t frameLanes;
+
+      /*!
+       * @brief Offset min-sum update of one layer of frameLanes interleaved
+       * codewords.
+       *
+       * @details The check nodes of the layer are updated one after the other,
+       * each for all codewords at once. Codewords whose lane in @p active is
+       * zero are left untouched.
+       *
+       * @param[in] blockColumns Block column of each circulant in the layer
+       * @param[in] shifts Cyclic shift of each circulant in the layer
+       * @param[in] degree Number of circulants in the layer
+       * @param[in] Z Submatrix size
+       * @param[in] offset Offset subtracted from message magnitudes
+       * @param[in] active frameLanes bytes, -1 to update the codeword, 0 not to
+       * @param[in,out] posterior The a-posteriori LLRs
+       * @param[in,out] messages The layer's check to symbol messages
+       * @param[out] scratch At least degree * frameLanes bytes
+       */
+      void (*interleavedLayerUpdate)(const uint32_t *blockColumns,
+          const uint32_t *shifts, uint32_t degree, uint32_t Z, int8_t offset,
+          const int8_t *active, int8_t *posterior, int8_t *messages,
+          int8_t *scratch);
+
+      /*!
+       * @brief Count the unsatisfied check nodes of one layer of frameLanes
+       * interleaved codewords.
+       *
+       * @details See @p interleavedLayerUpdate for the other parameters.
+       *
+       * @param[in,out] unsatisfied frameLanes counts; the layer's unsatisfied
+       * check nodes of codeword f are added to unsatisfied[f]
+       * @return Bit f is set if codeword f has an unsatisfied check node in
+       * the layer.
+       */
+      uint32_t (*interleavedLayerSyndrome)(const uint32_t *blockColumns,
+          const uint32_t *shifts, uint32_t degree, uint32_t Z,
+          const int8_t *posterior, uint16_t *unsatisfied);
+
+      /*!
+       * @brief Name of the instruction set, e.g., "avx2"
+       */
+      const char *name;
+    };
+
+    /*!
+     * @brief The best kernels for the CPU we are running on.
+     *
+     * @details On x86 the choice is made at run time from the CPU features;
+     * NEON is used when the target supports it at compile time.
+     */
+    const LDPCKernels & ldpcKernels();
+
+    /*!
+     * @brief Portable kernels, written for the compiler to auto-vectorize.
+     */
+    const LDPCKernels & ldpcKernelsGeneric();
+
+    /*!
+     * @brief Instruction set specific kernels.
+     *
+     * @return nullptr if not built for, or not supported by, this CPU.
+     */
+    const LDPCKernels * ldpcKernelsSSE41();
+    const LDPCKernels * ldpcKernelsAVX2();
+    const LDPCKernels * ldpcKernelsNEON();
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif /* EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_KERNEL_H_ */
@@ -0,0 +1,236 @@
+/*!
+ * @file ldpc_kernel_impl.h
+ * @author Steven Knudsen
+ * @date June 10, 2021
+ *
+ * @details Instruction set independent bodies of the LDPC decoder kernels.
+ *
+ * The kernels are templates over a vector type V that provides
+ *   - T, the vector type, and W, the number of int8 lanes
+ *   - load, store (unaligned), set1, zero
+ *   - adds, subs (saturating), min, max, abs, bxor
+ *   - eq (lane mask), select(mask, a, b) (a where mask is set, else b)
+ *   - sign(a, s) (-a where s is negative, else a)
+ *   - negativeMask(a) (bit i set if lane i is negative)
+ *
+ * Each instruction set gets its own translation unit that defines V and
+ * instantiates the templates. On x86 that translation unit enables the
+ * instruction set with a target pragma before including this file, so only
+ * the kernels are built for it and the rest of the library still runs on
+ * any CPU.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#ifndef EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_KERNEL_IMPL_H_
+#define EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_KERNEL_IMPL_H_
+
+#include "ldpc_kernel.h"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    /*!
+     * @brief Rewrite the second copy of a block column's LLRs from the Z values
+     * just written starting at @p shift.
+     *
+     * @note Templated on V only so that each instruction set gets its own
+     * copy; an ordinary inline function would be built with a different target
+     * in each translation unit and the linker could keep any one of them.
+     */
+    template <class V>
+    inline void
+    ldpcResyncColumn(int8_t *column, uint32_t Z, uint32_t shift)
+    {
+      __builtin_memcpy(column, column + Z, shift);
+      __builtin_memcpy(column + Z + shift, column + shift, Z - shift);
+    }
+
+    template <class V>
+    void
+    ldpcLayerUpdate(const uint32_t *blockColumns, const uint32_t *shifts,
+        uint32_t degree, uint32_t Z, uint32_t stride, int8_t offset,
+        int8_t *posterior, int8_t *messages, int8_t *scratch)
+    {
+      typedef typename V::T T;
+      const uint32_t laneStride = ldpcKernelLaneStride(Z);
+      const T maxMag = V::set1(127);
+      const T minLLR = V::set1(-127);
+      const T off = V::set1(offset);
+      const T messageMax = V::set1(LDPC_KERNEL_MESSAGE_MAX);
+      const T zero = V::zero();
+
+      for (uint32_t t0 = 0; t0 < Z; t0 += V::W)
+      {
+        T min1 = maxMag;
+        T min2 = maxMag;
+        T signs = zero;
+
+        // Symbol to check messages, and their two smallest magnitudes
+        for (uint32_t c = 0; c < degree; c++)
+        {
+          const int8_t *p = posterior + blockColumns[c] * stride + shifts[c] + t0;
+          const int8_t *r = messages + c * laneStride + t0;
+          // Keep -128 out so that abs cannot overflow
+          T q = V::max(V::subs(V::load(p), V::load(r)), minLLR);
+          V::store(scratch + c * V::W, q);
+          T a = V::abs(q);
+          min2 = V::min(min2, V::max(min1, a));
+          min1 = V::min(min1, a);
+          signs = V::bxor(signs, q);
+        }
+
+        T mag1 = V::min(V::max(V::subs(min1, off), zero), messageMax);
+        T mag2 = V::min(V::max(V::subs(min2, off), zero), messageMax);
+
+        // New check to symbol messages and a-posteriori LLRs
+        for (uint32_t c = 0; c < degree; c++)
+        {
+          int8_t *p = posterior + blockColumns[c] * stride + shifts[c] + t0;
+          int8_t *r = messages + c * laneStride + t0;
+          T q = V::load(scratch + c * V::W);
+          T mag = V::select(V::eq(V::abs(q), min1), mag2, mag1);
+          T rNew = V::sign(mag, V::bxor(signs, q));
+          V::store(r, rNew);
+          V::store(p, V::adds(q, rNew));
+        }
+      }
+
+      for (uint32_t c = 0; c < degree; c++)
+        ldpcResyncColumn<V>(posterior + blockColumns[c] * stride, Z, shifts[c]);
+    }
+
+    template <class V>
+    uint32_t
+    ldpcLayerSyndrome(const uint32_t *blockColumns, const uint32_t *shifts,
+        uint32_t degree, uint32_t Z, uint32_t stride, const int8_t *posterior)
+    {
+      typedef typename V::T T;
+      uint32_t unsatisfied = 0;
+
+      for (uint32_t t0 = 0; t0 < Z; t0 += V::W)
+      {
+        T parity = V::zero();
+        for (uint32_t c = 0; c < degree; c++)
+          parity = V::bxor(parity,
+              V::load(posterior + blockColumns[c] * stride + shifts[c] + t0));
+
+        uint32_t mask = V::negativeMask(parity);
+        uint32_t lanes = Z - t0;
+        if (lanes < V::W)
+          mask &= (1u << lanes) - 1;
+        unsatisfied += __builtin_popcount(mask);
+      }
+      return unsatisfied;
+    }
+
+    template <class V>
+    void
+    ldpcInterleavedLayerUpdate(const uint32_t *blockColumns,
+        const uint32_t *shifts, uint32_t degree, uint32_t Z, int8_t offset,
+        const int8_t *active, int8_t *posterior, int8_t *messages,
+        int8_t *scratch)
+    {
+      typedef typename V::T T;
+      const T maxMag = V::set1(127);
+      const T minLLR = V::set1(-127);
+      const T off = V::set1(offset);
+      const T messageMax = V::set1(LDPC_KERNEL_MESSAGE_MAX);
+      const T zero = V::zero();
+      const T update = V::load(active);
+
+      for (uint32_t t = 0; t < Z; t++)
+      {
+        T min1 = maxMag;
+        T min2 = maxMag;
+        T signs = zero;
+
+        // Symbol to check messages, and their two smallest magnitudes
+        for (uint32_t c = 0; c < degree; c++)
+        {
+          uint32_t m = t + shifts[c];
+          if (m >= Z)
+            m -= Z;
+          const int8_t *p = posterior + (blockColumns[c] * Z + m) * V::W;
+          const int8_t *r = messages + (c * Z + t) * V::W;
+          // Keep -128 out so that abs cannot overflow
+          T q = V::max(V::subs(V::load(p), V::load(r)), minLLR);
+          V::store(scratch + c * V::W, q);
+          T a = V::abs(q);
+          min2 = V::min(min2, V::max(min1, a));
+          min1 = V::min(min1, a);
+          signs = V::bxor(signs, q);
+        }
+
+        T mag1 = V::min(V::max(V::subs(min1, off), zero), messageMax);
+        T mag2 = V::min(V::max(V::subs(min2, off), zero), messageMax);
+
+        // New check to symbol messages and a-posteriori LLRs
+        for (uint32_t c = 0; c < degree; c++)
+        {
+          uint32_t m = t + shifts[c];
+          if (m >= Z)
+            m -= Z;
+          int8_t *p = posterior + (blockColumns[c] * Z + m) * V::W;
+          int8_t *r = messages + (c * Z + t) * V::W;
+          T q = V::load(scratch + c * V::W);
+          T mag = V::select(V::eq(V::abs(q), min1), mag2, mag1);
+          T rNew = V::sign(mag, V::bxor(signs, q));
+          V::store(r, V::select(update, rNew, V::load(r)));
+          V::store(p, V::select(update, V::adds(q, rNew), V::load(p)));
+        }
+      }
+    }
+
+    template <class V>
+    uint32_t
+    ldpcInterleavedLayerSyndrome(const uint32_t *blockColumns,
+        const uint32_t *shifts, uint32_t degree, uint32_t Z,
+        const int8_t *posterior, uint16_t *unsatisfied)
+    {
+      typedef typename V::T T;
+      const T zero = V::zero();
+      int8_t lanes[V::W];
+      uint32_t mask = 0;
+
+      // Count the satisfied check nodes of each codeword in an int8 lane,
+      // emptying the counts before they can saturate
+      for (uint32_t t0 = 0; t0 < Z; t0 += 127)
+      {
+        uint32_t checks = Z - t0 < 127 ? Z - t0 : 127;
+        T satisfied = zero;
+        for (uint32_t t = t0; t < t0 + checks; t++)
+        {
+          T parity = zero;
+          for (uint32_t c = 0; c < degree; c++)
+          {
+            uint32_t m = t + shifts[c];
+            if (m >= Z)
+              m -= Z;
+            parity = V::bxor(parity,
+                V::load(posterior + (blockColumns[c] * Z + m) * V::W));
+          }
+          // eq gives -1 where the parity is not negative
+          satisfied = V::subs(satisfied, V::eq(V::min(parity, zero), zero));
+        }
+
+        V::store(lanes, satisfied);
+        for (uint32_t f = 0; f < V::W; f++)
+        {
+          uint32_t failed = checks - lanes[f];
+          unsatisfied[f] += failed;
+          mask |= (failed != 0 ? 1u : 0u) << f;
+        }
+      }
+      return mask;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif /* EX2_SDR_ERROR_CONTROL_QCLDPC_LDPC_KERNEL_IMPL_H_ */
@@ -17,15 +17,12 @@
 #include <eigen3/Eigen/Dense>
 #include <eigen3/Eigen/Sparse>
 #include <glog/logging.h>
+#include <mutex>
 #include <sstream>
+#include <string>
 
 #include "../error_correction.hpp"
 
-// TODO: make this a path read from a config file
-#ifndef PATH_TO_PROTO_H
-#define PATH_TO_PROTO_H "/opt/darkstar/fec/ldpc/802.11/proto_H"
-#endif
-
 namespace ex2
 {
   namespace sdr
@@ -37,14 +34,24 @@ namespace ex2
       /*!
        * @brief ParityCheck constructor
        *
-       * @param[in] errorCorrectionCoding One of the IEEE 802.11n error correction codes
-       * @param[in] codingRate One of the IEEE 802.11n rates.
+       * @details The prototype matrix is normally the one built into the
+       * library (see proto_h.h). If @p protoHPath is given, it is read
+       * instead from the file in that directory named for the codeword
+       * length and rate, e.g., 1944_12, in the format of
+       * lib/error_control/qcldpc/fec/ldpc/802.11/proto_H.
+       *
+       * The CCSDS AR4JA codes are always built in; their parity check
+       * matrix includes the punctured symbols.
+       *
+       * @param[in] ecScheme One of the IEEE 802.11n QC-LDPC or CCSDS AR4JA
+       * LDPC error correction schemes
+       * @param[in] protoHPath Optional directory of prototype matrix files
        * @throws std::runtime_error If bad path to submatrices or problem with
        * submatrices.
        */
       ParityCheck (
-          ErrorCorrection::ErrorCorrectionCoding errorCorrectionCoding,
-          ErrorCorrection::CodingRate codingRate);
+          ErrorCorrection::ErrorCorrectionScheme ecScheme,
+          const std::string &protoHPath = std::string());
 
       ~ParityCheck ();
 
@@ -59,30 +66,45 @@ namespace ex2
       /*!
        * @brief Return the integer parity check martrix
        *
+       * @details The parity check matrices are only built, from the
+       * prototype matrix, the first time one of them is asked for; the
+       * decoders work from the prototype matrix alone. Thread safe.
+       *
        * @return The parity check matrix corresponding to @p codeword_size and @p rate of the constructor.
        */
-      Eigen::MatrixXi & parityCheckMatrix();
+      const Eigen::MatrixXi & parityCheckMatrix() const;
 
       /*!
        * @brief Return the double parity check martrix
        *
        * @return The parity check matrix corresponding to @p codeword_size and @p rate of the constructor.
        */
-      Eigen::MatrixXd  & parityCheckMatrixDouble();
+      const Eigen::MatrixXd  & parityCheckMatrixDouble() const;
 
       /*!
        * @brief Return the parity check martrix as a sparse double matrix
        *
        * @return The parity check matrix corresponding to @p codeword_size and @p rate of the constructor.
        */
-      Eigen::SparseMatrix<double>  & parityCheckMatrixSparse();
+      const Eigen::SparseMatrix<double>  & parityCheckMatrixSparse() const;
 
       /*!
-       * @brief Return the IEEE 802.11n prototype matrix size for this parity check matrix.
+       * @brief Return the prototype matrix submatrix size for this parity check matrix.
        *
        * @return The prototype matrix size.
        */
-      unsigned int prototypeMatrixSize();
+      unsigned int prototypeMatrixSize() const;
+
+      /*!
+       * @brief Return the prototype matrix.
+       *
+       * @details Entry (i,j) is the right cyclic shift of the identity
+       * submatrix at block row i, block column j of the parity check matrix,
+       * or negative if that submatrix is all zeros.
+       *
+       * @return The prototype matrix.
+       */
+      const Eigen::MatrixXi & prototypeMatrix() const;
 
       /*!
        * @brief Rank of the parity check matrix.
@@ -99,7 +121,7 @@ namespace ex2
       const static unsigned int k_submatrix54x54Size = 54;
       const static unsigned int k_submatrix81x81Size = 81;
 
-      const static int k_submatricesPerRow = 24;
+      static constexpr int k_submatricesPerRow = 24;
 
       unsigned int m_submatricesPerColumn() const;
 
@@ -108,7 +130,7 @@ namespace ex2
         char codewordLengthStr[32];
         sprintf(codewordLengthStr,"%d",m_errorCorrection->getCodewordLen());
         std::string filename(codewordLengthStr);
-        switch (m_errorCorrection->codingRate())
+        switch (m_errorCorrection->getCodingRate())
         {
           case ErrorCorrection::CodingRate::RATE_1_2:
             filename.append("_12");
@@ -122,16 +144,14 @@ namespace ex2
           case ErrorCorrection::CodingRate::RATE_5_6:
             filename.append("_56");
             break;
+          case ErrorCorrection::CodingRate::RATE_1_6:
+          case ErrorCorrection::CodingRate::RATE_1_5:
           case ErrorCorrection::CodingRate::RATE_1_4:
           case ErrorCorrection::CodingRate::RATE_1_3:
-          case ErrorCorrection::CodingRate::RATE_2_5:
-          case ErrorCorrection::CodingRate::RATE_3_5:
           case ErrorCorrection::CodingRate::RATE_4_5:
+          case ErrorCorrection::CodingRate::RATE_7_8:
           case ErrorCorrection::CodingRate::RATE_8_9:
-          case ErrorCorrection::CodingRate::RATE_9_10:
           case ErrorCorrection::CodingRate::RATE_NA:
-          case ErrorCorrection::CodingRate::RATE_FIRST:
-          case ErrorCorrection::CodingRate::RATE_LAST:
           default:
             break;
         }
@@ -140,19 +160,29 @@ namespace ex2
 
       unsigned int m_submatrixSize() const;
 
+      Eigen::MatrixXi m_builtin_proto_h();
+
+      Eigen::MatrixXi m_ar4ja_proto_h();
+
       Eigen::MatrixXi m_read_proto_h();
 
-      void m_makeParityCheckMatrix();
+      void m_makeParityCheckMatrix() const;
 
       bool m_valid;
 
       ErrorCorrection *m_errorCorrection;
 
+      std::string m_protoHPath; // empty to use the built in prototype matrix
+
       unsigned int m_rank;
 
-      Eigen::MatrixXi m_parityCheckMatrix;
-      Eigen::MatrixXd m_parityCheckMatrixDouble;
-      Eigen::SparseMatrix<double> m_parityCheckMatrixSparse;
+      Eigen::MatrixXi m_prototypeMatrix;
+
+      // Built on first use by m_makeParityCheckMatrix
+      mutable std::once_flag m_parityCheckMatrixOnce;
+      mutable Eigen::MatrixXi m_parityCheckMatrix;
+      mutable Eigen::MatrixXd m_parityCheckMatrixDouble;
+      mutable Eigen::SparseMatrix<double> m_parityCheckMatrixSparse;
 
     }; // ParityCheck
 
@@ -0,0 +1,88 @@
+/*!
+ * @file proto_h.h
+ * @author Steven Knudsen
+ * @date June 16, 2021
+ *
+ * @details The IEEE 802.11n QC-LDPC prototype matrices, built into the
+ * library so that no files need be read to make a code, and the CCSDS AR4JA
+ * protographs lifted to prototype matrices of the same form.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#ifndef EX2_SDR_ERROR_CONTROL_QCLDPC_PROTO_H_H_
+#define EX2_SDR_ERROR_CONTROL_QCLDPC_PROTO_H_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "../error_correction.hpp"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    /*!
+     * @brief Block columns of every IEEE 802.11n prototype matrix
+     */
+    const uint32_t PROTO_H_COLUMNS = 24;
+
+    /*!
+     * @brief The built in prototype matrix of an IEEE 802.11n QC-LDPC code.
+     *
+     * @details Entry (i,j) is at [i * PROTO_H_COLUMNS + j]. It is the right
+     * cyclic shift of the identity submatrix at block row i, block column j
+     * of the parity check matrix, or -1 if that submatrix is all zeros. The
+     * tables are those in fec/ldpc/802.11/proto_H.
+     *
+     * @param[in] codewordLength 648, 1296 or 1944
+     * @param[in] rate One of the 802.11n rates, 1/2, 2/3, 3/4 or 5/6
+     * @param[out] rows The number of block rows
+     * @return The prototype matrix, or nullptr if there is no such code.
+     */
+    const int8_t * ieee80211nPrototypeMatrix(uint32_t codewordLength,
+        ErrorCorrection::CodingRate rate, uint32_t &rows);
+
+    /*!
+     * @brief Block rows of every CCSDS AR4JA prototype matrix
+     */
+    const uint32_t AR4JA_PROTO_H_ROWS = 12;
+
+    /*!
+     * @brief Block columns at the end of every CCSDS AR4JA prototype matrix
+     * whose symbols are never transmitted
+     */
+    const uint32_t AR4JA_PUNCTURED_COLUMNS = 4;
+
+    /*!
+     * @brief The CCSDS AR4JA code with k = 1024 information bits as a
+     * prototype matrix.
+     *
+     * @details CCSDS 131.0-B builds the parity check matrix from M x M
+     * blocks, each a sum of permutations pi_k. Every pi_k maps each quarter
+     * of the M rows onto one quarter of the columns with a cyclic shift, so
+     * with submatrices of size M / 4 the code is quasi-cyclic with one shift
+     * per submatrix, exactly like the 802.11n codes. Entry (i,j) is at
+     * [i * cols + j] and means what it does in ieee80211nPrototypeMatrix.
+     *
+     * The last AR4JA_PUNCTURED_COLUMNS block columns (M symbols) are parity
+     * that is never transmitted.
+     *
+     * @param[in] rate 1/2, 2/3 or 4/5 (n = 2048, 1536 or 1280)
+     * @param[out] cols The number of block columns, including the punctured
+     * ones
+     * @param[out] Z The submatrix size, M / 4
+     * @return The AR4JA_PROTO_H_ROWS x @p cols prototype matrix, or an empty
+     * vector if there is no such code.
+     */
+    std::vector<int8_t> ccsdsAR4JAPrototypeMatrix(
+        ErrorCorrection::CodingRate rate, uint32_t &cols, uint32_t &Z);
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif /* EX2_SDR_ERROR_CONTROL_QCLDPC_PROTO_H_H_ */
@@ -0,0 +1,173 @@
+/*!
+ * @file tanner_graph.h
+ * @author Steven Knudsen
+ * @date June 9, 2021
+ *
+ * @details Edge-indexed Tanner graph used to store LDPC decoder messages.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#ifndef EX2_SDR_ERROR_CONTROL_QCLDPC_TANNER_GRAPH_H_
+#define EX2_SDR_ERROR_CONTROL_QCLDPC_TANNER_GRAPH_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <eigen3/Eigen/Dense>
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    /*!
+     * @brief Compact, edge-indexed Tanner graph.
+     *
+     * @details Every edge (a one in the parity check matrix) gets an index.
+     * Edges are numbered check node by check node, so the edges of check node
+     * i are the contiguous range [checkEdgeBegin(i), checkEdgeEnd(i)). Any
+     * per-edge decoder message can then be kept in a flat array of
+     * @p numEdges() values and a check node update streams through it.
+     *
+     * The symbol node view is a permutation index: the edges of symbol node j
+     * are symbolEdges()[symbolEdgeBegin(j)] to
+     * symbolEdges()[symbolEdgeEnd(j) - 1], in increasing check node order.
+     *
+     * Memory is O(edges) rather than O(checks x symbols).
+     */
+    class TannerGraph
+    {
+    public:
+      /*!
+       * @brief Default constructor makes an empty graph.
+       */
+      TannerGraph ();
+
+      /*!
+       * @brief Constructor
+       *
+       * @param[in] N Row i holds the symbol nodes connected to check node i
+       * @param[in] numSymbolNodes Number of valid entries in each row of @p N
+       * @param[in] M Row j holds the check nodes connected to symbol node j
+       * @param[in] numCheckNodes Number of valid entries in each row of @p M
+       */
+      TannerGraph (
+        const Eigen::MatrixXi &N,
+        const Eigen::VectorXi &numSymbolNodes,
+        const Eigen::MatrixXi &M,
+        const Eigen::VectorXi &numCheckNodes);
+
+      ~TannerGraph ();
+
+      uint32_t numChecks() const {
+        return m_checkEdgeStart.size() - 1;
+      }
+
+      uint32_t numSymbols() const {
+        return m_symbolEdgeStart.size() - 1;
+      }
+
+      uint32_t numEdges() const {
+        return m_edgeSymbol.size();
+      }
+
+      uint32_t checkEdgeBegin(uint32_t check) const {
+        return m_checkEdgeStart[check];
+      }
+
+      uint32_t checkEdgeEnd(uint32_t check) const {
+        return m_checkEdgeStart[check + 1];
+      }
+
+      uint32_t symbolEdgeBegin(uint32_t symbol) const {
+        return m_symbolEdgeStart[symbol];
+      }
+
+      uint32_t symbolEdgeEnd(uint32_t symbol) const {
+        return m_symbolEdgeStart[symbol + 1];
+      }
+
+      /*!
+       * @brief The symbol node at the end of each edge, in edge order.
+       */
+      const uint32_t * edgeSymbols() const {
+        return m_edgeSymbol.data();
+      }
+
+      /*!
+       * @brief The check node at the start of each edge, in edge order.
+       */
+      const uint32_t * edgeChecks() const {
+        return m_edgeCheck.data();
+      }
+
+      /*!
+       * @brief Edge indices grouped by symbol node.
+       */
+      const uint32_t * symbolEdges() const {
+        return m_symbolEdges.data();
+      }
+
+      /*!
+       * @brief The check node of each edge, grouped by symbol node like
+       * @p symbolEdges.
+       */
+      const uint32_t * symbolChecks() const {
+        return m_symbolCheck.data();
+      }
+
+      /*!
+       * @brief The largest number of edges at any check node.
+       */
+      uint32_t maxCheckDegree() const {
+        return m_maxCheckDegree;
+      }
+
+      /*!
+       * @brief Compute the syndrome of a hard decision codeword.
+       *
+       * @param[in] bits numSymbols() hard decisions, each 0 or 1
+       * @param[out] syndrome numChecks() check node parities, 1 if unsatisfied
+       * @return The number of unsatisfied check nodes
+       */
+      uint32_t syndrome(const uint8_t *bits, uint8_t *syndrome) const;
+
+      /*!
+       * @brief Update a syndrome after one hard decision flips.
+       *
+       * @details Only the check nodes of @p symbol change, so keeping the
+       * syndrome up to date as bits flip costs the symbol node degree per
+       * flip rather than a pass over every edge per iteration.
+       *
+       * @param[in] symbol The symbol node whose hard decision flipped
+       * @param[in,out] syndrome The check node parities
+       * @param[in,out] unsatisfied The number of unsatisfied check nodes
+       */
+      void flipSymbol(uint32_t symbol, uint8_t *syndrome, uint32_t &unsatisfied) const {
+        for (uint32_t p = m_symbolEdgeStart[symbol]; p < m_symbolEdgeStart[symbol + 1]; p++) {
+          uint8_t parity = syndrome[m_symbolCheck[p]] ^= 1;
+          unsatisfied += parity ? 1 : -1;
+        }
+      }
+
+    private:
+      // Saves and loads the edge tables with the rest of a code
+      friend class LDPCCode;
+
+      std::vector<uint32_t> m_checkEdgeStart;
+      std::vector<uint32_t> m_edgeSymbol;
+      std::vector<uint32_t> m_edgeCheck;
+      std::vector<uint32_t> m_symbolEdgeStart;
+      std::vector<uint32_t> m_symbolEdges;
+      std::vector<uint32_t> m_symbolCheck;
+      uint32_t m_maxCheckDegree;
+    };
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif /* EX2_SDR_ERROR_CONTROL_QCLDPC_TANNER_GRAPH_H_ */
@@ -61,6 +61,22 @@ namespace ex2 {
        */
       MPDUHeader (std::vector<uint8_t> &packet);
 
+      /*!
+       * @brief Constructor
+       *
+       * @details Reconstitute a header object from the soft BPSK samples of a
+       * received packet. The Golay codewords are decoded by maximum
+       * likelihood, so unlike the byte constructor this one still recovers a
+       * header with more than 3 bit errors in a codeword, but it can never
+       * tell that a codeword was bad. The FEC scheme is checked as for the
+       * byte constructor.
+       *
+       * @param[in] samples One sample per packet bit, most significant bit of
+       * each byte first, Data Field 1 included; a positive sample favours a 1
+       * @throws MPDUHeaderException
+       */
+      MPDUHeader (const std::vector<float> &samples);
+
       /*!
        * @brief Copy Constructor
        *
@@ -161,6 +177,11 @@ namespace ex2 {
        */
       bool decodeMACHeader(std::vector<uint8_t> &packet, bool dataField1Included = true);
 
+      /*!
+       * @brief Set the header fields from the three decoded Golay data words
+       */
+      void unpackMACHeader(uint16_t first, uint16_t second, uint16_t third);
+
       void encodeMACHeader();
 
     };
@@ -19,9 +19,9 @@
 
 //#define CRC_DEBUG 0
 
-namespace xiphos
+namespace ex2
 {
-  namespace darkstar
+  namespace sdr
   {
 
     crc::crc ()
@@ -32,92 +32,129 @@ namespace xiphos
     {
     }
 
-    void crc::add(PPDU_u8 &pdu, crc_size_t crcSize)
+    uint32_t crc::syndrome(const uint8_t *data, size_t length, crc_size_t crcSize)
     {
-      PPDU_u8::data_ptr_t dPtr = pdu.m_payload.data();
-      uint16_t crc16Syndrome;
-      uint32_t crc32Syndrome;
-      switch(crcSize)
-      {
-        case CRC_16_BITS:
-          m_crc16Impl.reset ();
-          m_crc16Impl.process_bytes(dPtr, pdu.payloadLength());
-          crc16Syndrome = m_crc16Impl.checksum();
+      if (crcSize == CRC_16_BITS)
+        return CRC16ARC::compute(data, length);
+      return CRC32::compute(data, length);
+    }
+
+    uint32_t crc::trailerSyndrome(const uint8_t *trailer, crc_size_t crcSize)
+    {
+      if (crcSize == CRC_16_BITS) {
+        dataSyndrome16_t ds16;
+        ds16.lastBytes[0] = trailer[0];
+        ds16.lastBytes[1] = trailer[1];
+        return ds16.syndrome16;
+      }
+      dataSyndrome32_t ds32;
+      for (uint32_t i = 0; i < sizeof(ds32.lastBytes); i++)
+        ds32.lastBytes[i] = trailer[i];
+      return ds32.syndrome32;
+    }
+
+    crc::crc_result_t crc::verify(const uint8_t *data, size_t length,
+      crc_size_t crcSize) noexcept
+    {
+      crc_result_t result = { CRC_BAD_SIZE, 0, 0 };
+      if (crcSize != CRC_16_BITS && crcSize != CRC_32_BITS)
+        return result;
+
+      size_t trailerLength = crcSize / 8;
+      if (length < trailerLength) {
+        result.status = CRC_TOO_SHORT;
+        return result;
+      }
+
+      result.computed = syndrome(data, length - trailerLength, crcSize);
+      result.received = trailerSyndrome(&data[length - trailerLength], crcSize);
 #ifdef CRC_DEBUG
-          printf("crc::add crc16 syndrome   = 0x%x\n",crc16Syndrome);
+      printf("crc::verify computed syndrome = 0x%x\n",result.computed);
+      printf("crc::verify data syndrome     = 0x%x\n",result.received);
 #endif
-          pdu.append((const unsigned char *) &crc16Syndrome, sizeof(crc16Syndrome));
-          break;
-        case CRC_32_BITS:
-          m_crc32Impl.reset ();
-          m_crc32Impl.process_bytes(dPtr, pdu.payloadLength());
-          crc32Syndrome = m_crc32Impl.checksum();
+      result.status = result.computed == result.received ? CRC_PASS : CRC_FAIL;
+      return result;
+    }
+
+    void crc::add(PPDU_u8 &pdu, crc_size_t crcSize)
+    {
+      if (crcSize != CRC_16_BITS && crcSize != CRC_32_BITS)
+        return;
+
+      uint32_t crcSyndrome = syndrome(pdu.m_payload.data(), pdu.payloadLength(), crcSize);
 #ifdef CRC_DEBUG
-          printf("crc::add crc32 syndrome   = 0x%x\n",crc32Syndrome);
+      printf("crc::add crc%d syndrome   = 0x%x\n",crcSize,crcSyndrome);
 #endif
-          pdu.append((const unsigned char *) &crc32Syndrome, sizeof(crc32Syndrome));
-          break;
-        default:
-          break;
+      // Host byte order, as the syndrome's bytes are in memory
+      if (crcSize == CRC_16_BITS) {
+        uint16_t crc16Syndrome = crcSyndrome;
+        pdu.append((const unsigned char *) &crc16Syndrome, sizeof(crc16Syndrome));
       }
+      else
+        pdu.append((const unsigned char *) &crcSyndrome, sizeof(crcSyndrome));
     }
 
     void crc::check(PPDU_u8 &pdu, crc_size_t crcSize)
     {
-      PPDU_u8::data_ptr_t dPtr = pdu.m_payload.data();
-      uint16_t crc16Syndrome;
-      uint32_t crc32Syndrome;
-      int N = pdu.payloadLength();
-      switch(crcSize)
+      crc_result_t result = verify(pdu.m_payload.data(), pdu.payloadLength(), crcSize);
+      switch(result.status)
       {
-        case CRC_16_BITS:
-          m_crc16Impl.reset ();
-          m_crc16Impl.process_bytes(dPtr, N-sizeof(crc16Syndrome));
-          crc16Syndrome = m_crc16Impl.checksum();
-#ifdef CRC_DEBUG
-          printf("crc::check crc16 syndrome = 0x%x\n",crc16Syndrome);
-#endif
-          dataSyndrome16_t ds16;
-          ds16.lastBytes[1] = dPtr[N-1];
-          ds16.lastBytes[0] = dPtr[N-2];
-#ifdef CRC_DEBUG
-          printf("crc::check data syndrome  = 0x%x\n",ds16.syndrome16);
-#endif
-          if (crc16Syndrome == ds16.syndrome16)
-          {
-            pdu.m_payload.pop_back();
-            pdu.m_payload.pop_back();
-          } else
-            throw std::runtime_error("CRC16 check failed.");
-          break;
-        case CRC_32_BITS:
-          m_crc32Impl.reset ();
-          m_crc32Impl.process_bytes(dPtr, N-sizeof(crc32Syndrome));
-          crc32Syndrome = m_crc32Impl.checksum();
-#ifdef CRC_DEBUG
-          printf("crc::check crc32 syndrome = 0x%x\n",crc32Syndrome);
-#endif
-          dataSyndrome32_t ds32;
-          ds32.lastBytes[3] = dPtr[N-1];
-          ds32.lastBytes[2] = dPtr[N-2];
-          ds32.lastBytes[1] = dPtr[N-3];
-          ds32.lastBytes[0] = dPtr[N-4];
-#ifdef CRC_DEBUG
-          printf("crc::check data syndrome  = 0x%x\n",ds32.syndrome32);
-#endif
-          if (crc32Syndrome == ds32.syndrome32)
-          {
-            pdu.m_payload.pop_back();
-            pdu.m_payload.pop_back();
-            pdu.m_payload.pop_back();
-            pdu.m_payload.pop_back();
-          } else
-            throw std::runtime_error("CRC16 check failed.");
+        case CRC_PASS:
+          pdu.m_payload.resize(pdu.payloadLength() - crcSize / 8);
           break;
+        case CRC_FAIL:
+          throw std::runtime_error(crcSize == CRC_16_BITS ?
+            "CRC16 check failed." : "CRC32 check failed.");
+        case CRC_TOO_SHORT:
+          throw std::runtime_error("CRC check failed; PDU shorter than the CRC.");
         default:
           break;
       }
     }
 
-  } /* namespace darkstar */
-} /* namespace xiphos */
+    crc::Context::Context(crc_size_t crcSize) :
+        m_crcSize(crcSize),
+        m_state(crcSize == CRC_16_BITS ? CRC16ARC::INITIAL : CRC32::INITIAL),
+        m_length(0)
+    {
+    }
+
+    void crc::Context::update(const uint8_t *data, size_t length)
+    {
+      if (m_crcSize == CRC_16_BITS)
+        m_state = CRC16ARC::update(m_state, data, length);
+      else
+        m_state = CRC32::update(m_state, data, length);
+      m_length += length;
+    }
+
+    void crc::Context::update(const PPDU_u8 &fragment)
+    {
+      update(fragment.getPayload().data(), fragment.payloadLength());
+    }
+
+    void crc::Context::combine(const Context &next)
+    {
+      if (next.m_crcSize != m_crcSize)
+        throw std::runtime_error("crc::Context::combine: CRC sizes differ.");
+      if (m_crcSize == CRC_16_BITS)
+        m_state = CRC16ARC::combine(m_state, next.m_state, next.m_length);
+      else
+        m_state = CRC32::combine(m_state, next.m_state, next.m_length);
+      m_length += next.m_length;
+    }
+
+    uint32_t crc::Context::checksum() const
+    {
+      if (m_crcSize == CRC_16_BITS)
+        return CRC16ARC::finish(m_state);
+      return CRC32::finish(m_state);
+    }
+
+    bool crc::Context::matches(const uint8_t *trailer) const
+    {
+      return trailerSyndrome(trailer, m_crcSize) == checksum();
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
@@ -0,0 +1,121 @@
+/*!
+ * @file crc_engine.cpp
+ * @author Steven Knudsen
+ * @date June 23, 2021
+ *
+ * @details Carry-less multiplication folding kernel for the CRC engine.
+ *
+ * Only the kernel is built for PCLMULQDQ; it is used only if the CPU reports
+ * it at run time. Other CPUs use the slicing-by-8 tables for everything.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include "crc_engine.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC_ENGINE_X86 1
+#endif
+
+namespace ex2 {
+  namespace sdr {
+
+#ifdef CRC_ENGINE_X86
+
+#pragma GCC push_options
+#pragma GCC target("pclmul,ssse3")
+
+    /*!
+     * @brief Multiply each half of @p a by its constant in @p k and add the
+     * products to @p b
+     */
+    static inline __m128i
+    fold(__m128i a, __m128i k, __m128i b)
+    {
+      return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x00),
+        _mm_clmulepi64_si128(a, k, 0x11)), b);
+    }
+
+    /*!
+     * @details Each block is loaded so that bit i of the 128 bit value is
+     * the coefficient of x^(127 - i) if reflected, or of x^i otherwise, which
+     * for the latter means reversing the bytes.
+     */
+    static void
+    crcFoldCLMUL(const CRCFoldConstants &constants, bool reflected,
+      const uint8_t *first, const uint8_t *data, size_t numBlocks, uint8_t *out)
+    {
+      const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+      auto load = [&](const uint8_t *p) {
+        __m128i v = _mm_loadu_si128((const __m128i *) p);
+        return reflected ? v : _mm_shuffle_epi8(v, reverse);
+      };
+      const __m128i k512 = _mm_loadu_si128((const __m128i *) constants.fold512);
+      const __m128i k128 = _mm_loadu_si128((const __m128i *) constants.fold128);
+
+      __m128i acc = load(first);
+
+      // Four independent streams of blocks, so the multiplications overlap
+      if (numBlocks >= 7) {
+        __m128i acc1 = load(data);
+        __m128i acc2 = load(data + 16);
+        __m128i acc3 = load(data + 32);
+        data += 48;
+        numBlocks -= 3;
+        for (; numBlocks >= 4; data += 64, numBlocks -= 4) {
+          acc = fold(acc, k512, load(data));
+          acc1 = fold(acc1, k512, load(data + 16));
+          acc2 = fold(acc2, k512, load(data + 32));
+          acc3 = fold(acc3, k512, load(data + 48));
+        }
+        acc = fold(acc, k128, acc1);
+        acc = fold(acc, k128, acc2);
+        acc = fold(acc, k128, acc3);
+      }
+
+      for (; numBlocks > 0; data += 16, numBlocks--)
+        acc = fold(acc, k128, load(data));
+
+      if (!reflected)
+        acc = _mm_shuffle_epi8(acc, reverse);
+      _mm_storeu_si128((__m128i *) out, acc);
+    }
+
+#pragma GCC pop_options
+
+#endif /* CRC_ENGINE_X86 */
+
+    bool
+    crcFoldAvailable()
+    {
+#ifdef CRC_ENGINE_X86
+      static const bool available = __builtin_cpu_supports("pclmul") &&
+        __builtin_cpu_supports("ssse3");
+      return available;
+#else
+      return false;
+#endif
+    }
+
+    void
+    crcFold(const CRCFoldConstants &constants, bool reflected,
+      const uint8_t *first, const uint8_t *data, size_t numBlocks, uint8_t *out)
+    {
+#ifdef CRC_ENGINE_X86
+      crcFoldCLMUL(constants, reflected, first, data, numBlocks, out);
+#else
+      (void) constants;
+      (void) reflected;
+      (void) first;
+      (void) data;
+      (void) numBlocks;
+      (void) out;
+#endif
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
@@ -36,19 +36,20 @@ namespace ex2 {
     ErrorCorrection::ErrorCorrection(ErrorCorrectionScheme scheme) :
     m_errorCorrectionScheme(scheme)
     {
-      if (scheme < ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2 ||
+      if (scheme < ErrorCorrection::ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280 ||
           scheme > ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_5_6) {
         throw ECException("Invalid FEC Scheme");
       }
       m_codingRate = m_getCodingRate(scheme);
-      if (m_codingRate != ErrorCorrection::CodingRate::RATE_NA) {
+      if (m_codingRate == ErrorCorrection::CodingRate::RATE_NA) {
         throw ECException("Invalid FEC Scheme; no rate known");
       }
 
       m_rate = 1.0;
       m_rate = m_codingRateToFractionalRate();
       m_codewordLen = m_ErrorCorrectionCodingToCodewordLen();
-      m_messageLen = (uint32_t) ((double) m_codewordLen * m_rate);
+      // Round rather than truncate; 1536 * (2/3) is a hair under 1024
+      m_messageLen = (uint32_t) ((double) m_codewordLen * m_rate + 0.5);
     }
 
     ErrorCorrection::~ErrorCorrection() {
@@ -159,10 +160,10 @@ namespace ex2 {
           return std::string("CCSDS Turbo rate n=7136 1/6");
           break;
         case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280:
-          return std::string("CCSDS Orange Book LDPC n=1288");
+          return std::string("CCSDS Orange Book LDPC n=1280");
           break;
-        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1356:
-          return std::string("CCSDS Orange Book LDPC n=1356");
+        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1536:
+          return std::string("CCSDS Orange Book LDPC n=1536");
           break;
         case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_2048:
           return std::string("CCSDS Orange Book LDPC n=2048");
@@ -302,10 +303,10 @@ namespace ex2 {
           codewordLen = 7136;
           break;
         case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280:
-          codewordLen = 1288;
+          codewordLen = 1280;
           break;
-        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1356:
-          codewordLen = 1356;
+        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1536:
+          codewordLen = 1536;
           break;
         case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_2048:
           codewordLen = 2048;
@@ -357,6 +358,7 @@ namespace ex2 {
         case ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2:
         case ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1296_R_1_2:
         case ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_1_2:
+        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_2048:
           r = ErrorCorrection::CodingRate::RATE_1_2;
           break;
 
@@ -382,6 +384,7 @@ namespace ex2 {
         case ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_2_3:
         case ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1296_R_2_3:
         case ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_2_3:
+        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1536:
           r = ErrorCorrection::CodingRate::RATE_2_3;
           break;
 
@@ -399,6 +402,10 @@ namespace ex2 {
           r = ErrorCorrection::CodingRate::RATE_5_6;
           break;
 
+        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280:
+          r = ErrorCorrection::CodingRate::RATE_4_5;
+          break;
+
         case ErrorCorrectionScheme::CONVOLUTIONAL_CODING_R_7_8:
           r = ErrorCorrection::CodingRate::RATE_7_8;
           break;
@@ -415,9 +422,6 @@ namespace ex2 {
         case ErrorCorrectionScheme::REED_SOLOMON_255_223_INTERLEAVING_4:
         case ErrorCorrectionScheme::REED_SOLOMON_255_223_INTERLEAVING_5:
         case ErrorCorrectionScheme::REED_SOLOMON_255_223_INTERLEAVING_8:
-        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280: // TODO check for rate
-        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1356: // TODO check for rate
-        case ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_2048: // TODO check for rate
         case ErrorCorrectionScheme::NO_FEC:
           r = ErrorCorrection::CodingRate::RATE_NA;
           break;
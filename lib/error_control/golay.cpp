@@ -25,8 +25,16 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <math.h>
+#include <string.h>
+
 #include "golay.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GOLAY_X86 1
+#endif
+
 
 /* Encoding matrix, H
 
@@ -51,15 +59,11 @@
    Looking down the first column, we see that if MC1 is set, we toggle bits
    1,3,5,6,7,11,12 of the parity: in binary, 110001110101 = 0xE3A
 
-   Similarly, to calculate the inverse, we read across the top of the table and
-   see that P1 is affected by bits MC1,MC2,MC3,MC4,MPL1,MPL4,MPL7: in binary,
-   111110010010 = 0x49F.
-
-   I've seen cunning implementations of this which only use one table. That
-   technique doesn't seem to work with these numbers though.
+   The encoder uses a table of the parity bits of every data word, built from
+   this matrix below.
 */
 
-static const uint16_t golay_encode_matrix[12] = {
+static constexpr uint16_t golay_encode_matrix[12] = {
     0xC75,
     0x49F,
     0xD4B,
@@ -74,167 +78,92 @@ static const uint16_t golay_encode_matrix[12] = {
     0xE3A,
 };
 
-static const uint16_t golay_decode_matrix[12] = {
-   0x49F,
-   0x93E,
-   0x6E3,
-   0xDC6,
-   0xF13,
-   0xAB9,
-   0x1ED,
-   0x3DA,
-   0x7B4,
-   0xF68,
-   0xA4F,
-   0xC75,
-};
+/* Decoding tables
 
+   The syndrome of a received codeword r = u ^ e depends only on the error
+   pattern e:
 
+     s = (parity of r) ^ golay_coding(data of r) = (parity of e) ^ golay_coding(data of e)
 
-/* Function to compute the Hamming weight of a 12-bit integer */
-static uint16_t weight12(uint16_t vector)
-{
-    uint16_t w=0;
-    uint16_t i;
-    for( i=0; i<12; i++ )
-	if( vector & 1<<i )
-	    w++;
-    return w;
-}
+   The code has minimum distance 8, so every error pattern of weight 3 or
+   less has a syndrome of its own. There are 1 + 24 + 276 + 2024 = 2325 of
+   them; the other 1771 of the 4096 syndromes come from patterns of weight 4
+   or more, and are uncorrectable. A table of the error pattern for each
+   syndrome then decodes with two loads, one for the encoding of the received
+   data and one for the errors.
+
+   The tables are built by the compiler from golay_encode_matrix.
 
-/* returns the golay coding of the given 12-bit word */
-static uint16_t golay_coding(uint16_t w)
+   The coding is linear, so it is also the XOR of the codings of the three
+   nibbles of the data word. The SIMD code looks those up 16 or 32 at a time
+   with byte shuffles, from the low byte and the high 4 bits of the coding of
+   each nibble value.
+*/
+
+struct golay_tables {
+    uint16_t coding[4096];      /* parity bits of each 12-bit data word */
+    int32_t errors[4096];       /* error pattern of each syndrome, or -1 */
+    uint8_t nibble_low[3][16];  /* low byte of the coding of nibble n<<4k */
+    uint8_t nibble_high[3][16]; /* high 4 bits of the coding of nibble n<<4k */
+};
+
+static constexpr uint16_t golay_coding_slow(uint16_t w)
 {
     uint16_t out=0;
-    uint16_t i;
-
-    for( i = 0; i<12; i++ ) {
+    for( uint16_t i = 0; i<12; i++ ) {
 	if( w & 1<<i )
 	    out ^= golay_encode_matrix[i];
     }
     return out;
 }
 
-/* encodes a 12-bit word to a 24-bit codeword */
-uint32_t golay_encode(uint16_t w)
+static constexpr golay_tables golay_make_tables()
 {
-    return ((uint32_t)w) | ((uint32_t)golay_coding(w))<<12;
-}
+    golay_tables t = {};
 
+    for( uint32_t w = 0; w<4096; w++ ) {
+	t.coding[w] = golay_coding_slow((uint16_t)w);
+	t.errors[w] = -1;
+    }
+    for( uint32_t k = 0; k<3; k++ )
+	for( uint32_t n = 0; n<16; n++ ) {
+	    t.nibble_low[k][n] = (uint8_t)(t.coding[n<<(4*k)] & 0xff);
+	    t.nibble_high[k][n] = (uint8_t)(t.coding[n<<(4*k)]>>8);
+	}
 
+    /* every error pattern of up to three bits, as bit positions a < b < c;
+     * a position of 24 stands for no error */
+    for( uint32_t a = 0; a<=24; a++ )
+	for( uint32_t b = a+1; b<=25; b++ )
+	    for( uint32_t c = b+1; c<=26; c++ ) {
+		uint32_t error = 0;
+		if( a < 24 ) error |= 1u<<a;
+		if( b < 24 ) error |= 1u<<b;
+		if( c < 24 ) error |= 1u<<c;
+		uint16_t syndrome = (uint16_t)(error>>12) ^ t.coding[error & 0xfff];
+		t.errors[syndrome] = (int32_t)error;
+	    }
+    return t;
+}
 
-/* returns the golay coding of the given 12-bit word */
-static uint16_t golay_decoding(uint16_t w)
-{
-    uint16_t out=0;
-    uint16_t i;
+static constexpr golay_tables golay_table = golay_make_tables();
 
-    for( i = 0; i<12; i++ ) {
-	if( w & 1<<(i) )
-	    out ^= golay_decode_matrix[i];
-    }
-    return out;
+/* encodes a 12-bit word to a 24-bit codeword */
+uint32_t golay_encode(uint16_t w)
+{
+    return ((uint32_t)w) | ((uint32_t)golay_table.coding[w & 0xfff])<<12;
 }
 
-
 /* return a mask showing the bits which are in error in a received
- * 24-bit codeword, or -1 if 4 errors were detected.
+ * 24-bit codeword, or -1 if 4 errors were detected. Bits above the 24th
+ * are ignored.
  */
 int32_t golay_errors(uint32_t codeword)
 {
-    uint16_t received_data, received_parity;
-    uint16_t syndrome;
-    uint16_t w,i;
-    uint16_t inv_syndrome = 0;
-
-    received_parity = (uint16_t)(codeword>>12);
-    received_data   = (uint16_t)codeword & 0xfff;
-
-    /* We use the C notation ^ for XOR to represent addition modulo 2.
-     *
-     * Model the received codeword (r) as the transmitted codeword (u)
-     * plus an error vector (e).
-     *
-     *   r = e ^ u
-     *
-     * Then we calculate a syndrome (s):
-     *
-     *   s = r * H, where H = [ P   ], where I12 is the identity matrix
-     *                        [ I12 ]
-     *
-     * (In other words, we calculate the parity check for the received
-     * data bits, and add them to the received parity bits)
-     */
-
-    syndrome = received_parity ^ (golay_coding(received_data));
-    w = weight12(syndrome);
-    
-    /*
-     * The properties of the golay code are such that the Hamming distance (ie,
-     * the minimum distance between codewords) is 8; that means that one bit of
-     * error in the data bits will cause 7 errors in the parity bits.
-     *
-     * In particular, if we find 3 or fewer errors in the parity bits, either:
-     *  - there are no errors in the data bits, or
-     *  - there are at least 5 errors in the data bits
-     * we hope for the former (we don't profess to deal with the
-     * latter).
-     */
-    if( w <= 3 ) {
-	return ((int32_t) syndrome)<<12;
-    }
-    
-    /* the next thing to try is one error in the data bits.
-     * we try each bit in turn and see if an error in that bit would have given
-     * us anything like the parity bits we got. At this point, we tolerate two
-     * errors in the parity bits, but three or more errors would give a total
-     * error weight of 4 or more, which means it's actually uncorrectable or
-     * closer to another codeword. */
-     
-    for( i = 0; i<12; i++ ) {
-	uint16_t error = 1<<i;
-	uint16_t coding_error = golay_encode_matrix[i];
-	if( weight12(syndrome^coding_error) <= 2 ) {
-	    return (int32_t)((((uint32_t)(syndrome^coding_error))<<12) | (uint32_t)error) ;
-	}
-    }
-
-    /* okay then, let's see whether the parity bits are error free, and all the
-     * errors are in the data bits. model this as follows:
-     *
-     * [r | pr] = [u | pu] + [e | 0]
-     *
-     * pr = pu
-     * pu = H * u => u = H' * pu = H' * pr , where H' is inverse of H
-     *
-     * we already have s = H*r + pr, so pr = s - H*r = s ^ H*r
-     * e = u ^ r
-     *   = (H' * ( s ^ H*r )) ^ r
-     *   = H'*s ^ r ^ r
-     *   = H'*s
-     *
-     * Once again, we accept up to three error bits...
-     */
-
-    inv_syndrome = golay_decoding(syndrome);
-    w = weight12(inv_syndrome);
-    if( w <=3 ) {
-	return (int32_t)inv_syndrome;
-    }
+    uint16_t received_parity = (uint16_t)(codeword>>12) & 0xfff;
+    uint16_t received_data   = (uint16_t)codeword & 0xfff;
 
-    /* Final shot: try with 2 errors in the data bits, and 1 in the parity
-     * bits; as before we try each of the bits in the parity in turn */
-    for( i = 0; i<12; i++ ) {
-	uint16_t error = 1<<i;
-	uint16_t coding_error = golay_decode_matrix[i];
-	if( weight12(inv_syndrome^coding_error) <= 2 ) {
-	    uint32_t error_word = ((uint32_t)(inv_syndrome^coding_error)) | ((uint32_t)error)<<12;
-	    return (int32_t)error_word;
-	}
-    }
-
-    /* uncorrectable error */
-    return -1;
+    return golay_table.errors[received_parity ^ golay_table.coding[received_data]];
 }
     
 
@@ -254,3 +183,305 @@ int16_t golay_decode(uint32_t w)
     data_errors = (uint16_t)errors & 0xfff;
     return (int16_t)(data ^ data_errors);
 }
+
+
+
+/* maximum likelihood soft decoding.
+ *
+ * The correlation of codeword c with the samples r is the sum of r_i over
+ * the 1 bits of c less the sum over the 0 bits, i.e. twice the sum over the
+ * 1 bits less a constant. Tables of that sum for every value of each byte
+ * of the codeword then give each codeword's metric in three loads, rather
+ * than 24 multiply-adds.
+ */
+
+/* sums[256*k + b] is the sum of the samples of the 1 bits of b as byte k of
+ * a codeword */
+static void golay_soft_sums(const float *samples, float *sums)
+{
+    float nibbles[6][16];
+
+    /* nibble k holds codeword bits 4k to 4k+3; bit i is sample 23-i */
+    for( uint32_t k = 0; k<6; k++ ) {
+	const float *r = samples + 20 - 4*k;
+	for( uint32_t n = 0; n<16; n++ )
+	    nibbles[k][n] = ((n & 1) ? r[3] : 0.0f) + ((n & 2) ? r[2] : 0.0f) +
+			    ((n & 4) ? r[1] : 0.0f) + ((n & 8) ? r[0] : 0.0f);
+    }
+    for( uint32_t k = 0; k<3; k++ )
+	for( uint32_t b = 0; b<256; b++ )
+	    sums[256*k + b] = nibbles[2*k][b & 0x0f] + nibbles[2*k+1][b>>4];
+}
+
+/* the best of 8 interleaved sets of codewords; ties go to the smaller data
+ * word */
+static uint16_t golay_soft_best(const float *best, const uint32_t *best_word)
+{
+    uint32_t b = 0;
+    for( uint32_t j = 1; j<8; j++ )
+	if( best[j] > best[b] || (best[j] == best[b] && best_word[j] < best_word[b]) )
+	    b = j;
+    return (uint16_t)best_word[b];
+}
+
+static uint16_t golay_decode_soft_scalar(const float *sums)
+{
+    /* keep 8 candidates so that the comparisons do not wait on each other */
+    float best[8];
+    uint32_t best_word[8];
+    for( uint32_t j = 0; j<8; j++ ) {
+	best[j] = -HUGE_VALF;
+	best_word[j] = j;
+    }
+    for( uint32_t w = 0; w<4096; w += 8 )
+	for( uint32_t j = 0; j<8; j++ ) {
+	    uint32_t c = (w+j) | ((uint32_t)golay_table.coding[w+j])<<12;
+	    float metric = sums[c & 0xff] + sums[256 + ((c>>8) & 0xff)] + sums[512 + (c>>16)];
+	    if( metric > best[j] ) {
+		best[j] = metric;
+		best_word[j] = w+j;
+	    }
+	}
+    return golay_soft_best(best, best_word);
+}
+
+/* Bulk encoding and decoding; see golay.h for the buffer layouts. The
+ * scalar versions do any number of words, and the words left over by the
+ * SIMD versions.
+ */
+
+static void golay_encode_bulk_scalar(const uint8_t *data, uint32_t num_words,
+    uint8_t *codewords)
+{
+    for( uint32_t i = 0; i<num_words; i++ ) {
+	const uint8_t *d = data + 3*(i/2);
+	uint16_t w = (i & 1) ? (uint16_t)(((d[1] & 0x0f)<<8) | d[2])
+			     : (uint16_t)((d[0]<<4) | (d[1]>>4));
+	uint32_t codeword = golay_encode(w);
+	codewords[3*i]   = (uint8_t)(codeword>>16);
+	codewords[3*i+1] = (uint8_t)(codeword>>8);
+	codewords[3*i+2] = (uint8_t)codeword;
+    }
+}
+
+static uint32_t golay_decode_bulk_scalar(const uint8_t *codewords, uint32_t num_words,
+    uint8_t *data)
+{
+    uint32_t uncorrectable = 0;
+
+    for( uint32_t i = 0; i<num_words; i++ ) {
+	const uint8_t *c = codewords + 3*i;
+	uint32_t received = ((uint32_t)c[0]<<16) | ((uint32_t)c[1]<<8) | c[2];
+	int32_t errors = golay_errors(received);
+	if( errors < 0 ) {
+	    uncorrectable++;
+	    errors = 0;
+	}
+	uint16_t w = (uint16_t)((received ^ (uint32_t)errors) & 0xfff);
+
+	uint8_t *d = data + 3*(i/2);
+	if( i & 1 ) {
+	    d[1] = (uint8_t)((d[1] & 0xf0) | (w>>8));
+	    d[2] = (uint8_t)w;
+	} else {
+	    d[0] = (uint8_t)(w>>4);
+	    d[1] = (uint8_t)((w & 0x0f)<<4);
+	}
+    }
+    return uncorrectable;
+}
+
+#ifdef GOLAY_X86
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+/* the parity bits of the 12-bit words in the 32-bit lanes of w, by nibble
+ * table lookups; the upper bytes of each lane index entry 0, which is 0 */
+static inline __m256i golay_coding_avx2(__m256i w)
+{
+    const __m256i nibble = _mm256_set1_epi32(0x0f);
+    __m256i n0 = _mm256_and_si256(w, nibble);
+    __m256i n1 = _mm256_and_si256(_mm256_srli_epi32(w, 4), nibble);
+    __m256i n2 = _mm256_and_si256(_mm256_srli_epi32(w, 8), nibble);
+
+#define GOLAY_TABLE(t) _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(t)))
+    __m256i low = _mm256_xor_si256(
+	_mm256_xor_si256(_mm256_shuffle_epi8(GOLAY_TABLE(golay_table.nibble_low[0]), n0),
+			 _mm256_shuffle_epi8(GOLAY_TABLE(golay_table.nibble_low[1]), n1)),
+	_mm256_shuffle_epi8(GOLAY_TABLE(golay_table.nibble_low[2]), n2));
+    __m256i high = _mm256_xor_si256(
+	_mm256_xor_si256(_mm256_shuffle_epi8(GOLAY_TABLE(golay_table.nibble_high[0]), n0),
+			 _mm256_shuffle_epi8(GOLAY_TABLE(golay_table.nibble_high[1]), n1)),
+	_mm256_shuffle_epi8(GOLAY_TABLE(golay_table.nibble_high[2]), n2));
+#undef GOLAY_TABLE
+
+    return _mm256_or_si256(low, _mm256_slli_epi32(high, 8));
+}
+
+/* stores the low three bytes of each 32-bit lane, most significant first */
+static inline void golay_store24_avx2(uint8_t *out, __m256i v)
+{
+    const __m256i order = _mm256_setr_epi8(
+	2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    v = _mm256_shuffle_epi8(v, order);
+    __m128i low = _mm256_castsi256_si128(v);
+    __m128i high = _mm256_extracti128_si256(v, 1);
+    uint32_t tail;
+
+    _mm_storel_epi64((__m128i *)out, low);
+    tail = (uint32_t)_mm_extract_epi32(low, 2);
+    memcpy(out + 8, &tail, 4);
+    _mm_storel_epi64((__m128i *)(out + 12), high);
+    tail = (uint32_t)_mm_extract_epi32(high, 2);
+    memcpy(out + 20, &tail, 4);
+}
+
+/* encodes whole groups of 8 words while 16 data bytes can be read, and
+ * returns the number of words done */
+static uint32_t golay_encode_bulk_avx2(const uint8_t *data, uint32_t num_words,
+    uint8_t *codewords)
+{
+    /* word pairs 0 and 1 into the low lane, 2 and 3 into the high lane, as
+     * b0 b1 (even words, shifted down 4) and b1 b2 (odd words) */
+    const __m256i unpack = _mm256_setr_epi8(
+	1, 0, -1, -1, 2, 1, -1, -1, 4, 3, -1, -1, 5, 4, -1, -1,
+	7, 6, -1, -1, 8, 7, -1, -1, 10, 9, -1, -1, 11, 10, -1, -1);
+    const __m256i shift = _mm256_setr_epi32(4, 0, 4, 0, 4, 0, 4, 0);
+    const __m256i mask12 = _mm256_set1_epi32(0xfff);
+    uint32_t i = 0;
+
+    for( ; i + 11 <= num_words; i += 8 ) {
+	__m256i bytes = _mm256_broadcastsi128_si256(
+	    _mm_loadu_si128((const __m128i *)(data + 3*(i/2))));
+	__m256i w = _mm256_and_si256(
+	    _mm256_srlv_epi32(_mm256_shuffle_epi8(bytes, unpack), shift), mask12);
+	__m256i codeword = _mm256_or_si256(w, _mm256_slli_epi32(golay_coding_avx2(w), 12));
+	golay_store24_avx2(codewords + 3*i, codeword);
+    }
+    return i;
+}
+
+/* decodes whole groups of 8 words, and returns the number of words done;
+ * the uncorrectable words are added to *uncorrectable */
+static uint32_t golay_decode_bulk_avx2(const uint8_t *codewords, uint32_t num_words,
+    uint8_t *data, uint32_t *uncorrectable)
+{
+    /* the 24 codeword bytes are loaded as bytes 0-15 and 8-23; words 0-3
+     * start at byte 0 of the low lane and words 4-7 at byte 4 of the high */
+    const __m256i unpack = _mm256_setr_epi8(
+	2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+	6, 5, 4, -1, 9, 8, 7, -1, 12, 11, 10, -1, 15, 14, 13, -1);
+    const __m256i mask12 = _mm256_set1_epi32(0xfff);
+    uint32_t i = 0;
+
+    for( ; i + 8 <= num_words; i += 8 ) {
+	const uint8_t *c = codewords + 3*i;
+	__m256i bytes = _mm256_inserti128_si256(
+	    _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)c)),
+	    _mm_loadu_si128((const __m128i *)(c + 8)), 1);
+	__m256i received = _mm256_shuffle_epi8(bytes, unpack);
+	__m256i w = _mm256_and_si256(received, mask12);
+	__m256i syndrome = _mm256_xor_si256(_mm256_srli_epi32(received, 12),
+					    golay_coding_avx2(w));
+	__m256i errors = _mm256_i32gather_epi32((const int *)golay_table.errors, syndrome, 4);
+
+	/* uncorrectable words keep the received data bits */
+	__m256i bad = _mm256_srai_epi32(errors, 31);
+	*uncorrectable += (uint32_t)__builtin_popcount(
+	    (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(bad)));
+	w = _mm256_and_si256(_mm256_xor_si256(w, _mm256_andnot_si256(bad, errors)), mask12);
+
+	/* even word << 12 | odd word in the low 3 bytes of each even lane */
+	__m256i pairs = _mm256_or_si256(_mm256_slli_epi64(w, 12), _mm256_srli_epi64(w, 32));
+	const __m256i order = _mm256_setr_epi8(
+	    2, 1, 0, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	    2, 1, 0, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	pairs = _mm256_shuffle_epi8(pairs, order);
+	uint8_t *d = data + 3*(i/2);
+	uint64_t low, high;
+	_mm_storel_epi64((__m128i *)&low, _mm256_castsi256_si128(pairs));
+	_mm_storel_epi64((__m128i *)&high, _mm256_extracti128_si256(pairs, 1));
+	memcpy(d, &low, 6);
+	memcpy(d + 6, &high, 6);
+    }
+    return i;
+}
+
+
+/* golay_decode_soft_scalar with the 8 candidates in the lanes of a vector */
+static uint16_t golay_decode_soft_avx2(const float *sums)
+{
+    const __m256i mask8 = _mm256_set1_epi32(0xff);
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256i w = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 best = _mm256_set1_ps(-HUGE_VALF);
+    __m256i best_word = w;
+
+    for( uint32_t i = 0; i<4096; i += 8 ) {
+	__m256i coding = _mm256_cvtepu16_epi32(
+	    _mm_loadu_si128((const __m128i *)(golay_table.coding + i)));
+	__m256i c = _mm256_or_si256(w, _mm256_slli_epi32(coding, 12));
+	__m256 metric = _mm256_add_ps(
+	    _mm256_add_ps(_mm256_i32gather_ps(sums, _mm256_and_si256(c, mask8), 4),
+			  _mm256_i32gather_ps(sums + 256,
+					      _mm256_and_si256(_mm256_srli_epi32(c, 8), mask8), 4)),
+	    _mm256_i32gather_ps(sums + 512, _mm256_srli_epi32(c, 16), 4));
+	__m256 better = _mm256_cmp_ps(metric, best, _CMP_GT_OQ);
+	best = _mm256_blendv_ps(best, metric, better);
+	best_word = _mm256_blendv_epi8(best_word, w, _mm256_castps_si256(better));
+	w = _mm256_add_epi32(w, step);
+    }
+
+    float b[8];
+    uint32_t bw[8];
+    _mm256_storeu_ps(b, best);
+    _mm256_storeu_si256((__m256i *)bw, best_word);
+    return golay_soft_best(b, bw);
+}
+
+#pragma GCC pop_options
+
+static bool golay_has_avx2(void)
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif /* GOLAY_X86 */
+
+void golay_encode_bulk(const uint8_t *data, uint32_t num_words,
+    uint8_t *codewords)
+{
+    uint32_t done = 0;
+#ifdef GOLAY_X86
+    if( golay_has_avx2() )
+	done = golay_encode_bulk_avx2(data, num_words, codewords);
+#endif
+    golay_encode_bulk_scalar(data + 3*(done/2), num_words - done, codewords + 3*done);
+}
+
+uint32_t golay_decode_bulk(const uint8_t *codewords, uint32_t num_words,
+    uint8_t *data)
+{
+    uint32_t done = 0;
+    uint32_t uncorrectable = 0;
+#ifdef GOLAY_X86
+    if( golay_has_avx2() )
+	done = golay_decode_bulk_avx2(codewords, num_words, data, &uncorrectable);
+#endif
+    return uncorrectable +
+	golay_decode_bulk_scalar(codewords + 3*done, num_words - done, data + 3*(done/2));
+}
+
+uint16_t golay_decode_soft(const float *samples)
+{
+    float sums[768];
+    golay_soft_sums(samples, sums);
+#ifdef GOLAY_X86
+    if( golay_has_avx2() )
+	return golay_decode_soft_avx2(sums);
+#endif
+    return golay_decode_soft_scalar(sums);
+}
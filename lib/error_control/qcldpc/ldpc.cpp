@@ -11,8 +11,15 @@
  * This software may not be modified or distributed in any form, except as described in the LICENSE file.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
 #include <iostream>
+#include <limits>
 #include <stdio.h>
+#include <thread>
 #include <vector>
 #include <eigen3/Eigen/Dense>
 #include <boost/format.hpp>
@@ -20,15 +27,16 @@
 #include <boost/random/normal_distribution.hpp>
 
 #include "ldpc.h"
+#include "ldpc_kernel.h"
 #include "parity_check.h"
 
 #define LDPC_DEBUG 0
 #define LDPC_DEBUG_VERBOSE 0
 #define LDPC_DEBUG_SAMPLES_TO_PRINT 30
 
-namespace xiphos
+namespace ex2
 {
-  namespace darkstar
+  namespace sdr
   {
 
     class LDPCException: public std::exception {
@@ -43,38 +51,153 @@ namespace xiphos
 
     LDPCException::LDPCException(const std::string& message) : message_(message) { }
 
+    /*!
+     * @brief Track the unsatisfied check node count of a codeword from
+     * iteration to iteration.
+     *
+     * @param[in] stallIterations Iterations allowed without a new smallest
+     * count; 0 never stalls
+     * @param[in] unsatisfied The count after this iteration
+     * @param[in,out] best The smallest count so far
+     * @param[in,out] stalled Iterations since @p best last went down
+     * @return true if decoding should stop
+     */
+    static inline bool
+    decodeStalled(uint32_t stallIterations, uint32_t unsatisfied,
+        uint32_t &best, uint32_t &stalled)
+    {
+      if (unsatisfied < best) {
+        best = unsatisfied;
+        stalled = 0;
+        return false;
+      }
+      return stallIterations != 0 && ++stalled >= stallIterations;
+    }
+
+    /*
+     * Packed Z bit blocks for encodeQC. Bit t of a block is bit 63 - t % 64
+     * of word t / 64, so that blocks map straight onto a most significant bit
+     * first byte stream. Bits past Z are kept zero.
+     */
+
+    /*!
+     * @brief Read the Z bits starting at bit @p offset of a byte stream.
+     *
+     * @note The stream must have 8 readable bytes past the last bit read.
+     */
+    static inline void
+    readBlock(const uint8_t *bytes, uint64_t offset, uint32_t Z, uint64_t *block)
+    {
+      for (uint32_t w = 0; w * 64 < Z; w++)
+      {
+        uint64_t bit = offset + w * 64;
+        const uint8_t *b = bytes + bit / 8;
+        uint32_t shift = bit % 8;
+        uint64_t v = 0;
+        for (uint32_t i = 0; i < 8; i++)
+          v = (v << 8) | b[i];
+        if (shift)
+          v = (v << shift) | (b[8] >> (8 - shift));
+        if (Z - w * 64 < 64)
+          v &= ~0ull << (64 - (Z - w * 64));
+        block[w] = v;
+      }
+    }
+
+    /*!
+     * @brief OR a block into a zeroed byte stream starting at bit @p offset.
+     *
+     * @note The stream must have 8 writable bytes past the last bit written.
+     */
+    static inline void
+    writeBlock(uint8_t *bytes, uint64_t offset, uint32_t Z, const uint64_t *block)
+    {
+      for (uint32_t w = 0; w * 64 < Z; w++)
+      {
+        uint64_t bit = offset + w * 64;
+        uint8_t *b = bytes + bit / 8;
+        uint32_t shift = bit % 8;
+        uint64_t v = block[w];
+        for (uint32_t i = 0; i < 8; i++)
+          b[i] |= (uint8_t) (v >> (56 + shift - 8 * i));
+        if (shift)
+          b[8] |= (uint8_t) (v << (8 - shift));
+      }
+    }
+
+    /*!
+     * @brief XOR the circulant with shift @p shift times block @p x into
+     * @p y, i.e., y[t] ^= x[(t + shift) % Z], as for the decoders' circulants.
+     *
+     * @details That is a left rotation of the Z bits, done as a left shift
+     * by @p shift and a right shift by Z - @p shift of the multiword block.
+     */
+    static inline void
+    rotateXorBlock(const uint64_t *x, uint32_t Z, uint32_t words, uint32_t shift,
+        uint64_t *y)
+    {
+      uint32_t q = shift / 64;
+      uint32_t r = shift % 64;
+      for (uint32_t w = 0; w + q < words; w++)
+      {
+        uint64_t v = x[w + q] << r;
+        if (r && w + q + 1 < words)
+          v |= x[w + q + 1] >> (64 - r);
+        y[w] ^= v;
+      }
+
+      shift = Z - shift;
+      q = shift / 64;
+      r = shift % 64;
+      for (uint32_t w = q; w < words; w++)
+      {
+        uint64_t v = x[w - q] >> r;
+        if (r && w > q)
+          v |= x[w - q - 1] << (64 - r);
+        y[w] ^= v;
+      }
+      if (words * 64 > Z)
+        y[words - 1] &= ~0ull << (words * 64 - Z);
+    }
+
+    LDPC::LDPC (
+        bool testMode,
+        ErrorCorrection::ErrorCorrectionScheme ecScheme,
+        uint32_t decodeIterations) :
+                                      LDPC (LDPCCode::get(ecScheme), testMode, decodeIterations)
+    {
+    }
+
     LDPC::LDPC (
+        std::shared_ptr<const LDPCCode> code,
         bool testMode,
-        ErrorCorrection::ErrorCorrectionCoding errorCorrectionCoding,
-        ErrorCorrection::CodingRate codingRate,
         uint32_t decodeIterations) :
                                       m_testMode(testMode),
-                                      m_ECCoding (errorCorrectionCoding),
-                                      m_codingRate (codingRate),
+                                      m_code (code),
+                                      m_ECScheme (m_code->m_ECScheme),
+                                      m_k (m_code->m_k),
+                                      m_n (m_code->m_n),
                                       m_decodeIterations (decodeIterations),
-                                      m_parityCheckMatrix_rank(0)
-    {
-      ErrorCorrection ec = ErrorCorrection(errorCorrectionCoding, codingRate);
-      m_k = ec.getMessageLen();
-      m_n = ec.getCodewordLen();
-      m_pchk = new ParityCheck(errorCorrectionCoding, codingRate);
-      m_parityCheckMatrix = m_pchk->parityCheckMatrix();
-      m_parityCheckMatrixSparse = m_parityCheckMatrix.sparseView();
+                                      m_stallIterations (DECODE_STALL_ITERATIONS_DEFAULT),
+                                      m_decodeTimeBudget (0),
+                                      m_decodeAlgorithm (DecodeAlgorithm::PROBABILITY_DOMAIN_BP),
+                                      m_decodeSchedule (DecodeSchedule::FLOODING),
+                                      m_decodeThreads (0),
+                                      m_minSumNormalization (MIN_SUM_NORMALIZATION_DEFAULT),
+                                      m_minSumOffset (MIN_SUM_OFFSET_DEFAULT),
+                                      m_parityCheckMatrix_rank(0),
+                                      m_decodedIterations(0),
+                                      m_decodedCodewords(0),
+                                      m_decodedExpired(0)
+    {
 #if LDPC_DEBUG_VERBOSE
       std::cout << "m_k " << m_k << std::endl;
       std::cout << "m_n " << m_n << std::endl;
-      std::cout << "m_parityCheckMatrix rows " << m_parityCheckMatrix.rows() << std::endl;
-      std::cout << "m_parityCheckMatrix cols " << m_parityCheckMatrix.cols() << std::endl;
 #endif
-      if (!m_testMode) {
-        m_makeEncoderMatrices();
-        m_makeDecoderMatrices();
-      }
     }
 
     LDPC::~LDPC ()
     {
-      delete m_pchk;
     }
 
     const PPDU_u8
@@ -115,7 +238,11 @@ namespace xiphos
         inPayload.insert(inPayload.end(),cpad.begin(),cpad.end());
         return PPDU_u8(inPayload, PPDU_u8::BitsPerSymbol::BPSymb_1);
       }
+      else if (!m_code->m_qcEncoder) {
+        return m_encodeGenerator(inPayload, numCodewords);
+      }
       else {
+        m_code->m_prepareEncoderMatrices();
         Eigen::VectorXd m(m_k);
         uint8_t * inPayloadPtr = inPayload.data();
 
@@ -127,13 +254,13 @@ namespace xiphos
           for (uint32_t i = 0; i < m_k; i++)
             m[i] = (double) inPayload[(nc * m_k) + i];
 
-          m_p1 = m_EinvTA_C * m;
+          m_p1 = m_code->m_EinvTA_C * m;
 #if LDPC_DEBUG_VERBOSE
           std::cout << "m_p1 size "  << m_p1.size() << std::endl;
           std::cout << "m_p1" << std::endl;
           std::cout << m_p1 << std::endl;
 #endif
-          m_p2 = m_invTA * m + m_invTB * m_p1;
+          m_p2 = m_code->m_invTA * m + m_code->m_invTB * m_p1;
 #if LDPC_DEBUG_VERBOSE
           std::cout << "m_p2 size "  << m_p2.size() << std::endl;
           std::cout << "m_p2" << std::endl;
@@ -197,7 +324,11 @@ namespace xiphos
         inPayload.insert(inPayload.end(),cpad.begin(),cpad.end());
         return PPDU_u8(inPayload, PPDU_u8::BitsPerSymbol::BPSymb_1);
       }
+      else if (!m_code->m_qcEncoder) {
+        return m_encodeGenerator(inPayload, numCodewords);
+      }
       else {
+        m_code->m_prepareEncoderMatrices();
         Eigen::VectorXd m(m_k);
         uint8_t * inPayloadPtr = inPayload.data();
 
@@ -209,8 +340,8 @@ namespace xiphos
           for (uint32_t i = 0; i < m_k; i++)
             m[i] = (double) inPayload[(nc * m_k) + i];
 
-          m_p1.noalias() = m_sEinvTA_C * m;
-          m_p2.noalias() = m_sinvTA * m + m_sinvTB * m_p1;
+          m_p1.noalias() = m_code->m_sEinvTA_C * m;
+          m_p2.noalias() = m_code->m_sinvTA * m + m_code->m_sinvTB * m_p1;
 
           Eigen::VectorXi p1i = m_p1.cast<int>();
           Eigen::VectorXi p2i = m_p2.cast<int>();
@@ -229,6 +360,198 @@ namespace xiphos
       }
     }
 
+    const PPDU_u8
+    LDPC::m_encodeGenerator(const PDU<uint8_t>::payload_t &message,
+        uint32_t numCodewords)
+    {
+      // The Richardson-Urbanke gap of Z only holds for the dual-diagonal
+      // codes; encode the others with encodeQC and unpack
+      PPDU_u8 messagePDU(message, PPDU_u8::BitsPerSymbol::BPSymb_1);
+      PPDU_u8 encoded = encodeQC(messagePDU);
+      encoded.repack(PPDU_u8::BitsPerSymbol::BPSymb_1);
+      PDU<uint8_t>::payload_t codewords = encoded.getPayload();
+      codewords.resize(uint64_t(numCodewords) * m_n);
+      return PPDU_u8(codewords, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    }
+
+    const PPDU_u8
+    LDPC::encodeQC (PPDU_u8 &inPDU)
+    {
+      // Work on the packed bits
+      if (inPDU.getBps() != PPDU_u8::BitsPerSymbol::BPSymb_8)
+        inPDU.repack(PPDU_u8::BitsPerSymbol::BPSymb_8);
+
+      // The message bits are zero padded to a multiple of the message length,
+      // plus the slack readBlock needs
+      PDU<uint8_t>::payload_t inPayload = inPDU.getPayload();
+      uint64_t pduLen = inPayload.size() * 8;
+      uint32_t numCodewords = pduLen / m_k + (pduLen % m_k != 0 ? 1 : 0);
+      inPayload.resize((uint64_t(numCodewords) * m_k + 7) / 8 + 8, 0);
+
+      PDU<uint8_t>::payload_t outPayload((uint64_t(numCodewords) * m_n + 7) / 8 + 8, 0);
+
+#if LDPC_DEBUG
+      printf("LDPC::encodeQC pduLen %ld bits m_k %d numCodewords %d\n", pduLen, m_k, numCodewords);
+#endif
+      if (m_testMode) {
+        // As for encode, the message bits padded out to the codeword length
+        std::copy(inPayload.begin(), inPayload.begin() + (pduLen + 7) / 8, outPayload.begin());
+      }
+      else if (!m_code->m_qcEncoder) {
+        // Multiply by the systematic generator: each set message bit XORs
+        // its column of inv(P) Q into the parity
+        m_code->m_prepareQCGenerator();
+        uint32_t words = m_code->m_qcGeneratorWords;
+        if (words == 0)
+          throw LDPCException("The parity part of the parity check matrix is singular; no encoder");
+        uint32_t m = m_n - m_k;
+        const uint64_t *generator = m_code->m_qcGenerator.data();
+        std::vector<uint64_t> message((m_k + 63) / 64);
+        std::vector<uint64_t> parity(words);
+
+        for (uint32_t nc = 0; nc < numCodewords; nc++)
+        {
+          readBlock(inPayload.data(), uint64_t(nc) * m_k, m_k, message.data());
+          std::fill(parity.begin(), parity.end(), 0);
+          for (uint32_t w = 0; w < message.size(); w++)
+          {
+            for (uint64_t bits = message[w]; bits != 0; bits &= bits - 1)
+            {
+              // Bit 63 - b of word w is message bit w * 64 + b
+              uint32_t i = w * 64 + 63 - __builtin_ctzll(bits);
+              const uint64_t *column = generator + size_t(i) * words;
+              for (uint32_t p = 0; p < words; p++)
+                parity[p] ^= column[p];
+            }
+          }
+
+          uint64_t codewordStart = uint64_t(nc) * m_n;
+          writeBlock(outPayload.data(), codewordStart, m_k, message.data());
+          writeBlock(outPayload.data(), codewordStart + m_k, m, parity.data());
+        }
+      }
+      else {
+        uint32_t Z = m_code->m_submatrixSize;
+        uint32_t words = (Z + 63) / 64;
+        uint32_t numLayers = m_code->m_layerStart.size() - 1;
+        uint32_t messageColumns = m_k / Z;
+
+        // The message blocks, and one parity block per block row. Block row
+        // l's parity is first the XOR of its rotated message blocks, lambda_l.
+        std::vector<uint64_t> message(messageColumns * words);
+        std::vector<uint64_t> parity(numLayers * words);
+        std::vector<uint64_t> lambda(numLayers * words);
+        std::vector<uint64_t> sum(words);
+
+        for (uint32_t nc = 0; nc < numCodewords; nc++)
+        {
+          for (uint32_t j = 0; j < messageColumns; j++)
+            readBlock(inPayload.data(), uint64_t(nc) * m_k + j * Z, Z, &message[j * words]);
+
+          std::fill(lambda.begin(), lambda.end(), 0);
+          std::fill(sum.begin(), sum.end(), 0);
+          for (uint32_t l = 0; l < numLayers; l++)
+          {
+            for (uint32_t c = m_code->m_layerStart[l]; c < m_code->m_layerStart[l + 1]; c++)
+              if (m_code->m_circulantColumn[c] < messageColumns)
+                rotateXorBlock(&message[m_code->m_circulantColumn[c] * words], Z, words,
+                    m_code->m_circulantShift[c], &lambda[l * words]);
+            for (uint32_t w = 0; w < words; w++)
+              sum[w] ^= lambda[l * words + w];
+          }
+
+          // The dual-diagonal blocks cancel in the XOR of all block rows,
+          // leaving the first parity block times the circulant with shift
+          // m_code->m_qcParityShift
+          std::fill(parity.begin(), parity.end(), 0);
+          rotateXorBlock(sum.data(), Z, words, (Z - m_code->m_qcParityShift) % Z, &parity[0]);
+
+          // Back-substitution: block row l gives parity block l + 1
+          for (uint32_t l = 0; l + 1 < numLayers; l++)
+          {
+            uint64_t *next = &parity[(l + 1) * words];
+            for (uint32_t w = 0; w < words; w++)
+              next[w] = lambda[l * words + w] ^ (l > 0 ? parity[l * words + w] : 0);
+            for (uint32_t c = m_code->m_layerStart[l]; c < m_code->m_layerStart[l + 1]; c++)
+              if (m_code->m_circulantColumn[c] == messageColumns)
+                rotateXorBlock(&parity[0], Z, words, m_code->m_circulantShift[c], next);
+          }
+
+          uint64_t codewordStart = uint64_t(nc) * m_n;
+          for (uint32_t j = 0; j < messageColumns; j++)
+            writeBlock(outPayload.data(), codewordStart + j * Z, Z, &message[j * words]);
+          for (uint32_t l = 0; l < numLayers; l++)
+            writeBlock(outPayload.data(), codewordStart + m_k + l * Z, Z, &parity[l * words]);
+        }
+      }
+
+      outPayload.resize((uint64_t(numCodewords) * m_n + 7) / 8);
+      return PPDU_u8(outPayload, PPDU_u8::BitsPerSymbol::BPSymb_8);
+    }
+
+    LDPC::RateMatching
+    LDPC::rateMatching(uint32_t messageBits, uint32_t puncturedBits) const
+    {
+      if (messageBits == 0)
+        throw LDPCException("No message bits to rate match");
+
+      RateMatching layout;
+      layout.messageBits = messageBits;
+      layout.numCodewords = messageBits / m_k + (messageBits % m_k != 0 ? 1 : 0);
+      layout.shortenedBits = layout.numCodewords * m_k - messageBits;
+      layout.puncturedBits = puncturedBits;
+      layout.codePuncturedBits = m_code->m_punctured;
+      // Codeword 0 loses the most parity bits
+      if (layout.punctured(0) >= m_n - m_k)
+        throw LDPCException((boost::format ("Cannot puncture %1% parity bits from %2% codewords of %3% parity bits")
+        % puncturedBits % layout.numCodewords % (m_n - m_k - layout.codePuncturedBits)).str());
+      layout.transmittedBits = layout.numCodewords * (m_n - layout.codePuncturedBits) -
+          layout.shortenedBits - puncturedBits;
+      return layout;
+    }
+
+    const PPDU_u8
+    LDPC::encodeShortened (PPDU_u8 &inPDU, uint32_t puncturedBits)
+    {
+      // The rate matching works on 1 bit per byte (sample)
+      if (inPDU.getBps() > 1)
+        inPDU.repack(PPDU_u8::BitsPerSymbol::BPSymb_1);
+      const PDU<uint8_t>::payload_t &message = inPDU.getPayload();
+      RateMatching layout = rateMatching(message.size(), puncturedBits);
+
+      // Each codeword's share of the message, then its shortened zeros
+      PDU<uint8_t>::payload_t padded(layout.numCodewords * m_k, 0);
+      uint32_t messageBit = 0;
+      for (uint32_t c = 0; c < layout.numCodewords; c++)
+      {
+        uint32_t bits = m_k - layout.shortened(c);
+        for (uint32_t i = 0; i < bits; i++)
+          padded[c * m_k + i] = message[messageBit++] & 0x01;
+      }
+
+      PPDU_u8 paddedPDU(padded, PPDU_u8::BitsPerSymbol::BPSymb_1);
+      PPDU_u8 encoded = encodeQC(paddedPDU);
+      encoded.repack(PPDU_u8::BitsPerSymbol::BPSymb_1);
+      const PDU<uint8_t>::payload_t &codewords = encoded.getPayload();
+
+      // Drop the shortened bits and the punctured parity bits
+      PDU<uint8_t>::payload_t transmitted;
+      transmitted.reserve(layout.transmittedBits);
+      for (uint32_t c = 0; c < layout.numCodewords; c++)
+      {
+        PDU<uint8_t>::payload_t::const_iterator codeword = codewords.begin() + c * m_n;
+        transmitted.insert(transmitted.end(), codeword, codeword + m_k - layout.shortened(c));
+        transmitted.insert(transmitted.end(), codeword + m_k, codeword + m_n - layout.punctured(c));
+      }
+
+#if LDPC_DEBUG
+      printf("LDPC::encodeShortened message %d bits numCodewords %d shortened %d punctured %d transmitted %d bits\n",
+          layout.messageBits, layout.numCodewords, layout.shortenedBits, layout.puncturedBits,
+          layout.transmittedBits);
+#endif
+      return PPDU_u8(transmitted, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    }
+
     //    double
     //    lntanh (
     //        double x)
@@ -241,8 +564,13 @@ namespace xiphos
     LDPC::decode(PPDU_f::payload_t& encodedPayload, float snrEstimate,
         PPDU_u8::payload_t& decodedPayload)
     {
-      // TODO Are there places to use sparse matrices?
+      return decode(encodedPayload, snrEstimate, decodedPayload, m_workspace);
+    }
 
+    uint32_t
+    LDPC::decode(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+        PPDU_u8::payload_t& decodedPayload, DecoderWorkspace &workspace)
+    {
       // Check that the payload is an integer number of codewords
       uint32_t totalEncSize = encodedPayload.size();
       if (totalEncSize % m_n != 0) {
@@ -250,9 +578,420 @@ namespace xiphos
         % totalEncSize % m_n).str());
       }
 
-      decodedPayload.resize(0);
       uint32_t numCodewords = totalEncSize / m_n;
-      decodedPayload.reserve(numCodewords*m_k);
+      decodedPayload.resize(numCodewords * m_k);
+
+      DecodeBudget budget(*this, numCodewords);
+      uint64_t iterations = 0;
+      uint32_t totalBitErrors = m_decodeCodewords(encodedPayload.data(), numCodewords,
+          snrEstimate, decodedPayload.data(), nullptr, workspace, budget, iterations);
+
+      m_decodedIterations = iterations;
+      m_decodedCodewords = numCodewords;
+      m_decodedExpired = budget.expiredCodewords();
+
+      if (m_decodeAlgorithm == DecodeAlgorithm::PROBABILITY_DOMAIN_BP)
+        std::cout << "Total bit errors = " << totalBitErrors << " for " << (numCodewords*m_k) << " message bits" << std::endl;
+
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::decodeShortened(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+        uint32_t messageBits, uint32_t puncturedBits,
+        PPDU_u8::payload_t& decodedPayload)
+    {
+      return decodeShortened(encodedPayload, snrEstimate, messageBits, puncturedBits,
+          decodedPayload, m_workspace);
+    }
+
+    uint32_t
+    LDPC::decodeShortened(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+        uint32_t messageBits, uint32_t puncturedBits,
+        PPDU_u8::payload_t& decodedPayload, DecoderWorkspace &workspace)
+    {
+      RateMatching layout = rateMatching(messageBits, puncturedBits);
+      if (encodedPayload.size() != layout.transmittedBits) {
+        throw LDPCException((boost::format ("Encoded Payload length %1% not the %2% bits sent for a %3% bit message")
+        % encodedPayload.size() % layout.transmittedBits % messageBits).str());
+      }
+
+      // The received sample that every decoder turns into an LLR of
+      // KNOWN_BIT_LLR; LLR = -2r/sigma^2
+      float sigma2 = 1.0 / pow (10.0, snrEstimate / 10.0); // noise variance
+      float knownZero = -KNOWN_BIT_LLR * sigma2 / 2.0f;
+
+      // Rebuild the full codewords; punctured bits are erasures
+      std::vector<float> &full = workspace.m_fullCodewords;
+      full.resize(layout.numCodewords * m_n);
+      const float *received = encodedPayload.data();
+      for (uint32_t c = 0; c < layout.numCodewords; c++)
+      {
+        float *codeword = full.data() + c * m_n;
+        uint32_t messageEnd = m_k - layout.shortened(c);
+        uint32_t parityEnd = m_n - layout.punctured(c);
+        std::copy(received, received + messageEnd, codeword);
+        std::fill(codeword + messageEnd, codeword + m_k, knownZero);
+        received += messageEnd;
+        std::copy(received, received + parityEnd - m_k, codeword + m_k);
+        std::fill(codeword + parityEnd, codeword + m_n, 0.0f);
+        received += parityEnd - m_k;
+      }
+
+      std::vector<uint8_t> &fullMessages = workspace.m_fullMessages;
+      fullMessages.resize(layout.numCodewords * m_k);
+      DecodeBudget budget(*this, layout.numCodewords);
+      uint64_t iterations = 0;
+      uint32_t totalBitErrors = m_decodeCodewords(full.data(), layout.numCodewords,
+          snrEstimate, fullMessages.data(), nullptr, workspace, budget, iterations);
+
+      m_decodedIterations = iterations;
+      m_decodedCodewords = layout.numCodewords;
+      m_decodedExpired = budget.expiredCodewords();
+
+      // Keep the message bits only
+      decodedPayload.resize(messageBits);
+      uint8_t *decoded = decodedPayload.data();
+      for (uint32_t c = 0; c < layout.numCodewords; c++)
+        decoded = std::copy(fullMessages.begin() + c * m_k,
+            fullMessages.begin() + (c + 1) * m_k - layout.shortened(c), decoded);
+
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::decodeSoft(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+        PPDU_u8::payload_t& decodedPayload, float *posteriorLLRs)
+    {
+      return decodeSoft(encodedPayload, snrEstimate, decodedPayload, posteriorLLRs,
+          m_workspace);
+    }
+
+    uint32_t
+    LDPC::decodeSoft(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+        PPDU_u8::payload_t& decodedPayload, float *posteriorLLRs,
+        DecoderWorkspace &workspace)
+    {
+      // Check that the payload is an integer number of codewords
+      uint32_t totalEncSize = encodedPayload.size();
+      if (totalEncSize % m_n != 0) {
+        throw LDPCException((boost::format ("Encoded Payload length %1% not an integral multiple of codeword length %2%")
+        % totalEncSize % m_n).str());
+      }
+      if (posteriorLLRs == nullptr) {
+        throw LDPCException("No buffer for the a-posteriori LLRs");
+      }
+
+      uint32_t numCodewords = totalEncSize / m_n;
+      decodedPayload.resize(numCodewords * m_k);
+
+      DecodeBudget budget(*this, numCodewords);
+      uint64_t iterations = 0;
+      uint32_t totalBitErrors = m_decodeCodewords(encodedPayload.data(), numCodewords,
+          snrEstimate, decodedPayload.data(), posteriorLLRs, workspace, budget, iterations);
+
+      m_decodedIterations = iterations;
+      m_decodedCodewords = numCodewords;
+      m_decodedExpired = budget.expiredCodewords();
+
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::decodeParallel(PPDU_f::payload_t& encodedPayload, float snrEstimate,
+        PPDU_u8::payload_t& decodedPayload)
+    {
+      // Check that the payload is an integer number of codewords
+      uint32_t totalEncSize = encodedPayload.size();
+      if (totalEncSize % m_n != 0) {
+        throw LDPCException((boost::format ("Encoded Payload length %1% not an integral multiple of codeword length %2%")
+        % totalEncSize % m_n).str());
+      }
+
+      uint32_t numCodewords = totalEncSize / m_n;
+      decodedPayload.resize(numCodewords * m_k);
+
+      uint32_t numBlocks = (numCodewords + DECODE_BLOCK_CODEWORDS - 1) / DECODE_BLOCK_CODEWORDS;
+      uint32_t numThreads = m_decodeThreads;
+      if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+      numThreads = std::max(1u, std::min(numThreads, numBlocks));
+
+      // Workers take blocks of codewords in order until none are left. Each
+      // block is decoded straight into its place in the output, so the result
+      // does not depend on which worker decoded what.
+      std::atomic<uint32_t> nextBlock(0);
+      DecodeBudget budget(*this, numCodewords, numThreads);
+      std::vector<uint32_t> bitErrors(numThreads, 0);
+      std::vector<uint64_t> iterations(numThreads, 0);
+      std::vector<std::exception_ptr> errors(numThreads);
+      if (m_workerWorkspaces.size() < numThreads)
+        m_workerWorkspaces.resize(numThreads);
+
+      auto worker = [&](uint32_t w) {
+        try {
+          uint32_t block;
+          while ((block = nextBlock++) < numBlocks) {
+            uint32_t first = block * DECODE_BLOCK_CODEWORDS;
+            uint32_t count = std::min(DECODE_BLOCK_CODEWORDS, numCodewords - first);
+            bitErrors[w] += m_decodeCodewords(encodedPayload.data() + first * m_n, count,
+                snrEstimate, decodedPayload.data() + first * m_k, nullptr,
+                m_workerWorkspaces[w], budget, iterations[w]);
+          }
+        }
+        catch (...) {
+          errors[w] = std::current_exception();
+        }
+      };
+
+      std::vector<std::thread> threads;
+      for (uint32_t w = 1; w < numThreads; w++)
+        threads.emplace_back(worker, w);
+      worker(0);
+      for (std::thread &t : threads)
+        t.join();
+
+      for (std::exception_ptr &e : errors)
+        if (e)
+          std::rethrow_exception(e);
+
+      uint32_t totalBitErrors = 0;
+      m_decodedIterations = 0;
+      for (uint32_t w = 0; w < numThreads; w++) {
+        totalBitErrors += bitErrors[w];
+        m_decodedIterations += iterations[w];
+      }
+      m_decodedCodewords = numCodewords;
+      m_decodedExpired = budget.expiredCodewords();
+
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::decodeBatch(const PPDU_f::payload_t *encodedPayloads,
+        uint32_t numPayloads, float snrEstimate,
+        PPDU_u8::payload_t *decodedPayloads)
+    {
+      return decodeBatch(encodedPayloads, numPayloads, snrEstimate, decodedPayloads,
+          m_workspace);
+    }
+
+    uint32_t
+    LDPC::decodeBatch(const PPDU_f::payload_t *encodedPayloads,
+        uint32_t numPayloads, float snrEstimate,
+        PPDU_u8::payload_t *decodedPayloads, DecoderWorkspace &workspace)
+    {
+      // Check that each payload is an integer number of codewords
+      uint32_t numCodewords = 0;
+      for (uint32_t p = 0; p < numPayloads; p++) {
+        uint32_t totalEncSize = encodedPayloads[p].size();
+        if (totalEncSize % m_n != 0) {
+          throw LDPCException((boost::format ("Encoded Payload %1% length %2% not an integral multiple of codeword length %3%")
+          % p % totalEncSize % m_n).str());
+        }
+        numCodewords += totalEncSize / m_n;
+      }
+
+      DecodeBudget budget(*this, numCodewords);
+      uint64_t iterations = 0;
+      uint32_t totalBitErrors = 0;
+
+      // The interleaved branch does not go through m_decodeCodewords, and
+      // the workspace may have been sized for another algorithm
+      prepareWorkspace(workspace);
+
+      if (m_decodeAlgorithm == DecodeAlgorithm::INTERLEAVED_MIN_SUM) {
+        // Gather the codewords of all payloads so they fill the lanes. A
+        // group of LDPC_KERNEL_LANE_ALIGN codewords is a whole number of
+        // interleaved groups.
+        const float *encoded[LDPC_KERNEL_LANE_ALIGN];
+        uint8_t *decoded[LDPC_KERNEL_LANE_ALIGN];
+        uint32_t count = 0;
+        for (uint32_t p = 0; p < numPayloads; p++) {
+          uint32_t payloadCodewords = encodedPayloads[p].size() / m_n;
+          decodedPayloads[p].resize(payloadCodewords * m_k);
+          for (uint32_t i = 0; i < payloadCodewords; i++) {
+            encoded[count] = encodedPayloads[p].data() + i * m_n;
+            decoded[count] = decodedPayloads[p].data() + i * m_k;
+            if (++count == LDPC_KERNEL_LANE_ALIGN) {
+              totalBitErrors += m_decodeInterleavedMinSum(encoded, decoded, nullptr,
+                  count, snrEstimate, workspace, budget, iterations);
+              count = 0;
+            }
+          }
+        }
+        totalBitErrors += m_decodeInterleavedMinSum(encoded, decoded, nullptr,
+            count, snrEstimate, workspace, budget, iterations);
+      }
+      else {
+        for (uint32_t p = 0; p < numPayloads; p++) {
+          uint32_t payloadCodewords = encodedPayloads[p].size() / m_n;
+          decodedPayloads[p].resize(payloadCodewords * m_k);
+          totalBitErrors += m_decodeCodewords(encodedPayloads[p].data(), payloadCodewords,
+              snrEstimate, decodedPayloads[p].data(), nullptr, workspace, budget, iterations);
+        }
+      }
+
+      m_decodedIterations = iterations;
+      m_decodedCodewords = numCodewords;
+      m_decodedExpired = budget.expiredCodewords();
+
+      return totalBitErrors;
+    }
+
+    LDPC::DecodeBudget::DecodeBudget (const LDPC &ldpc, uint32_t numCodewords,
+        uint32_t workers) :
+            maxIterations (ldpc.m_decodeIterations),
+            stallIterations (ldpc.m_stallIterations),
+            m_timed (ldpc.m_decodeTimeBudget > 0),
+            m_workers (std::max(1u, workers)),
+            m_end (Clock::now() + std::chrono::microseconds(ldpc.m_decodeTimeBudget.load())),
+            m_unclaimed (numCodewords),
+            m_expired (0)
+    {
+    }
+
+    LDPC::DecodeBudget::Clock::time_point
+    LDPC::DecodeBudget::claim(uint32_t codewords)
+    {
+      if (!m_timed)
+        return Clock::time_point::max();
+
+      // The codewords not started yet, counting these, share the time left.
+      // With several workers, that many codewords are decoded at once.
+      uint32_t unclaimed = m_unclaimed.fetch_sub(codewords);
+      if (unclaimed < codewords)
+        unclaimed = codewords;
+      uint32_t share = std::min(unclaimed, codewords * m_workers);
+
+      Clock::time_point now = Clock::now();
+      if (now >= m_end)
+        return now;
+      return now + (m_end - now) * share / unclaimed;
+    }
+
+    LDPC::DecoderWorkspace::DecoderWorkspace (const LDPC &ldpc)
+    {
+      ldpc.prepareWorkspace(*this);
+    }
+
+    void
+    LDPC::prepareWorkspace(DecoderWorkspace &workspace) const
+    {
+      // Resizing to the size a buffer already has does not allocate, so this
+      // is cheap to call before every decode
+      uint32_t numChecks = m_n - m_k;
+      uint32_t numEdges = m_code->m_graph.numEdges();
+      uint32_t Z = m_code->m_submatrixSize;
+      uint32_t numCirculantEdges = m_code->m_circulantColumn.size() * Z;
+
+      switch (m_decodeAlgorithm) {
+        case DecodeAlgorithm::NORMALIZED_MIN_SUM:
+        case DecodeAlgorithm::OFFSET_MIN_SUM:
+          workspace.m_channelLLR.resize(m_n);
+          workspace.m_posteriorLLR.resize(m_n);
+          workspace.m_min1.resize(numChecks);
+          workspace.m_min2.resize(numChecks);
+          workspace.m_min1Index.resize(numChecks);
+          workspace.m_signProduct.resize(numChecks);
+          workspace.m_edgeSign.resize(m_decodeSchedule == DecodeSchedule::LAYERED ?
+              numCirculantEdges : numEdges);
+          workspace.m_q.resize(m_code->m_maxLayerDegree);
+          workspace.m_symbol.resize(m_code->m_maxLayerDegree);
+          workspace.m_dHat.resize(m_n);
+          workspace.m_syndrome.resize(numChecks);
+          break;
+        case DecodeAlgorithm::FIXED_POINT_MIN_SUM:
+        {
+          uint32_t stride = ldpcKernelLaneStride(2 * Z + LDPC_KERNEL_LANE_ALIGN);
+          workspace.m_posterior.resize((m_n / Z) * stride);
+          workspace.m_messages.resize(m_code->m_circulantColumn.size() * ldpcKernelLaneStride(Z));
+          workspace.m_scratch.resize(m_code->m_maxLayerDegree * LDPC_KERNEL_LANE_ALIGN);
+          workspace.m_channel.resize(m_n);
+          break;
+        }
+        case DecodeAlgorithm::INTERLEAVED_MIN_SUM:
+        {
+          uint32_t W = ldpcKernels().frameLanes;
+          workspace.m_posterior.resize(m_n * W);
+          workspace.m_messages.resize(numCirculantEdges * W);
+          workspace.m_scratch.resize(m_code->m_maxLayerDegree * W);
+          workspace.m_channel.resize(m_n * W);
+          workspace.m_active.resize(W);
+          workspace.m_unsatisfied.resize(W);
+          workspace.m_best.resize(W);
+          workspace.m_stalled.resize(W);
+          break;
+        }
+        case DecodeAlgorithm::PROBABILITY_DOMAIN_BP:
+        default:
+          workspace.m_r.resize(m_n);
+          workspace.m_f0.resize(m_n);
+          workspace.m_f1.resize(m_n);
+          workspace.m_Q0.resize(numEdges);
+          workspace.m_Q1.resize(numEdges);
+          workspace.m_deltaQ.resize(numEdges);
+          workspace.m_R0.resize(numEdges);
+          workspace.m_R1.resize(numEdges);
+          workspace.m_dHat.resize(m_n);
+          workspace.m_syndrome.resize(numChecks);
+          break;
+      }
+    }
+
+    uint32_t
+    LDPC::m_decodeCodewords(const float *encoded, uint32_t numCodewords,
+        float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+        DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const
+    {
+      prepareWorkspace(workspace);
+
+      switch (m_decodeAlgorithm) {
+        case DecodeAlgorithm::NORMALIZED_MIN_SUM:
+        case DecodeAlgorithm::OFFSET_MIN_SUM:
+          if (m_decodeSchedule == DecodeSchedule::LAYERED)
+            return m_decodeLayeredMinSum(encoded, numCodewords, snrEstimate, decoded,
+                posteriorLLRs, workspace, budget, iterations);
+          return m_decodeMinSum(encoded, numCodewords, snrEstimate, decoded,
+              posteriorLLRs, workspace, budget, iterations);
+        case DecodeAlgorithm::FIXED_POINT_MIN_SUM:
+          return m_decodeFixedPointMinSum(encoded, numCodewords, snrEstimate, decoded,
+              posteriorLLRs, workspace, budget, iterations);
+        case DecodeAlgorithm::INTERLEAVED_MIN_SUM:
+        {
+          // A group of LDPC_KERNEL_LANE_ALIGN codewords is a whole number of
+          // interleaved groups
+          const float *encodedCodewords[LDPC_KERNEL_LANE_ALIGN];
+          uint8_t *decodedCodewords[LDPC_KERNEL_LANE_ALIGN];
+          float *posteriorCodewords[LDPC_KERNEL_LANE_ALIGN];
+          uint32_t totalBitErrors = 0;
+          for (uint32_t first = 0; first < numCodewords; first += LDPC_KERNEL_LANE_ALIGN) {
+            uint32_t count = std::min(LDPC_KERNEL_LANE_ALIGN, numCodewords - first);
+            for (uint32_t i = 0; i < count; i++) {
+              encodedCodewords[i] = encoded + (first + i) * m_n;
+              decodedCodewords[i] = decoded + (first + i) * m_k;
+              if (posteriorLLRs)
+                posteriorCodewords[i] = posteriorLLRs + (first + i) * m_n;
+            }
+            totalBitErrors += m_decodeInterleavedMinSum(encodedCodewords, decodedCodewords,
+                posteriorLLRs ? posteriorCodewords : nullptr, count, snrEstimate,
+                workspace, budget, iterations);
+          }
+          return totalBitErrors;
+        }
+        case DecodeAlgorithm::PROBABILITY_DOMAIN_BP:
+        default:
+          return m_decodeProbabilityDomain(encoded, numCodewords, snrEstimate, decoded,
+              posteriorLLRs, workspace, budget, iterations);
+      }
+    }
+
+    uint32_t
+    LDPC::m_decodeProbabilityDomain(const float *encoded, uint32_t numCodewords,
+        float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+        DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const
+    {
+      uint32_t totalEncSize = numCodewords * m_n;
 
       // number of bit errors in a codeword. Will be zero if decoding perfect,
       // otherwise will have the number of errors, which we return
@@ -262,21 +1001,24 @@ namespace xiphos
 
       float sigma2 = 1.0 / pow (10.0, snrEstimate / 10.0); // noise variance
 
-      Eigen::VectorXd f0 = Eigen::VectorXd::Zero (m_n);
-      Eigen::VectorXd f1 = Eigen::VectorXd::Zero (m_n);
-      Eigen::MatrixXd Q0 (m_n - m_k, m_n);
-      Eigen::MatrixXd Q1 (m_n - m_k, m_n);
-      Eigen::MatrixXd deltaQ (m_n - m_k, m_n);
-      Eigen::MatrixXd R0 (m_n - m_k, m_n);
-      Eigen::MatrixXd R1 (m_n - m_k, m_n);
-      Eigen::MatrixXd deltaR (m_n - m_k, m_n);
-      Eigen::VectorXi dHat (m_n); // current codeword estimate
-      Eigen::VectorXi cwCheck (m_n - m_k); // used to check dHat, codeword est.
-
-      Eigen::VectorXi decoded = Eigen::VectorXi::Zero (m_k);
-      Eigen::VectorXd r(m_n);
-
-      unsigned int maxConnectedSymbolNodes = m_N_numSymbolNodes.maxCoeff ();
+      // The messages are stored per edge of the Tanner graph, in check node
+      // order; see TannerGraph
+      uint32_t numEdges = m_code->m_graph.numEdges();
+      const uint32_t * edgeSymbol = m_code->m_graph.edgeSymbols();
+      const uint32_t * symbolEdges = m_code->m_graph.symbolEdges();
+
+      // The buffers live in the workspace; see prepareWorkspace
+      Eigen::Map<Eigen::VectorXd> f0 (workspace.m_f0.data(), m_n);
+      Eigen::Map<Eigen::VectorXd> f1 (workspace.m_f1.data(), m_n);
+      std::vector<double> &Q0 = workspace.m_Q0;
+      std::vector<double> &Q1 = workspace.m_Q1;
+      std::vector<double> &deltaQ = workspace.m_deltaQ;
+      std::vector<double> &R0 = workspace.m_R0;
+      std::vector<double> &R1 = workspace.m_R1;
+      std::vector<uint8_t> &dHat = workspace.m_dHat; // current codeword estimate
+      std::vector<uint8_t> &syndrome = workspace.m_syndrome; // parity of each check node
+
+      Eigen::Map<Eigen::VectorXd> r(workspace.m_r.data(), m_n);
 
       uint32_t processedBits = 0;
       while (processedBits < totalEncSize) {
@@ -284,23 +1026,19 @@ namespace xiphos
 
 #if LDPC_DEBUG_VERBOSE
         printf("sigma2 %f\n",sigma2);
-        printf("max iterations %d\n",m_decodeIterations);
+        printf("max iterations %d\n",budget.maxIterations);
 #endif
         for (uint32_t p = 0; p < m_n; p++)
-          r[p] = encodedPayload[processedBits+p];
+          r[p] = encoded[processedBits+p];
 
         r = -2 * r / sigma2;
-        Eigen::ArrayXd re = Eigen::ArrayXd::Ones (m_n) + r.array ().exp ();
-        f1 = re.inverse ();
-        f0 = Eigen::VectorXd::Ones (m_n) - f1;
+        f1 = (1.0 + r.array ().exp ()).inverse ().matrix ();
+        f0 = (1.0 - f1.array ()).matrix ();
 
 #if LDPC_DEBUG_VERBOSE
         printf("r\n");
         for (uint32_t i = 0; i < LDPC_DEBUG_SAMPLES_TO_PRINT; i++)
           printf("%g ",r[i]);
-        printf("\nre\n");
-        for (uint32_t i = 0; i < LDPC_DEBUG_SAMPLES_TO_PRINT; i++)
-          printf("%g ",re[i]);
         printf("\nf1\n");
         for (uint32_t i = 0; i < LDPC_DEBUG_SAMPLES_TO_PRINT; i++)
           printf("%g ",f1[i]);
@@ -310,128 +1048,118 @@ namespace xiphos
         printf("\n");
 #endif
         // initilize Q0 and Q1
-        for (unsigned int i = 0; i < m_n - m_k; i++)
+        for (uint32_t e = 0; e < numEdges; e++)
         {
-          for (int j = 0; j < m_N_numSymbolNodes (i); j++)
-          {
-            Q0 (i, m_N (i, j)) = f0 (m_N (i, j));
-            Q1 (i, m_N (i, j)) = f1 (m_N (i, j));
-          }
+          Q0[e] = f0 (edgeSymbol[e]);
+          Q1[e] = f1 (edgeSymbol[e]);
         }
-#if LDPC_DEBUG_VERBOSE
-        std::cout << "Q0\n" << Q0 << std::endl;
-        std::cout << "Q1\n" << Q1 << std::endl;
-#endif
+
+        // The syndrome of the channel hard decisions; from here on it is
+        // only updated for the bits that flip
+        for (unsigned int j = 0; j < m_n; j++)
+          dHat[j] = f0 (j) > f1 (j) ? 0 : 1;
+        sum = m_code->m_graph.syndrome(dHat.data(), syndrome.data());
+        float *posterior = posteriorLLRs ? posteriorLLRs + codewordCount * m_n : nullptr;
+        if (posterior)
+          for (unsigned int j = 0; j < m_n; j++)
+            posterior[j] = r[j];
+        DecodeBudget::Clock::time_point deadline = budget.claim(1);
+        uint32_t bestSum = std::numeric_limits<uint32_t>::max();
+        uint32_t stalled = 0;
+
         unsigned int iter = 0;
-        while (iter < m_decodeIterations)
+        while (iter < budget.maxIterations)
         {
           totalIterations++;
 
-          deltaQ = Q0 - Q1;
+          for (uint32_t e = 0; e < numEdges; e++)
+            deltaQ[e] = Q0[e] - Q1[e];
 
-          // update deltaR
+          // update deltaR, then R0 and R1, one check node at a time
           for (unsigned int i = 0; i < m_n - m_k; i++)
           {
-            for (int j = 0; j < m_N_numSymbolNodes (i); j++)
+            uint32_t begin = m_code->m_graph.checkEdgeBegin(i);
+            uint32_t end = m_code->m_graph.checkEdgeEnd(i);
+            for (uint32_t e = begin; e < end; e++)
             {
-              deltaR (i, m_N (i, j)) = 1.0;
-              for (int k = 0; k < m_N_numSymbolNodes (i); k++)
+              double deltaR = 1.0;
+              for (uint32_t k = begin; k < end; k++)
               {
-                if (k != j)
-                  deltaR (i, m_N (i, j)) = deltaR (i, m_N (i, j))
-                  * deltaQ (i, m_N (i, k));
+                if (k != e)
+                  deltaR = deltaR * deltaQ[k];
               }
+              R0[e] = 0.5 * (1.0 + deltaR);
+              R1[e] = 0.5 * (1.0 - deltaR);
             } // for all symbols nodes connected to the current parity check node
           } // for all parity check nodes
-
-          R0 = Eigen::MatrixXd::Ones (m_n - m_k, m_n) + deltaR;
-          R0 = 0.5 * R0;
-          R1 = Eigen::MatrixXd::Ones (m_n - m_k, m_n) - deltaR;
-          R1 = 0.5 * R1;
           // TODO do we have to replace the 0.5 values?
-//          R0 = (R0.array () == 0.5).select (0.0, R0.array ());
-//          R1 = (R1.array () == 0.5).select (0.0, R1.array ());
-
-#if LDPC_DEBUG_VERBOSE
-          std::cout << "R0\n" << R0 << std::endl;
-          std::cout << "R1\n" << R1 << std::endl;
-#endif
 
           // Values R appear as normalized values with respect to those seen
           // in tables 8.2 to 8.12. By normalizing values NaN is avoided.
 
-          for (unsigned int i = 0; i < m_n - m_k; i++)
+          for (uint32_t e = 0; e < numEdges; e++)
           {
-            Eigen::MatrixXd g = Eigen::MatrixXd::Zero (m_n - m_k,
-                maxConnectedSymbolNodes);
-            for (int j = 0; j < m_N_numSymbolNodes (i); j++)
-            {
-              double b0 = 1;
-              double b1 = 1;
+            uint32_t sn = edgeSymbol[e];
+            double b0 = 1;
+            double b1 = 1;
 
-              for (int p1 = 0; p1 < m_M_numCheckNodes (m_N (i, j));
-                  p1++)
+            if (sn != 0)
+            {
+              for (uint32_t p1 = m_code->m_graph.symbolEdgeBegin(sn);
+                  p1 < m_code->m_graph.symbolEdgeEnd(sn); p1++)
               {
-                if (m_N (i, j) != 0 and ((long) i) != m_M (m_N (i, j), p1))
+                uint32_t other = symbolEdges[p1];
+                if (other != e)
                 {
-                  b0 = b0 * R0 (m_M (m_N (i, j), p1), m_N (i, j));
-                  b1 = b1 * R1 (m_M (m_N (i, j), p1), m_N (i, j));
+                  b0 = b0 * R0[other];
+                  b1 = b1 * R1[other];
                 }
               }
+            }
 
-              // Normalization of coefficients
-              b0 = f0 (m_N (i, j)) * b0;
-              b1 = f1 (m_N (i, j)) * b1;
-
-              if (b0 == 0 and b1 == 0)
-              {
-                Q0 (i, m_N (i, j)) = 0;
-                Q1 (i, m_N (i, j)) = 0;
-              }
-              else
-              {
-                g (i, j) = 1.0 / (b0 + b1);
-                Q0 (i, m_N (i, j)) = b0 * g (i, j);
-                Q1 (i, m_N (i, j)) = b1 * g (i, j);
-              }
+            // Normalization of coefficients
+            b0 = f0 (sn) * b0;
+            b1 = f1 (sn) * b1;
 
-            } // for all symbols nodes connected to the current parity check node
-          } // for all parity check nodes
+            if (b0 == 0 and b1 == 0)
+            {
+              Q0[e] = 0;
+              Q1[e] = 0;
+            }
+            else
+            {
+              double g = 1.0 / (b0 + b1);
+              Q0[e] = b0 * g;
+              Q1[e] = b1 * g;
+            }
+          } // for all edges
 
-          Eigen::VectorXd d0 = Eigen::VectorXd::Ones (m_n);
-          Eigen::VectorXd d1 = Eigen::VectorXd::Ones (m_n);
+          // hard decision on the codeword bits
           for (unsigned int j = 0; j < m_n; j++)
           {
-            for (int i = 0; i < m_M_numCheckNodes (j); i++)
+            double d0 = 1.0;
+            double d1 = 1.0;
+            for (uint32_t p1 = m_code->m_graph.symbolEdgeBegin(j);
+                p1 < m_code->m_graph.symbolEdgeEnd(j); p1++)
             {
-              d0 (j) = d0 (j) * R0 (m_M (j, i), j);
-              d1 (j) = d1 (j) * R1 (m_M (j, i), j);
+              d0 = d0 * R0[symbolEdges[p1]];
+              d1 = d1 * R1[symbolEdges[p1]];
+            }
+            d0 = d0 * f0 (j);
+            d1 = d1 * f1 (j);
+            if (posterior)
+              posterior[j] = log (std::max (d0, std::numeric_limits<double>::min ()))
+                  - log (std::max (d1, std::numeric_limits<double>::min ()));
+            uint8_t bit = d0 > d1 ? 0 : 1;
+            if (bit != dHat[j])
+            {
+              dHat[j] = bit;
+              m_code->m_graph.flipSymbol(j, syndrome.data(), sum);
             }
-            d0 (j) = d0 (j) * f0 (j);
-            d1 (j) = d1 (j) * f1 (j);
           }
 
-          // hard decision on the codeword bits
-          for (unsigned int j = 0; j < m_n; j++)
-            if (d0 (j) > d1 (j))
-              dHat (j) = 0;
-            else
-              dHat (j) = 1;
-
-#if LDPC_DEBUG_VERBOSE
-          std::cout << "dHat\n" << dHat.transpose() << std::endl;
-#endif
-#if 0
-          cwCheck = m_parityCheckMatrix * dHat;
-#else
-          cwCheck = m_parityCheckMatrixSparse * dHat;
-#endif
-          sum = 0;
-          for (unsigned int c = 0; c < cwCheck.size (); c++)
-            sum += (cwCheck (c) % 2);
 #if LDPC_DEBUG_VERBOSE
-          std::cout << "cwCheck \n" << cwCheck.transpose() << std::endl;
-          std::cout << "cwCheck.sum() \n" << sum << std::endl;
+          std::cout << "unsatisfied checks " << sum << std::endl;
           std::cout << "iteration " << iter << std::endl;
 #endif
           if (sum == 0)
@@ -441,33 +1169,525 @@ namespace xiphos
 #endif
             break;
           }
+          if (decodeStalled(budget.stallIterations, sum, bestSum, stalled) ||
+              budget.expired(deadline))
+            break;
           iter++;
-          if (iter == m_decodeIterations)
+          if (iter == budget.maxIterations)
           {
 #if LDPC_DEBUG_VERBOSE
             std::cout << (boost::format(" Reached max iterations at codeword %1%; bit errors = %2%") % codewordCount % sum).str() << std::endl;
             for (uint32_t dd = 0; dd < 30; dd++) {
-              printf("          e[%d] %g\n", dd, encodedPayload[processedBits-m_n+dd]);
+              printf("          e[%d] %g\n", dd, encoded[processedBits-m_n+dd]);
             }
             for (uint32_t dd = 0; dd < 30; dd++) {
-              printf("f1[%d] %g e %g\n", dd, f1[dd], encodedPayload[processedBits+dd]);
+              printf("f1[%d] %g e %g\n", dd, f1[dd], encoded[processedBits+dd]);
             }
 #endif
           }
         } // while
 
+        iterations += (uint64_t) totalIterations;
         totalBitErrors += sum;
-        codewordCount++;
 
         // Save the decoded message
-        for (uint32_t i = 0; i < m_k; i++) {
-          decodedPayload.push_back(dHat[i] % 2);
-        }
+        std::copy(dHat.begin(), dHat.begin() + m_k, decoded + codewordCount * m_k);
+        codewordCount++;
 
         processedBits += m_n;
       } // while not all input samples processed
 
-      std::cout << "Total bit errors = " << totalBitErrors << " for " << (numCodewords*m_k) << " message bits" << std::endl;
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::m_decodeMinSum(const float *encoded, uint32_t numCodewords,
+        float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+        DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const
+    {
+      uint32_t totalEncSize = numCodewords * m_n;
+
+      uint32_t totalBitErrors = 0;
+
+      uint32_t numChecks = m_n - m_k;
+      uint32_t numEdges = m_code->m_graph.numEdges();
+      const uint32_t * edgeSymbol = m_code->m_graph.edgeSymbols();
+      bool normalized = m_decodeAlgorithm == DecodeAlgorithm::NORMALIZED_MIN_SUM;
+
+      // The channel LLR is log(P(0)/P(1)), so a positive sample (a 1 bit)
+      // gives a negative LLR, consistent with the probability domain decoder
+      float sigma2 = 1.0 / pow (10.0, snrEstimate / 10.0); // noise variance
+      float llrScale = -2.0f / sigma2;
+
+      // The buffers live in the workspace; see prepareWorkspace
+      std::vector<float> &channelLLR = workspace.m_channelLLR;
+      std::vector<float> &posteriorLLR = workspace.m_posteriorLLR;
+
+      // Compressed check node state. The message on edge e from check node i
+      // has magnitude min1(i) unless e == min1Edge(i), in which case it is
+      // min2(i). The magnitudes are stored corrected (normalized or offset).
+      // Its sign is signProduct(i) times the sign of the incoming message on
+      // the edge, saved in edgeSign(e).
+      std::vector<float> &min1 = workspace.m_min1;
+      std::vector<float> &min2 = workspace.m_min2;
+      std::vector<uint32_t> &min1Edge = workspace.m_min1Index;
+      std::vector<uint8_t> &signProduct = workspace.m_signProduct;
+      std::vector<uint8_t> &edgeSign = workspace.m_edgeSign;
+
+      std::vector<uint8_t> &dHat = workspace.m_dHat; // current codeword estimate
+      std::vector<uint8_t> &syndrome = workspace.m_syndrome; // parity of each check node
+
+      for (uint32_t processedBits = 0; processedBits < totalEncSize; processedBits += m_n) {
+
+        for (uint32_t p = 0; p < m_n; p++) {
+          channelLLR[p] = llrScale * encoded[processedBits + p];
+          posteriorLLR[p] = channelLLR[p];
+          dHat[p] = channelLLR[p] < 0.0f;
+        }
+
+        // The syndrome of the channel hard decisions; from here on it is
+        // only updated for the bits that flip
+        uint32_t sum = m_code->m_graph.syndrome(dHat.data(), syndrome.data());
+        DecodeBudget::Clock::time_point deadline = budget.claim(1);
+        uint32_t bestSum = std::numeric_limits<uint32_t>::max();
+        uint32_t stalled = 0;
+
+        // All check to symbol messages start at zero
+        std::fill(min1.begin(), min1.end(), 0.0f);
+        std::fill(min2.begin(), min2.end(), 0.0f);
+        std::fill(min1Edge.begin(), min1Edge.end(), numEdges);
+        std::fill(signProduct.begin(), signProduct.end(), 0);
+        std::fill(edgeSign.begin(), edgeSign.end(), 0);
+
+        for (uint32_t iter = 0; iter < budget.maxIterations; iter++)
+        {
+          iterations++;
+
+          // Check node update using the posteriors of the previous iteration
+          for (uint32_t i = 0; i < numChecks; i++)
+          {
+            float newMin1 = std::numeric_limits<float>::max();
+            float newMin2 = std::numeric_limits<float>::max();
+            uint32_t newMin1Edge = numEdges;
+            uint8_t newSignProduct = 0;
+
+            for (uint32_t e = m_code->m_graph.checkEdgeBegin(i); e < m_code->m_graph.checkEdgeEnd(i); e++)
+            {
+              // Remove this check node's previous contribution
+              float r = (e == min1Edge[i]) ? min2[i] : min1[i];
+              if (edgeSign[e] ^ signProduct[i]) r = -r;
+              float q = posteriorLLR[edgeSymbol[e]] - r;
+
+              edgeSign[e] = q < 0.0f;
+              newSignProduct ^= edgeSign[e];
+              float mag = std::fabs (q);
+              if (mag < newMin1) {
+                newMin2 = newMin1;
+                newMin1 = mag;
+                newMin1Edge = e;
+              }
+              else if (mag < newMin2) {
+                newMin2 = mag;
+              }
+            }
+
+            if (normalized) {
+              min1[i] = m_minSumNormalization * newMin1;
+              min2[i] = m_minSumNormalization * newMin2;
+            }
+            else {
+              min1[i] = std::max (newMin1 - m_minSumOffset, 0.0f);
+              min2[i] = std::max (newMin2 - m_minSumOffset, 0.0f);
+            }
+            min1Edge[i] = newMin1Edge;
+            signProduct[i] = newSignProduct;
+          } // for all parity check nodes
+
+          // Symbol node update
+          posteriorLLR = channelLLR;
+          for (uint32_t i = 0; i < numChecks; i++)
+          {
+            for (uint32_t e = m_code->m_graph.checkEdgeBegin(i); e < m_code->m_graph.checkEdgeEnd(i); e++)
+            {
+              float r = (e == min1Edge[i]) ? min2[i] : min1[i];
+              posteriorLLR[edgeSymbol[e]] += (edgeSign[e] ^ signProduct[i]) ? -r : r;
+            }
+          }
+
+          // hard decision on the codeword bits
+          for (uint32_t j = 0; j < m_n; j++)
+          {
+            uint8_t bit = posteriorLLR[j] < 0.0f;
+            if (bit != dHat[j])
+            {
+              dHat[j] = bit;
+              m_code->m_graph.flipSymbol(j, syndrome.data(), sum);
+            }
+          }
+
+          if (sum == 0 || decodeStalled(budget.stallIterations, sum, bestSum, stalled) ||
+              budget.expired(deadline))
+            break;
+        } // for all iterations
+
+        totalBitErrors += sum;
+
+        // Save the decoded message, and the a-posteriori LLRs if wanted
+        std::copy(dHat.begin(), dHat.begin() + m_k, decoded + (processedBits / m_n) * m_k);
+        if (posteriorLLRs)
+          std::copy(posteriorLLR.begin(), posteriorLLR.end(), posteriorLLRs + processedBits);
+      } // for all codewords
+
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::m_decodeLayeredMinSum(const float *encoded, uint32_t numCodewords,
+        float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+        DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const
+    {
+      uint32_t totalEncSize = numCodewords * m_n;
+
+      uint32_t totalBitErrors = 0;
+
+      uint32_t Z = m_code->m_submatrixSize;
+      bool normalized = m_decodeAlgorithm == DecodeAlgorithm::NORMALIZED_MIN_SUM;
+
+      float sigma2 = 1.0 / pow (10.0, snrEstimate / 10.0); // noise variance
+      float llrScale = -2.0f / sigma2;
+
+      // The edges of circulant c are numbered c * Z + t for check node t
+      // within its layer
+      uint32_t numLayers = m_code->m_layerStart.size() - 1;
+      uint32_t maxLayerDegree = m_code->m_maxLayerDegree;
+
+      // The buffers live in the workspace; see prepareWorkspace
+      std::vector<float> &posteriorLLR = workspace.m_posteriorLLR;
+
+      // Compressed check node state, as for m_decodeMinSum. Here min1Index is
+      // the circulant index within the layer.
+      std::vector<float> &min1 = workspace.m_min1;
+      std::vector<float> &min2 = workspace.m_min2;
+      std::vector<uint32_t> &min1Index = workspace.m_min1Index;
+      std::vector<uint8_t> &signProduct = workspace.m_signProduct;
+      std::vector<uint8_t> &edgeSign = workspace.m_edgeSign;
+
+      // Symbol to check messages for the check node being updated
+      std::vector<float> &q = workspace.m_q;
+      std::vector<uint32_t> &symbol = workspace.m_symbol;
+
+      std::vector<uint8_t> &dHat = workspace.m_dHat; // current codeword estimate
+      std::vector<uint8_t> &syndrome = workspace.m_syndrome; // parity of each check node
+
+      for (uint32_t processedBits = 0; processedBits < totalEncSize; processedBits += m_n) {
+
+        for (uint32_t p = 0; p < m_n; p++) {
+          posteriorLLR[p] = llrScale * encoded[processedBits + p];
+          dHat[p] = posteriorLLR[p] < 0.0f;
+        }
+
+        // The syndrome of the channel hard decisions; from here on it is
+        // updated as each a-posteriori LLR changes sign
+        uint32_t sum = m_code->m_graph.syndrome(dHat.data(), syndrome.data());
+        DecodeBudget::Clock::time_point deadline = budget.claim(1);
+        uint32_t bestSum = std::numeric_limits<uint32_t>::max();
+        uint32_t stalled = 0;
+
+        // All check to symbol messages start at zero
+        std::fill(min1.begin(), min1.end(), 0.0f);
+        std::fill(min2.begin(), min2.end(), 0.0f);
+        std::fill(min1Index.begin(), min1Index.end(), maxLayerDegree);
+        std::fill(signProduct.begin(), signProduct.end(), 0);
+        std::fill(edgeSign.begin(), edgeSign.end(), 0);
+
+        for (uint32_t iter = 0; iter < budget.maxIterations; iter++)
+        {
+          iterations++;
+
+          for (uint32_t l = 0; l < numLayers; l++)
+          {
+            uint32_t firstCirculant = m_code->m_layerStart[l];
+            uint32_t degree = m_code->m_layerStart[l + 1] - firstCirculant;
+
+            for (uint32_t t = 0; t < Z; t++)
+            {
+              uint32_t i = l * Z + t;
+              float newMin1 = std::numeric_limits<float>::max();
+              float newMin2 = std::numeric_limits<float>::max();
+              uint32_t newMin1Index = degree;
+              uint8_t newSignProduct = 0;
+
+              for (uint32_t c = 0; c < degree; c++)
+              {
+                uint32_t e = (firstCirculant + c) * Z + t;
+                symbol[c] = m_code->m_circulantColumn[firstCirculant + c] * Z
+                    + (t + m_code->m_circulantShift[firstCirculant + c]) % Z;
+
+                // Remove this check node's previous contribution
+                float r = (c == min1Index[i]) ? min2[i] : min1[i];
+                if (edgeSign[e] ^ signProduct[i]) r = -r;
+                q[c] = posteriorLLR[symbol[c]] - r;
+
+                edgeSign[e] = q[c] < 0.0f;
+                newSignProduct ^= edgeSign[e];
+                float mag = std::fabs (q[c]);
+                if (mag < newMin1) {
+                  newMin2 = newMin1;
+                  newMin1 = mag;
+                  newMin1Index = c;
+                }
+                else if (mag < newMin2) {
+                  newMin2 = mag;
+                }
+              }
+
+              if (normalized) {
+                min1[i] = m_minSumNormalization * newMin1;
+                min2[i] = m_minSumNormalization * newMin2;
+              }
+              else {
+                min1[i] = std::max (newMin1 - m_minSumOffset, 0.0f);
+                min2[i] = std::max (newMin2 - m_minSumOffset, 0.0f);
+              }
+              min1Index[i] = newMin1Index;
+              signProduct[i] = newSignProduct;
+
+              // Update the a-posteriori LLRs right away
+              for (uint32_t c = 0; c < degree; c++)
+              {
+                uint32_t e = (firstCirculant + c) * Z + t;
+                float r = (c == min1Index[i]) ? min2[i] : min1[i];
+                posteriorLLR[symbol[c]] = q[c] + ((edgeSign[e] ^ signProduct[i]) ? -r : r);
+
+                uint8_t bit = posteriorLLR[symbol[c]] < 0.0f;
+                if (bit != dHat[symbol[c]])
+                {
+                  dHat[symbol[c]] = bit;
+                  m_code->m_graph.flipSymbol(symbol[c], syndrome.data(), sum);
+                }
+              }
+            } // for all check nodes in the layer
+          } // for all layers
+
+          if (sum == 0 || decodeStalled(budget.stallIterations, sum, bestSum, stalled) ||
+              budget.expired(deadline))
+            break;
+        } // for all iterations
+
+        totalBitErrors += sum;
+
+        // Save the decoded message, and the a-posteriori LLRs if wanted
+        std::copy(dHat.begin(), dHat.begin() + m_k, decoded + (processedBits / m_n) * m_k);
+        if (posteriorLLRs)
+          std::copy(posteriorLLR.begin(), posteriorLLR.end(), posteriorLLRs + processedBits);
+      } // for all codewords
+
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::m_decodeFixedPointMinSum(const float *encoded, uint32_t numCodewords,
+        float snrEstimate, uint8_t *decoded, float *posteriorLLRs,
+        DecoderWorkspace &workspace, DecodeBudget &budget, uint64_t &iterations) const
+    {
+      uint32_t totalEncSize = numCodewords * m_n;
+
+      uint32_t totalBitErrors = 0;
+
+      const LDPCKernels &kernels = ldpcKernels();
+
+      uint32_t Z = m_code->m_submatrixSize;
+      uint32_t numLayers = m_code->m_layerStart.size() - 1;
+      uint32_t numBlockColumns = m_n / Z;
+      uint32_t laneStride = ldpcKernelLaneStride(Z);
+      uint32_t stride = ldpcKernelLaneStride(2 * Z + LDPC_KERNEL_LANE_ALIGN);
+
+      float sigma2 = 1.0 / pow (10.0, snrEstimate / 10.0); // noise variance
+      float llrScale = -2.0f / sigma2 * FIXED_POINT_LLR_SCALE;
+      int8_t offset = (int8_t) std::min(127.0f, std::round(m_minSumOffset * FIXED_POINT_LLR_SCALE));
+
+      // See ldpc_kernel.h for the layout, and prepareWorkspace for the sizes
+      std::vector<int8_t> &posterior = workspace.m_posterior;
+      std::vector<int8_t> &messages = workspace.m_messages;
+      std::vector<int8_t> &scratch = workspace.m_scratch;
+      std::vector<int8_t> &channel = workspace.m_channel;
+
+      for (uint32_t processedBits = 0; processedBits < totalEncSize; processedBits += m_n) {
+
+        // Quantize, rounding to nearest, and fill both copies of each block
+        // column
+        const float *r = encoded + processedBits;
+        for (uint32_t i = 0; i < m_n; i++)
+        {
+          float llr = std::max(-127.0f, std::min(127.0f, llrScale * r[i]));
+          channel[i] = (int8_t) (llr + (llr < 0.0f ? -0.5f : 0.5f));
+        }
+        for (uint32_t j = 0; j < numBlockColumns; j++)
+        {
+          int8_t *column = posterior.data() + j * stride;
+          std::memcpy(column, &channel[j * Z], Z);
+          std::memcpy(column + Z, &channel[j * Z], Z);
+        }
+
+        // All check to symbol messages start at zero
+        std::fill(messages.begin(), messages.end(), 0);
+
+        uint32_t sum = 0;
+        DecodeBudget::Clock::time_point deadline = budget.claim(1);
+        uint32_t bestSum = std::numeric_limits<uint32_t>::max();
+        uint32_t stalled = 0;
+        for (uint32_t iter = 0; iter < budget.maxIterations; iter++)
+        {
+          iterations++;
+
+          for (uint32_t l = 0; l < numLayers; l++)
+          {
+            uint32_t c = m_code->m_layerStart[l];
+            kernels.layerUpdate(&m_code->m_circulantColumn[c], &m_code->m_circulantShift[c],
+                m_code->m_layerStart[l + 1] - c, Z, stride, offset, posterior.data(),
+                messages.data() + c * laneStride, scratch.data());
+          }
+
+          sum = 0;
+          for (uint32_t l = 0; l < numLayers; l++)
+          {
+            uint32_t c = m_code->m_layerStart[l];
+            sum += kernels.layerSyndrome(&m_code->m_circulantColumn[c], &m_code->m_circulantShift[c],
+                m_code->m_layerStart[l + 1] - c, Z, stride, posterior.data());
+          }
+          if (sum == 0 || decodeStalled(budget.stallIterations, sum, bestSum, stalled) ||
+              budget.expired(deadline))
+            break;
+        } // for all iterations
+
+        totalBitErrors += sum;
+
+        // Save the decoded message, hard decision on the systematic bits
+        uint8_t *message = decoded + (processedBits / m_n) * m_k;
+        for (uint32_t j = 0; j < m_k / Z; j++)
+          for (uint32_t m = 0; m < Z; m++)
+            message[j * Z + m] = posterior[j * stride + m] < 0;
+
+        // The a-posteriori LLRs, if wanted, back on the channel LLR scale
+        if (posteriorLLRs)
+          for (uint32_t j = 0; j < numBlockColumns; j++)
+            for (uint32_t m = 0; m < Z; m++)
+              posteriorLLRs[processedBits + j * Z + m] =
+                  posterior[j * stride + m] / FIXED_POINT_LLR_SCALE;
+      } // for all codewords
+
+      return totalBitErrors;
+    }
+
+    uint32_t
+    LDPC::m_decodeInterleavedMinSum(const float * const *encoded,
+        uint8_t * const *decoded, float * const *posteriorLLRs,
+        uint32_t numCodewords, float snrEstimate, DecoderWorkspace &workspace,
+        DecodeBudget &budget, uint64_t &iterations) const
+    {
+      uint32_t totalBitErrors = 0;
+
+      const LDPCKernels &kernels = ldpcKernels();
+      uint32_t W = kernels.frameLanes;
+
+      uint32_t Z = m_code->m_submatrixSize;
+      uint32_t numLayers = m_code->m_layerStart.size() - 1;
+
+      float sigma2 = 1.0 / pow (10.0, snrEstimate / 10.0); // noise variance
+      float llrScale = -2.0f / sigma2 * FIXED_POINT_LLR_SCALE;
+      int8_t offset = (int8_t) std::min(127.0f, std::round(m_minSumOffset * FIXED_POINT_LLR_SCALE));
+
+      // See ldpc_kernel.h for the layout, and prepareWorkspace for the sizes
+      std::vector<int8_t> &posterior = workspace.m_posterior;
+      std::vector<int8_t> &messages = workspace.m_messages;
+      std::vector<int8_t> &scratch = workspace.m_scratch;
+      std::vector<int8_t> &active = workspace.m_active;
+      std::vector<int8_t> &channel = workspace.m_channel;
+      std::vector<uint16_t> &unsatisfied = workspace.m_unsatisfied;
+      std::vector<uint32_t> &best = workspace.m_best;
+      std::vector<uint32_t> &stalled = workspace.m_stalled;
+
+      for (uint32_t first = 0; first < numCodewords; first += W) {
+        uint32_t count = std::min(W, numCodewords - first);
+
+        // Quantize as m_decodeFixedPointMinSum does, one codeword at a time,
+        // then interleave them. Quantizing straight into the lanes would
+        // touch a new cache line per sample. Unused lanes hold the all zero
+        // codeword, which is already decoded.
+        std::fill(channel.begin() + count * m_n, channel.end(), 0);
+        for (uint32_t f = 0; f < count; f++)
+        {
+          const float *r = encoded[first + f];
+          int8_t *q = channel.data() + f * m_n;
+          for (uint32_t i = 0; i < m_n; i++)
+          {
+            float llr = std::max(-127.0f, std::min(127.0f, llrScale * r[i]));
+            q[i] = (int8_t) (llr + (llr < 0.0f ? -0.5f : 0.5f));
+          }
+        }
+        for (uint32_t i = 0; i < m_n; i++)
+          for (uint32_t f = 0; f < W; f++)
+            posterior[i * W + f] = channel[f * m_n + i];
+
+        // All check to symbol messages start at zero
+        std::fill(messages.begin(), messages.end(), 0);
+
+        // Each codeword stops when it decodes or stalls, the others carry on,
+        // and all stop when the group's time is up
+        DecodeBudget::Clock::time_point deadline = budget.claim(count);
+        uint32_t activeLanes = count == 32 ? 0xffffffffu : (1u << count) - 1;
+        std::fill(best.begin(), best.end(), std::numeric_limits<uint32_t>::max());
+        std::fill(stalled.begin(), stalled.end(), 0);
+        std::fill(unsatisfied.begin(), unsatisfied.end(), 0);
+        for (uint32_t iter = 0; iter < budget.maxIterations && activeLanes != 0; iter++)
+        {
+          iterations += __builtin_popcount(activeLanes);
+          for (uint32_t f = 0; f < W; f++)
+            active[f] = (activeLanes >> f) & 1 ? -1 : 0;
+
+          for (uint32_t l = 0; l < numLayers; l++)
+          {
+            uint32_t c = m_code->m_layerStart[l];
+            kernels.interleavedLayerUpdate(&m_code->m_circulantColumn[c], &m_code->m_circulantShift[c],
+                m_code->m_layerStart[l + 1] - c, Z, offset, active.data(), posterior.data(),
+                messages.data() + c * Z * W, scratch.data());
+          }
+
+          // Frozen codewords do not change, so their counts stay as they were
+          std::fill(unsatisfied.begin(), unsatisfied.end(), 0);
+          for (uint32_t l = 0; l < numLayers; l++)
+          {
+            uint32_t c = m_code->m_layerStart[l];
+            kernels.interleavedLayerSyndrome(&m_code->m_circulantColumn[c], &m_code->m_circulantShift[c],
+                m_code->m_layerStart[l + 1] - c, Z, posterior.data(), unsatisfied.data());
+          }
+          for (uint32_t f = 0; f < count; f++)
+            if (((activeLanes >> f) & 1) && (unsatisfied[f] == 0 ||
+                decodeStalled(budget.stallIterations, unsatisfied[f], best[f], stalled[f])))
+              activeLanes &= ~(1u << f);
+          if (activeLanes != 0 && budget.expired(deadline, __builtin_popcount(activeLanes)))
+            activeLanes = 0;
+        } // for all iterations
+
+        for (uint32_t f = 0; f < count; f++)
+          totalBitErrors += unsatisfied[f];
+
+        // Save the decoded messages, hard decision on the systematic bits
+        for (uint32_t f = 0; f < count; f++)
+        {
+          uint8_t *message = decoded[first + f];
+          for (uint32_t i = 0; i < m_k; i++)
+            message[i] = posterior[i * W + f] < 0;
+        }
+        if (posteriorLLRs)
+          for (uint32_t f = 0; f < count; f++)
+          {
+            float *llr = posteriorLLRs[first + f];
+            for (uint32_t i = 0; i < m_n; i++)
+              llr[i] = posterior[i * W + f] / FIXED_POINT_LLR_SCALE;
+          }
+      } // for all groups of codewords
+
       return totalBitErrors;
     }
 
@@ -496,29 +1716,31 @@ namespace xiphos
 
       float sigma2 = 1.0 / pow (10.0, snrEstimate / 10.0); // noise variance
 
+      // The messages are stored per edge of the Tanner graph, in check node
+      // order; see TannerGraph
+      uint32_t numEdges = m_code->m_graph.numEdges();
+      const uint32_t * edgeSymbol = m_code->m_graph.edgeSymbols();
+      const uint32_t * symbolEdges = m_code->m_graph.symbolEdges();
+
       Eigen::VectorXd f0 = Eigen::VectorXd::Zero (m_n);
       Eigen::VectorXd f1 = Eigen::VectorXd::Zero (m_n);
-      Eigen::MatrixXd Q0 (m_n - m_k, m_n);
-      Eigen::MatrixXd Q1 (m_n - m_k, m_n);
-      Eigen::MatrixXd deltaQ (m_n - m_k, m_n);
-      Eigen::MatrixXd R0 (m_n - m_k, m_n);
-      Eigen::MatrixXd R1 (m_n - m_k, m_n);
-      Eigen::MatrixXd deltaR (m_n - m_k, m_n);
+      std::vector<double> Q0 (numEdges);
+      std::vector<double> Q1 (numEdges);
+      std::vector<double> deltaQ (numEdges);
+      std::vector<double> R0 (numEdges);
+      std::vector<double> R1 (numEdges);
       Eigen::VectorXi dHat (m_n); // current codeword estimate
       Eigen::VectorXi cwCheck (m_n - m_k); // used to check dHat, codeword est.
 
-      Eigen::VectorXi decoded = Eigen::VectorXi::Zero (m_k);
       Eigen::VectorXd r(m_n);
 
-      unsigned int maxConnectedSymbolNodes = m_N_numSymbolNodes.maxCoeff ();
-
       uint32_t processedBits = 0;
       while (processedBits < totalEncSize) {
         double totalIterations = 0;
 
 #if LDPC_DEBUG_VERBOSE
         printf("sigma2 %f\n",sigma2);
-        printf("max iterations %d\n",m_decodeIterations);
+        printf("max iterations %d\n",m_decodeIterations.load());
 #endif
         for (uint32_t p = 0; p < m_n; p++)
           r[p] = encodedPayload[processedBits+p];
@@ -544,102 +1766,89 @@ namespace xiphos
         printf("\n");
 #endif
         // initilize Q0 and Q1
-        for (unsigned int i = 0; i < m_n - m_k; i++)
+        for (uint32_t e = 0; e < numEdges; e++)
         {
-          for (int j = 0; j < m_N_numSymbolNodes (i); j++)
-          {
-            Q0 (i, m_N (i, j)) = f0 (m_N (i, j));
-            Q1 (i, m_N (i, j)) = f1 (m_N (i, j));
-          }
+          Q0[e] = f0 (edgeSymbol[e]);
+          Q1[e] = f1 (edgeSymbol[e]);
         }
-#if LDPC_DEBUG_VERBOSE
-        std::cout << "Q0\n" << Q0 << std::endl;
-        std::cout << "Q1\n" << Q1 << std::endl;
-#endif
+
         unsigned int iter = 0;
         while (iter < m_decodeIterations)
         {
           totalIterations++;
 
-          deltaQ = Q0 - Q1;
+          for (uint32_t e = 0; e < numEdges; e++)
+            deltaQ[e] = Q0[e] - Q1[e];
 
-          // update deltaR
+          // update deltaR, then R0 and R1, one check node at a time
           for (unsigned int i = 0; i < m_n - m_k; i++)
           {
-            for (int j = 0; j < m_N_numSymbolNodes (i); j++)
+            uint32_t begin = m_code->m_graph.checkEdgeBegin(i);
+            uint32_t end = m_code->m_graph.checkEdgeEnd(i);
+            for (uint32_t e = begin; e < end; e++)
             {
-              deltaR (i, m_N (i, j)) = 1.0;
-              for (int k = 0; k < m_N_numSymbolNodes (i); k++)
+              double deltaR = 1.0;
+              for (uint32_t k = begin; k < end; k++)
               {
-                if (k != j)
-                  deltaR (i, m_N (i, j)) = deltaR (i, m_N (i, j))
-                  * deltaQ (i, m_N (i, k));
+                if (k != e)
+                  deltaR = deltaR * deltaQ[k];
               }
+              R0[e] = 0.5 * (1.0 + deltaR);
+              R1[e] = 0.5 * (1.0 - deltaR);
+              // TODO do we have to replace the 0.5 values?
+              if (R0[e] == 0.5) R0[e] = 0.0;
+              if (R1[e] == 0.5) R1[e] = 0.0;
             } // for all symbols nodes connected to the current parity check node
           } // for all parity check nodes
 
-          R0 = Eigen::MatrixXd::Ones (m_n - m_k, m_n) + deltaR;
-          R0 = 0.5 * R0;
-          R1 = Eigen::MatrixXd::Ones (m_n - m_k, m_n) - deltaR;
-          R1 = 0.5 * R1;
-          // TODO do we have to replace the 0.5 values?
-          R0 = (R0.array () == 0.5).select (0.0, R0.array ());
-          R1 = (R1.array () == 0.5).select (0.0, R1.array ());
-
-#if LDPC_DEBUG_VERBOSE
-          std::cout << "R0\n" << R0 << std::endl;
-          std::cout << "R1\n" << R1 << std::endl;
-#endif
-
           // Values R appear as normalized values with respect to those seen
           // in tables 8.2 to 8.12. By normalizing values NaN is avoided.
 
-          for (unsigned int i = 0; i < m_n - m_k; i++)
+          for (uint32_t e = 0; e < numEdges; e++)
           {
-            Eigen::MatrixXd g = Eigen::MatrixXd::Zero (m_n - m_k,
-                maxConnectedSymbolNodes);
-            for (int j = 0; j < m_N_numSymbolNodes (i); j++)
-            {
-              double b0 = 1;
-              double b1 = 1;
+            uint32_t sn = edgeSymbol[e];
+            double b0 = 1;
+            double b1 = 1;
 
-              for (int p1 = 0; p1 < m_M_numCheckNodes (m_N (i, j));
-                  p1++)
+            if (sn != 0)
+            {
+              for (uint32_t p1 = m_code->m_graph.symbolEdgeBegin(sn);
+                  p1 < m_code->m_graph.symbolEdgeEnd(sn); p1++)
               {
-                if (m_N (i, j) != 0 and ((long) i) != m_M (m_N (i, j), p1))
+                uint32_t other = symbolEdges[p1];
+                if (other != e)
                 {
-                  b0 = b0 * R0 (m_M (m_N (i, j), p1), m_N (i, j));
-                  b1 = b1 * R1 (m_M (m_N (i, j), p1), m_N (i, j));
+                  b0 = b0 * R0[other];
+                  b1 = b1 * R1[other];
                 }
               }
+            }
 
-              // Normalization of coefficients
-              b0 = f0 (m_N (i, j)) * b0;
-              b1 = f1 (m_N (i, j)) * b1;
-
-              if (b0 == 0 and b1 == 0)
-              {
-                Q0 (i, m_N (i, j)) = 0;
-                Q1 (i, m_N (i, j)) = 0;
-              }
-              else
-              {
-                g (i, j) = 1.0 / (b0 + b1);
-                Q0 (i, m_N (i, j)) = b0 * g (i, j);
-                Q1 (i, m_N (i, j)) = b1 * g (i, j);
-              }
+            // Normalization of coefficients
+            b0 = f0 (sn) * b0;
+            b1 = f1 (sn) * b1;
 
-            } // for all symbols nodes connected to the current parity check node
-          } // for all parity check nodes
+            if (b0 == 0 and b1 == 0)
+            {
+              Q0[e] = 0;
+              Q1[e] = 0;
+            }
+            else
+            {
+              double g = 1.0 / (b0 + b1);
+              Q0[e] = b0 * g;
+              Q1[e] = b1 * g;
+            }
+          } // for all edges
 
           Eigen::VectorXd d0 = Eigen::VectorXd::Ones (m_n);
           Eigen::VectorXd d1 = Eigen::VectorXd::Ones (m_n);
           for (unsigned int j = 0; j < m_n; j++)
           {
-            for (int i = 0; i < m_M_numCheckNodes (j); i++)
+            for (uint32_t p1 = m_code->m_graph.symbolEdgeBegin(j); p1 < m_code->m_graph.symbolEdgeEnd(j); p1++)
             {
-              d0 (j) = d0 (j) * R0 (m_M (j, i), j);
-              d1 (j) = d1 (j) * R1 (m_M (j, i), j);
+              d0 (j) = d0 (j) * R0[symbolEdges[p1]];
+              d1 (j) = d1 (j) * R1[symbolEdges[p1]];
             }
             d0 (j) = d0 (j) * f0 (j);
             d1 (j) = d1 (j) * f1 (j);
@@ -655,7 +1864,7 @@ namespace xiphos
 #if LDPC_DEBUG_VERBOSE
           std::cout << "dHat\n" << dHat.transpose() << std::endl;
 #endif
-          cwCheck = m_parityCheckMatrix * dHat;
+          cwCheck = m_code->getParityMatrix() * dHat;
 
           sum = 0;
           for (unsigned int c = 0; c < cwCheck.size (); c++)
@@ -713,179 +1922,31 @@ namespace xiphos
     LDPC::setDecodeIterations (
         uint32_t decodeIterations)
     {
-      if (decodeIterations != m_decodeIterations)
-      {
-        // TODO update the number of iterations when it's safe
-        m_decodeIterations = decodeIterations;
-      }
-    }
-
-    const Eigen::MatrixXi  &
-    LDPC::getParityMatrix() const
-    {
-      return m_parityCheckMatrix;
-    }
-
-    /*!
-     * @brief Matrices needed to support encoding
-     *
-     * @note See Richardson, T., Urbanke, R., "Efficient Encoding of Low-
-     * Density Parity-Check Codes". IEEE Trans. on Information Theory,
-     * Feb. 2001
-     */
-    void
-    LDPC::m_makeEncoderMatrices()
-    {
-      // The parity check matrix H is quasi-cyclic by design. I think this means
-      // that a the minimum "gap" size (g) is <= Z, the prototype matrix size. We can
-      // either just choose that value or search the last column of H for the first
-      // non-zero value row index r and calculate g as n - r.
-
-      uint32_t n = m_parityCheckMatrix.cols();   // codeword size
-      uint32_t m = m_parityCheckMatrix.rows();   // parity check row count
-      uint32_t g = m_pchk->prototypeMatrixSize(); // Assume Z is gap size
-
-      // The objective is to put H into the partial lower-trianglar form
-      // described in the paper as
-      //
-      // H = [ A B T ]
-      //     [ C D E ]
-      //
-      // Where,
-      //   A is m - g x n - m
-      //   B is m - g x g
-      //   T is m - g x m - g
-      //   C is     g x n - m
-      //   D is     g x g
-      //   E is     g x m - g
-
-      Eigen::MatrixXd H = m_parityCheckMatrix.cast <double> ();
-
-      // Extract A, B, C, D, E and T from H
-      m_A = Eigen::MatrixXd(m-g,n-m);
-      m_A = H.block(0,0,m-g,n-m);
-      m_B = Eigen::MatrixXd(m-g,g);
-      m_B = H.block(0,n-m,m-g,g);
-      Eigen::MatrixXd T(m-g,m-g);
-      T = H.block(0,n-m+g,m-g,m-g);
-      Eigen::MatrixXd C(g,n-m);
-      C = H.block(m-g,0,g,n-m);
-      Eigen::MatrixXd D(g,g);
-      D = H.block(m-g,n-m,g,g);
-      Eigen::MatrixXd E(g,m-g);
-      E = H.block(m-g,n-m+g,g,m-g);
-
-      // From the paper, multiply H on the left by equation/term (6)
-      //   [I          0]
-      //   [-E*inv(T)  I]                                                (6)
-      // to get equation/term (7)
-      //   [     A                B           T]
-      //   [-E*inv(T)*A + C  -E*inv(T)*B + D  0]                         (7)
-      //
-      // If the codeword x is systematic so that x = [s, p1, p2] where s are
-      // the message bits, then the requirement that the parity matrix and the
-      // codeword be orthogonal leads to the equation H*trans(x) = trans(0). This
-      // leads to equations (8) and (9)
-      //   A*trans(s) + B*trans(p1) + T*trans(p2) = 0                    (8)
-      //   (-E*inv(T)*A + C)*trans(s) + (-E*inv(T)*B + D)*trans(p1) = 0  (9)
-      //
-
-      // create all the rest of the matrices needed to encode messages and, if so
-      // desired, check the codewords against the parity check matrix
-
-      Eigen::MatrixXd invT = T.inverse();
-      Eigen::MatrixXd EinvT = -(E*invT);
-
-      // From the paper, p1 is calculated using
-      //   p1 = mod(-inv(phi)*EinvTA_C*(msg'),2)
-      // However, because H is quasi-cyclic, phi is always -I (i.e., -eye(Z).
-      // Since the product is forced into GF2 (i.e., elements are 1 or 0), the
-      // sign is irrelevant and we can do away with the multiplication by I. That
-      // is, we don't need or use phi.
-
-      Eigen::MatrixXd phi = EinvT*m_B + D; // calculate for now, for no good reason except I'm paranoid
-
-      // used to calculate p1 as per above
-      m_EinvTA_C = EinvT*m_A + C;
-
-      // save some time in calculating p2 by precalculating these two products
-      m_invTA = invT*m_A;
-      m_invTB = invT*m_B;
-
-      // Now make sparse versions
-      // TODO make sure these are actually used... are there other places?
-      m_sA = m_A.sparseView();
-      m_sB = m_B.sparseView();
-      m_sEinvTA_C = m_EinvTA_C.sparseView();
-      m_sinvTA = m_invTA.sparseView();
-      m_sinvTB = m_invTB.sparseView();
+      if (decodeIterations == 0)
+        decodeIterations = DECODE_ITERATIONS_DEFAULT;
+      // A decode already running took its own copy in its DecodeBudget
+      m_decodeIterations = decodeIterations;
     }
 
     void
-    LDPC::m_makeDecoderMatrices()
+    LDPC::setMinSumCorrection (
+        float normalization,
+        float offset)
     {
-      int maxCheckNodes = 0;
-      int maxSymbolNodes = 0;
-      // find the largest number of check nodes connected to a symbol node over all
-      // symbol nodes
-      for (unsigned int sn = 0; sn < m_n; sn++)
-      {
-        int count = 0;
-        for (unsigned int cn = 0; cn < (m_n - m_k); cn++)
-          if (m_parityCheckMatrix (cn, sn) > 0) count++;
-        if (count > maxCheckNodes) maxCheckNodes = count;
-      }
-
-      // find the largest number of symbol nodes connected to a check node over all
-      // check nodes
-      for (unsigned int cn = 0; cn < (m_n - m_k); cn++)
-      {
-        int count = 0;
-        for (unsigned int sn = 0; sn < m_n; sn++)
-          if (m_parityCheckMatrix (cn, sn) > 0) count++;
-        if (count > maxSymbolNodes) maxSymbolNodes = count;
-      }
-#if LDPC_DEBUG_VERBOSE
-      std::cout << "maxCheckNodes " << maxCheckNodes << std::endl;
-      std::cout << "maxSymbolNodes " << maxSymbolNodes << std::endl;
-#endif
-      // M(j) represents the set of indexes of all the children parity check nodes
-      // connected to the symbol node d(j)
-      m_M = Eigen::MatrixXi::Zero (m_n, maxCheckNodes);
-      m_M_numCheckNodes = Eigen::VectorXi::Zero (m_n);
-      // N(i) represents the set of indexes of all the parent symbol nodes connected
-      // to the parity check node h(i)
-      m_N = Eigen::MatrixXi::Zero (m_n - m_k, maxSymbolNodes);
-      m_N_numSymbolNodes = Eigen::VectorXi::Zero (m_n - m_k);
-
-      // populate M(j) with check nodes connected to a symbol node over all
-      // symbol nodes
-      for (unsigned int sn = 0; sn < m_n; sn++)
-      {
-        int count = 0;
-        for (unsigned int cn = 0; cn < (m_n - m_k); cn++)
-          if (m_parityCheckMatrix (cn, sn) > 0) m_M (sn, count++) = cn;
-        m_M_numCheckNodes (sn) = count;
-      }
-
-      // populate N(i) symbol nodes connected to a check node over all
-      // check nodes
-      for (unsigned int cn = 0; cn < (m_n - m_k); cn++)
-      {
-        int count = 0;
-        for (unsigned int sn = 0; sn < m_n; sn++)
-          if (m_parityCheckMatrix (cn, sn) > 0) m_N (cn, count++) = sn;
-        m_N_numSymbolNodes (cn) = count;
+      if (normalization <= 0.0f or normalization > 1.0f or offset < 0.0f) {
+        throw LDPCException((boost::format ("Bad min-sum correction; normalization %1% offset %2%")
+        % normalization % offset).str());
       }
+      m_minSumNormalization = normalization;
+      m_minSumOffset = offset;
+    }
 
-#if LDPC_DEBUG_VERBOSE
-      std::cout << "m_M\n" << m_M << std::endl;
-      std::cout << "m_M_numCheckNodes\n" << m_M_numCheckNodes << std::endl;
-      std::cout << "m_N\n" << m_N << std::endl;
-      std::cout << "m_N_numSymbolNodes\n" << m_N_numSymbolNodes << std::endl;
-#endif
+    const Eigen::MatrixXi  &
+    LDPC::getParityMatrix() const
+    {
+      return m_code->getParityMatrix();
     }
 
 
-  } /* namespace darkstar */
-} /* namespace xiphos */
+  } /* namespace sdr */
+} /* namespace ex2 */
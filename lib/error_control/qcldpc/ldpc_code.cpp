@@ -0,0 +1,790 @@
+/*!
+ * @file ldpc_code.cpp
+ * @author Steven Knudsen
+ * @date June 17, 2021
+ *
+ * @details The shared structures of a QC-LDPC code.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/format.hpp>
+
+#include "ldpc_code.h"
+
+#define LDPC_DEBUG_VERBOSE 0
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    namespace
+    {
+      struct CodeRegistry
+      {
+        std::mutex mutex;
+        std::map<ErrorCorrection::ErrorCorrectionScheme,
+          std::shared_ptr<const LDPCCode> > codes;
+        std::string cacheDirectory;
+      };
+
+      CodeRegistry &
+      codeRegistry()
+      {
+        static CodeRegistry registry;
+        return registry;
+      }
+
+      // The tables of a code file, in file order. Each is an array of 32 bit
+      // words; the encoder matrices are (row, column, value) triplets of
+      // their nonzero entries, and the generator is its 64 bit words in
+      // native order. A code has either the encoder matrices or the
+      // generator; the other tables are empty.
+      enum CodeFileTable
+      {
+        TABLE_LAYER_START,
+        TABLE_CIRCULANT_COLUMN,
+        TABLE_CIRCULANT_SHIFT,
+        TABLE_M,
+        TABLE_M_NUM_CHECK_NODES,
+        TABLE_N,
+        TABLE_N_NUM_SYMBOL_NODES,
+        TABLE_CHECK_EDGE_START,
+        TABLE_EDGE_SYMBOL,
+        TABLE_EDGE_CHECK,
+        TABLE_SYMBOL_EDGE_START,
+        TABLE_SYMBOL_EDGES,
+        TABLE_SYMBOL_CHECK,
+        TABLE_A,
+        TABLE_B,
+        TABLE_EINVTA_C,
+        TABLE_INVTA,
+        TABLE_INVTB,
+        TABLE_QC_GENERATOR,
+        NUM_CODE_FILE_TABLES
+      };
+
+      const char CODE_FILE_MAGIC[8] = { 'E', 'X', '2', 'L', 'D', 'P', 'C', '\0' };
+      const uint32_t CODE_FILE_BYTE_ORDER = 0x01020304;
+
+      // The tables follow the header directly
+      struct CodeFileHeader
+      {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t scheme;
+        uint32_t prototypeHash;
+        uint32_t maxCheckNodes;  // columns of M
+        uint32_t maxSymbolNodes; // columns of N
+        uint32_t maxLayerDegree;
+        uint32_t maxCheckDegree;
+        uint32_t qcEncoder;
+        uint32_t qcParityShift;
+        uint32_t checksum;       // of the header, with this zero, and the tables
+        uint32_t tableWords[NUM_CODE_FILE_TABLES];
+      };
+
+      // FNV-1a, a word at a time
+      uint32_t
+      hashWords(const uint32_t *words, size_t count, uint32_t hash = 2166136261u)
+      {
+        for (size_t w = 0; w < count; w++)
+          hash = (hash ^ words[w]) * 16777619u;
+        return hash;
+      }
+
+      // Where the checksum of a file starts; the tables are hashed on
+      uint32_t
+      hashHeader(CodeFileHeader header)
+      {
+        header.checksum = 0;
+        return hashWords(reinterpret_cast<const uint32_t *>(&header), sizeof(header) / sizeof(uint32_t));
+      }
+
+      uint32_t
+      prototypeHash(const ParityCheck &pchk)
+      {
+        const Eigen::MatrixXi &protoH = pchk.prototypeMatrix();
+        uint32_t dims[3] = { static_cast<uint32_t>(protoH.rows()),
+            static_cast<uint32_t>(protoH.cols()), pchk.prototypeMatrixSize() };
+        return hashWords(reinterpret_cast<const uint32_t *>(protoH.data()),
+            protoH.size(), hashWords(dims, 3));
+      }
+
+      // The encoder matrices only hold small integers
+      std::vector<uint32_t>
+      encoderTriplets(const Eigen::MatrixXd &m)
+      {
+        std::vector<uint32_t> triplets;
+        for (Eigen::Index j = 0; j < m.cols(); j++)
+          for (Eigen::Index i = 0; i < m.rows(); i++)
+            if (m(i, j) != 0.0)
+            {
+              triplets.push_back(i);
+              triplets.push_back(j);
+              triplets.push_back(static_cast<int32_t>(std::lround(m(i, j))));
+            }
+        return triplets;
+      }
+
+      Eigen::MatrixXd
+      encoderMatrix(const uint32_t *triplets, uint32_t words, uint32_t rows,
+          uint32_t cols)
+      {
+        Eigen::MatrixXd m = Eigen::MatrixXd::Zero(rows, cols);
+        for (uint32_t w = 0; w + 2 < words; w += 3)
+        {
+          if (triplets[w] >= rows || triplets[w + 1] >= cols)
+            throw std::runtime_error("LDPCCode: Encoder matrix entry out of range");
+          m(triplets[w], triplets[w + 1]) = static_cast<int32_t>(triplets[w + 2]);
+        }
+        return m;
+      }
+
+      // A read-only private mapping of a whole file
+      class MappedFile
+      {
+      public:
+        explicit MappedFile(const std::string &path) : m_data(nullptr), m_size(0)
+        {
+          int fd = open(path.c_str(), O_RDONLY);
+          if (fd < 0)
+            throw std::runtime_error((boost::format("LDPCCode: Unable to open %s") % path).str());
+          struct stat status;
+          if (fstat(fd, &status) == 0 && status.st_size > 0)
+          {
+            void *data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+              m_data = static_cast<const uint8_t *>(data);
+              m_size = status.st_size;
+            }
+          }
+          close(fd);
+          if (m_data == nullptr)
+            throw std::runtime_error((boost::format("LDPCCode: Unable to map %s") % path).str());
+        }
+
+        ~MappedFile()
+        {
+          munmap(const_cast<uint8_t *>(m_data), m_size);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        const uint8_t *data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+      private:
+        const uint8_t *m_data;
+        size_t m_size;
+      };
+
+      std::shared_ptr<const LDPCCode>
+      cachedCode(ErrorCorrection::ErrorCorrectionScheme ecScheme,
+          const std::string &path)
+      {
+        try {
+          std::shared_ptr<const LDPCCode> code = LDPCCode::load(path);
+          if (code->getErrorCorrectionScheme() == ecScheme)
+            return code;
+        }
+        catch (std::exception &e) {
+          // Missing, stale or damaged; build it and replace the file
+#if LDPC_DEBUG_VERBOSE
+          std::cout << e.what() << std::endl;
+#endif
+        }
+
+        std::shared_ptr<const LDPCCode> code = std::make_shared<const LDPCCode>(ecScheme);
+        try {
+          code->save(path);
+        }
+        catch (std::exception &e) {
+#if LDPC_DEBUG_VERBOSE
+          std::cout << e.what() << std::endl;
+#endif
+        }
+        return code;
+      }
+    }
+
+    const uint32_t LDPCCode::FILE_VERSION;
+
+    std::shared_ptr<const LDPCCode>
+    LDPCCode::get(ErrorCorrection::ErrorCorrectionScheme ecScheme)
+    {
+      CodeRegistry &registry = codeRegistry();
+
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      auto code = registry.codes.find(ecScheme);
+      if (code == registry.codes.end())
+      {
+        std::shared_ptr<const LDPCCode> built = registry.cacheDirectory.empty() ?
+            std::make_shared<const LDPCCode>(ecScheme) :
+            cachedCode(ecScheme, registry.cacheDirectory + "/" + cacheFileName(ecScheme));
+        code = registry.codes.emplace(ecScheme, built).first;
+      }
+      return code->second;
+    }
+
+    void
+    LDPCCode::setCacheDirectory(const std::string &directory)
+    {
+      CodeRegistry &registry = codeRegistry();
+
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.cacheDirectory = directory;
+    }
+
+    std::string
+    LDPCCode::cacheFileName(ErrorCorrection::ErrorCorrectionScheme ecScheme)
+    {
+      return (boost::format("ldpc_code_%02x.bin") % static_cast<uint32_t>(ecScheme)).str();
+    }
+
+    std::shared_ptr<const LDPCCode>
+    LDPCCode::load(const std::string &path)
+    {
+      MappedFile file(path);
+
+      if (file.size() < sizeof(CodeFileHeader))
+        throw std::runtime_error((boost::format("LDPCCode: %s is too short") % path).str());
+      const CodeFileHeader *header = reinterpret_cast<const CodeFileHeader *>(file.data());
+      if (std::memcmp(header->magic, CODE_FILE_MAGIC, sizeof(CODE_FILE_MAGIC)) != 0 ||
+          header->byteOrder != CODE_FILE_BYTE_ORDER ||
+          header->version != FILE_VERSION)
+        throw std::runtime_error((boost::format("LDPCCode: %s is not a version %d code file")
+          % path % FILE_VERSION).str());
+      if (header->scheme < static_cast<uint32_t>(ErrorCorrection::ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280) ||
+          header->scheme > static_cast<uint32_t>(ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_5_6))
+        throw std::runtime_error((boost::format("LDPCCode: %s is not for an LDPC scheme") % path).str());
+
+      return std::shared_ptr<const LDPCCode>(new LDPCCode(
+          static_cast<ErrorCorrection::ErrorCorrectionScheme>(header->scheme),
+          file.data(), file.size()));
+    }
+
+    void
+    LDPCCode::save(const std::string &path) const
+    {
+      // Only the encoder the code uses; see LDPC::encode
+      std::vector<uint32_t> A, B, EinvTA_C, invTA, invTB;
+      if (m_qcEncoder)
+      {
+        m_prepareEncoderMatrices();
+        A = encoderTriplets(m_A);
+        B = encoderTriplets(m_B);
+        EinvTA_C = encoderTriplets(m_EinvTA_C);
+        invTA = encoderTriplets(m_invTA);
+        invTB = encoderTriplets(m_invTB);
+      }
+      else
+        m_prepareQCGenerator();
+
+      struct Table
+      {
+        const uint32_t *data;
+        size_t words;
+      };
+      const Table tables[NUM_CODE_FILE_TABLES] = {
+          { m_layerStart.data(), m_layerStart.size() },
+          { m_circulantColumn.data(), m_circulantColumn.size() },
+          { m_circulantShift.data(), m_circulantShift.size() },
+          { reinterpret_cast<const uint32_t *>(m_M.data()), size_t(m_M.size()) },
+          { reinterpret_cast<const uint32_t *>(m_M_numCheckNodes.data()), size_t(m_M_numCheckNodes.size()) },
+          { reinterpret_cast<const uint32_t *>(m_N.data()), size_t(m_N.size()) },
+          { reinterpret_cast<const uint32_t *>(m_N_numSymbolNodes.data()), size_t(m_N_numSymbolNodes.size()) },
+          { m_graph.m_checkEdgeStart.data(), m_graph.m_checkEdgeStart.size() },
+          { m_graph.m_edgeSymbol.data(), m_graph.m_edgeSymbol.size() },
+          { m_graph.m_edgeCheck.data(), m_graph.m_edgeCheck.size() },
+          { m_graph.m_symbolEdgeStart.data(), m_graph.m_symbolEdgeStart.size() },
+          { m_graph.m_symbolEdges.data(), m_graph.m_symbolEdges.size() },
+          { m_graph.m_symbolCheck.data(), m_graph.m_symbolCheck.size() },
+          { A.data(), A.size() },
+          { B.data(), B.size() },
+          { EinvTA_C.data(), EinvTA_C.size() },
+          { invTA.data(), invTA.size() },
+          { invTB.data(), invTB.size() },
+          { reinterpret_cast<const uint32_t *>(m_qcGenerator.data()), m_qcGenerator.size() * 2 } };
+
+      CodeFileHeader header;
+      std::memset(&header, 0, sizeof(header));
+      std::memcpy(header.magic, CODE_FILE_MAGIC, sizeof(CODE_FILE_MAGIC));
+      header.version = FILE_VERSION;
+      header.byteOrder = CODE_FILE_BYTE_ORDER;
+      header.scheme = static_cast<uint32_t>(m_ECScheme);
+      header.prototypeHash = prototypeHash(m_pchk);
+      header.maxCheckNodes = m_M.cols();
+      header.maxSymbolNodes = m_N.cols();
+      header.maxLayerDegree = m_maxLayerDegree;
+      header.maxCheckDegree = m_graph.m_maxCheckDegree;
+      header.qcEncoder = m_qcEncoder;
+      header.qcParityShift = m_qcParityShift;
+      for (uint32_t t = 0; t < NUM_CODE_FILE_TABLES; t++)
+        header.tableWords[t] = tables[t].words;
+      uint32_t checksum = hashHeader(header);
+      for (uint32_t t = 0; t < NUM_CODE_FILE_TABLES; t++)
+        checksum = hashWords(tables[t].data, tables[t].words, checksum);
+      header.checksum = checksum;
+
+      // Write a private file and rename it over the old one, so that a
+      // process loading the file sees all of the old file or all of the new
+      std::string temporary = (boost::format("%s.%d.tmp") % path % getpid()).str();
+      std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      for (uint32_t t = 0; t < NUM_CODE_FILE_TABLES; t++)
+        out.write(reinterpret_cast<const char *>(tables[t].data), tables[t].words * sizeof(uint32_t));
+      out.close();
+      if (!out || std::rename(temporary.c_str(), path.c_str()) != 0)
+      {
+        std::remove(temporary.c_str());
+        throw std::runtime_error((boost::format("LDPCCode: Unable to write %s") % path).str());
+      }
+    }
+
+    LDPCCode::LDPCCode (
+        ErrorCorrection::ErrorCorrectionScheme ecScheme) :
+            m_ECScheme (ecScheme),
+            m_pchk (ecScheme),
+            m_maxLayerDegree (0),
+            m_submatrixSize (0),
+            m_qcEncoder (false),
+            m_qcParityShift (0),
+            m_qcGeneratorWords (0)
+    {
+      // H includes the punctured symbols the scheme's codeword length
+      // leaves out
+      ErrorCorrection ec = ErrorCorrection(ecScheme);
+      m_k = ec.getMessageLen();
+      m_n = m_pchk.prototypeMatrixSize() * m_pchk.prototypeMatrix().cols();
+      m_punctured = m_n - ec.getCodewordLen();
+
+      // Everything the decoders and encodeQC need comes from the prototype
+      // matrix; the dense parity check and Richardson-Urbanke encoder
+      // matrices are left until something asks for them
+      m_makeDecoderMatrices();
+      m_makeQCEncoder();
+    }
+
+    LDPCCode::LDPCCode (
+        ErrorCorrection::ErrorCorrectionScheme ecScheme,
+        const uint8_t *image,
+        size_t imageSize) :
+            m_ECScheme (ecScheme),
+            m_pchk (ecScheme),
+            m_maxLayerDegree (0),
+            m_submatrixSize (0),
+            m_qcEncoder (false),
+            m_qcParityShift (0),
+            m_qcGeneratorWords (0)
+    {
+      // H includes the punctured symbols the scheme's codeword length
+      // leaves out
+      ErrorCorrection ec = ErrorCorrection(ecScheme);
+      m_k = ec.getMessageLen();
+      m_n = m_pchk.prototypeMatrixSize() * m_pchk.prototypeMatrix().cols();
+      m_punctured = m_n - ec.getCodewordLen();
+
+      m_loadTables(image, imageSize);
+    }
+
+    void
+    LDPCCode::m_loadTables(const uint8_t *image, size_t imageSize)
+    {
+      const CodeFileHeader &header = *reinterpret_cast<const CodeFileHeader *>(image);
+      const uint32_t *table[NUM_CODE_FILE_TABLES];
+      const uint32_t *words = reinterpret_cast<const uint32_t *>(image + sizeof(header));
+      size_t fileWords = (imageSize - sizeof(header)) / sizeof(uint32_t);
+      size_t tableWords = 0;
+      uint32_t checksum = hashHeader(header);
+      for (uint32_t t = 0; t < NUM_CODE_FILE_TABLES; t++)
+      {
+        table[t] = words + tableWords;
+        tableWords += header.tableWords[t];
+        if (tableWords > fileWords)
+          break;
+        checksum = hashWords(table[t], header.tableWords[t], checksum);
+      }
+      if (tableWords * sizeof(uint32_t) + sizeof(header) != imageSize ||
+          checksum != header.checksum)
+        throw std::runtime_error("LDPCCode: Damaged code file");
+      if (header.prototypeHash != prototypeHash(m_pchk))
+        throw std::runtime_error("LDPCCode: Code file is for another prototype matrix");
+
+      // The checksum catches damage, not a file written by a build with
+      // other tables. The decoder tables and the scalars that size the
+      // decoders' buffers are cheap to build from the prototype matrix, so
+      // they are built, and the file's copies must be the same; nothing
+      // the decoders index with comes from the file.
+      m_makeDecoderMatrices();
+      m_makeQCEncoder();
+      auto same = [&](uint32_t t, const void *data, size_t words) {
+        return header.tableWords[t] == words &&
+            std::memcmp(table[t], data, words * sizeof(uint32_t)) == 0;
+      };
+      if (header.maxCheckNodes != static_cast<uint32_t>(m_M.cols()) ||
+          header.maxSymbolNodes != static_cast<uint32_t>(m_N.cols()) ||
+          header.maxLayerDegree != m_maxLayerDegree ||
+          header.maxCheckDegree != m_graph.m_maxCheckDegree ||
+          header.qcEncoder != m_qcEncoder ||
+          header.qcParityShift != m_qcParityShift ||
+          !same(TABLE_LAYER_START, m_layerStart.data(), m_layerStart.size()) ||
+          !same(TABLE_CIRCULANT_COLUMN, m_circulantColumn.data(), m_circulantColumn.size()) ||
+          !same(TABLE_CIRCULANT_SHIFT, m_circulantShift.data(), m_circulantShift.size()) ||
+          !same(TABLE_M, m_M.data(), m_M.size()) ||
+          !same(TABLE_M_NUM_CHECK_NODES, m_M_numCheckNodes.data(), m_M_numCheckNodes.size()) ||
+          !same(TABLE_N, m_N.data(), m_N.size()) ||
+          !same(TABLE_N_NUM_SYMBOL_NODES, m_N_numSymbolNodes.data(), m_N_numSymbolNodes.size()) ||
+          !same(TABLE_CHECK_EDGE_START, m_graph.m_checkEdgeStart.data(), m_graph.m_checkEdgeStart.size()) ||
+          !same(TABLE_EDGE_SYMBOL, m_graph.m_edgeSymbol.data(), m_graph.m_edgeSymbol.size()) ||
+          !same(TABLE_EDGE_CHECK, m_graph.m_edgeCheck.data(), m_graph.m_edgeCheck.size()) ||
+          !same(TABLE_SYMBOL_EDGE_START, m_graph.m_symbolEdgeStart.data(), m_graph.m_symbolEdgeStart.size()) ||
+          !same(TABLE_SYMBOL_EDGES, m_graph.m_symbolEdges.data(), m_graph.m_symbolEdges.size()) ||
+          !same(TABLE_SYMBOL_CHECK, m_graph.m_symbolCheck.data(), m_graph.m_symbolCheck.size()))
+        throw std::runtime_error("LDPCCode: Code file tables do not fit the code");
+
+      // encoderMatrix checks the triplets' rows and columns
+      uint32_t m = m_n - m_k;
+      for (uint32_t t = TABLE_A; t < TABLE_QC_GENERATOR; t++)
+        if (header.tableWords[t] % 3 != 0 || (header.tableWords[t] != 0 && !m_qcEncoder))
+          throw std::runtime_error("LDPCCode: Code file tables do not fit the code");
+      uint32_t generatorWords = (m + 63) / 64;
+      if (header.tableWords[TABLE_QC_GENERATOR] != 0 &&
+          header.tableWords[TABLE_QC_GENERATOR] != m_k * generatorWords * 2)
+        throw std::runtime_error("LDPCCode: Code file tables do not fit the code");
+
+      // The encoder matrices are what make building a code slow, so they
+      // are loaded now rather than rebuilt on first use. See
+      // m_makeEncoderMatrices for their sizes.
+      if (header.tableWords[TABLE_QC_GENERATOR] != 0)
+      {
+        std::call_once(m_qcGeneratorOnce, [&]() {
+          m_qcGenerator.resize(m_k * generatorWords);
+          std::memcpy(m_qcGenerator.data(), table[TABLE_QC_GENERATOR],
+              m_qcGenerator.size() * sizeof(uint64_t));
+          m_qcGeneratorWords = generatorWords;
+        });
+      }
+      if (!m_qcEncoder)
+        return;
+      uint32_t g = m_submatrixSize;
+      std::call_once(m_encoderMatricesOnce, [&]() {
+        m_A = encoderMatrix(table[TABLE_A], header.tableWords[TABLE_A], m - g, m_k);
+        m_B = encoderMatrix(table[TABLE_B], header.tableWords[TABLE_B], m - g, g);
+        m_EinvTA_C = encoderMatrix(table[TABLE_EINVTA_C], header.tableWords[TABLE_EINVTA_C], g, m_k);
+        m_invTA = encoderMatrix(table[TABLE_INVTA], header.tableWords[TABLE_INVTA], m - g, m_k);
+        m_invTB = encoderMatrix(table[TABLE_INVTB], header.tableWords[TABLE_INVTB], m - g, g);
+
+        m_sA = m_A.sparseView();
+        m_sB = m_B.sparseView();
+        m_sEinvTA_C = m_EinvTA_C.sparseView();
+        m_sinvTA = m_invTA.sparseView();
+        m_sinvTB = m_invTB.sparseView();
+      });
+    }
+
+    void
+    LDPCCode::m_prepareEncoderMatrices() const
+    {
+      std::call_once(m_encoderMatricesOnce, &LDPCCode::m_makeEncoderMatrices, this);
+    }
+
+    /*!
+     * @brief Matrices needed to support encoding
+     *
+     * @note See Richardson, T., Urbanke, R., "Efficient Encoding of Low-
+     * Density Parity-Check Codes". IEEE Trans. on Information Theory,
+     * Feb. 2001
+     */
+    void
+    LDPCCode::m_makeEncoderMatrices() const
+    {
+      // The parity check matrix H is quasi-cyclic by design. I think this means
+      // that a the minimum "gap" size (g) is <= Z, the prototype matrix size. We can
+      // either just choose that value or search the last column of H for the first
+      // non-zero value row index r and calculate g as n - r.
+
+      const Eigen::MatrixXi &parityCheckMatrix = m_pchk.parityCheckMatrix();
+      uint32_t n = parityCheckMatrix.cols();   // codeword size
+      uint32_t m = parityCheckMatrix.rows();   // parity check row count
+      uint32_t g = m_pchk.prototypeMatrixSize(); // Assume Z is gap size
+
+      // The objective is to put H into the partial lower-trianglar form
+      // described in the paper as
+      //
+      // H = [ A B T ]
+      //     [ C D E ]
+      //
+      // Where,
+      //   A is m - g x n - m
+      //   B is m - g x g
+      //   T is m - g x m - g
+      //   C is     g x n - m
+      //   D is     g x g
+      //   E is     g x m - g
+
+      Eigen::MatrixXd H = parityCheckMatrix.cast <double> ();
+
+      // Extract A, B, C, D, E and T from H
+      m_A = Eigen::MatrixXd(m-g,n-m);
+      m_A = H.block(0,0,m-g,n-m);
+      m_B = Eigen::MatrixXd(m-g,g);
+      m_B = H.block(0,n-m,m-g,g);
+      Eigen::MatrixXd T(m-g,m-g);
+      T = H.block(0,n-m+g,m-g,m-g);
+      Eigen::MatrixXd C(g,n-m);
+      C = H.block(m-g,0,g,n-m);
+      Eigen::MatrixXd D(g,g);
+      D = H.block(m-g,n-m,g,g);
+      Eigen::MatrixXd E(g,m-g);
+      E = H.block(m-g,n-m+g,g,m-g);
+
+      // From the paper, multiply H on the left by equation/term (6)
+      //   [I          0]
+      //   [-E*inv(T)  I]                                                (6)
+      // to get equation/term (7)
+      //   [     A                B           T]
+      //   [-E*inv(T)*A + C  -E*inv(T)*B + D  0]                         (7)
+      //
+      // If the codeword x is systematic so that x = [s, p1, p2] where s are
+      // the message bits, then the requirement that the parity matrix and the
+      // codeword be orthogonal leads to the equation H*trans(x) = trans(0). This
+      // leads to equations (8) and (9)
+      //   A*trans(s) + B*trans(p1) + T*trans(p2) = 0                    (8)
+      //   (-E*inv(T)*A + C)*trans(s) + (-E*inv(T)*B + D)*trans(p1) = 0  (9)
+      //
+
+      // create all the rest of the matrices needed to encode messages and, if so
+      // desired, check the codewords against the parity check matrix
+
+      Eigen::MatrixXd invT = T.inverse();
+      Eigen::MatrixXd EinvT = -(E*invT);
+
+      // From the paper, p1 is calculated using
+      //   p1 = mod(-inv(phi)*EinvTA_C*(msg'),2)
+      // However, because H is quasi-cyclic, phi is always -I (i.e., -eye(Z).
+      // Since the product is forced into GF2 (i.e., elements are 1 or 0), the
+      // sign is irrelevant and we can do away with the multiplication by I. That
+      // is, we don't need or use phi.
+
+      Eigen::MatrixXd phi = EinvT*m_B + D; // calculate for now, for no good reason except I'm paranoid
+
+      // used to calculate p1 as per above
+      m_EinvTA_C = EinvT*m_A + C;
+
+      // save some time in calculating p2 by precalculating these two products
+      m_invTA = invT*m_A;
+      m_invTB = invT*m_B;
+
+      // Now make sparse versions
+      // TODO make sure these are actually used... are there other places?
+      m_sA = m_A.sparseView();
+      m_sB = m_B.sparseView();
+      m_sEinvTA_C = m_EinvTA_C.sparseView();
+      m_sinvTA = m_invTA.sparseView();
+      m_sinvTB = m_invTB.sparseView();
+    }
+
+    void
+    LDPCCode::m_makeDecoderMatrices()
+    {
+      // One layer per prototype matrix row
+      const Eigen::MatrixXi &protoH = m_pchk.prototypeMatrix();
+      uint32_t Z = m_pchk.prototypeMatrixSize();
+      m_submatrixSize = Z;
+      m_layerStart.assign(1, 0);
+      m_circulantColumn.clear();
+      m_circulantShift.clear();
+      m_maxLayerDegree = 0;
+      std::vector<uint32_t> columnDegree(protoH.cols(), 0);
+      for (int l = 0; l < protoH.rows(); l++)
+      {
+        for (int j = 0; j < protoH.cols(); j++)
+        {
+          if (protoH(l, j) >= 0)
+          {
+            m_circulantColumn.push_back(j);
+            m_circulantShift.push_back(protoH(l, j));
+            columnDegree[j]++;
+          }
+        }
+        m_layerStart.push_back(m_circulantColumn.size());
+        m_maxLayerDegree = std::max(m_maxLayerDegree, m_layerStart[l + 1] - m_layerStart[l]);
+      }
+
+      // Every one in H belongs to a circulant, so M and N follow from the
+      // layer tables without H. Check node t of layer l connects to symbol
+      // node m_circulantColumn[c] * Z + (t + m_circulantShift[c]) % Z. A
+      // layer's circulants are in column order, so each N(i) lists its
+      // symbol nodes in increasing order, and walking the layers in order
+      // does the same for the check nodes in each M(j), as scanning H did.
+      uint32_t maxCheckNodes = *std::max_element(columnDegree.begin(), columnDegree.end());
+      uint32_t maxSymbolNodes = m_maxLayerDegree;
+#if LDPC_DEBUG_VERBOSE
+      std::cout << "maxCheckNodes " << maxCheckNodes << std::endl;
+      std::cout << "maxSymbolNodes " << maxSymbolNodes << std::endl;
+#endif
+      // M(j) represents the set of indexes of all the children parity check nodes
+      // connected to the symbol node d(j)
+      m_M = Eigen::MatrixXi::Zero (m_n, maxCheckNodes);
+      m_M_numCheckNodes = Eigen::VectorXi::Zero (m_n);
+      // N(i) represents the set of indexes of all the parent symbol nodes connected
+      // to the parity check node h(i)
+      m_N = Eigen::MatrixXi::Zero (m_n - m_k, maxSymbolNodes);
+      m_N_numSymbolNodes = Eigen::VectorXi::Zero (m_n - m_k);
+
+      for (uint32_t l = 0; l + 1 < m_layerStart.size(); l++)
+      {
+        for (uint32_t c = m_layerStart[l]; c < m_layerStart[l + 1]; c++)
+        {
+          for (uint32_t t = 0; t < Z; t++)
+          {
+            uint32_t cn = l * Z + t;
+            uint32_t sn = m_circulantColumn[c] * Z + (t + m_circulantShift[c]) % Z;
+            m_N (cn, m_N_numSymbolNodes (cn)++) = sn;
+            m_M (sn, m_M_numCheckNodes (sn)++) = cn;
+          }
+        }
+      }
+
+      m_graph = TannerGraph(m_N, m_N_numSymbolNodes, m_M, m_M_numCheckNodes);
+
+#if LDPC_DEBUG_VERBOSE
+      std::cout << "m_M\n" << m_M << std::endl;
+      std::cout << "m_M_numCheckNodes\n" << m_M_numCheckNodes << std::endl;
+      std::cout << "m_N\n" << m_N << std::endl;
+      std::cout << "m_N_numSymbolNodes\n" << m_N_numSymbolNodes << std::endl;
+#endif
+    }
+
+    void
+    LDPCCode::m_makeQCEncoder()
+    {
+      // encodeQC needs the 802.11n parity structure: block row l has the
+      // identity in parity block columns l and l + 1 (bar the first and
+      // last rows), and the circulants of the first parity block column
+      // XOR to a single circulant, i.e., all but one shift appear in pairs.
+      uint32_t Z = m_submatrixSize;
+      uint32_t numLayers = m_layerStart.size() - 1;
+      uint32_t messageColumns = m_k / Z;
+      std::vector<uint32_t> shiftCount(Z, 0);
+
+      m_qcEncoder = false;
+      if (numLayers != (m_n - m_k) / Z)
+        return;
+      for (uint32_t l = 0; l < numLayers; l++)
+      {
+        uint32_t dualDiagonal = 0;
+        for (uint32_t c = m_layerStart[l]; c < m_layerStart[l + 1]; c++)
+        {
+          uint32_t column = m_circulantColumn[c];
+          if (column == messageColumns)
+            shiftCount[m_circulantShift[c]]++;
+          else if (column > messageColumns) {
+            uint32_t p = column - messageColumns;
+            if (m_circulantShift[c] != 0 || (p != l && p != l + 1))
+              return;
+            dualDiagonal++;
+          }
+        }
+        if (dualDiagonal != (l == 0 || l + 1 == numLayers ? 1u : 2u))
+          return;
+      }
+
+      uint32_t oddShifts = 0;
+      for (uint32_t s = 0; s < Z; s++)
+        if (shiftCount[s] % 2)
+        {
+          oddShifts++;
+          m_qcParityShift = s;
+        }
+      m_qcEncoder = oddShifts == 1;
+    }
+
+    void
+    LDPCCode::m_prepareQCGenerator() const
+    {
+      std::call_once(m_qcGeneratorOnce, &LDPCCode::m_makeQCGenerator, this);
+    }
+
+    void
+    LDPCCode::m_makeQCGenerator() const
+    {
+      // With H = [Q P], P the square parity part, a codeword [s p] has
+      // Q s + P p = 0, so p = inv(P) Q s over GF(2). Reducing the bit matrix
+      // [P Q] to [I W] by Gauss-Jordan elimination leaves inv(P) Q in W;
+      // column i of W is the parity message bit i adds. The dense rows cost
+      // m (n + 63) / 64 words, under half a megabyte for any of the codes.
+      uint32_t Z = m_submatrixSize;
+      uint32_t m = m_n - m_k;
+      uint32_t rowWords = (m + m_k + 63) / 64;
+      std::vector<uint64_t> rows(size_t(m) * rowWords, 0);
+      auto bit = [](uint32_t b) { return 1ull << (63 - b % 64); };
+
+      // Circulants can overlap only in a sum of permutations; XOR them
+      for (uint32_t l = 0; l + 1 < m_layerStart.size(); l++)
+        for (uint32_t c = m_layerStart[l]; c < m_layerStart[l + 1]; c++)
+          for (uint32_t t = 0; t < Z; t++)
+          {
+            uint32_t symbol = m_circulantColumn[c] * Z + (t + m_circulantShift[c]) % Z;
+            uint32_t j = symbol >= m_k ? symbol - m_k : m + symbol;
+            rows[size_t(l * Z + t) * rowWords + j / 64] ^= bit(j);
+          }
+
+      for (uint32_t p = 0; p < m; p++)
+      {
+        uint32_t pw = p / 64;
+        uint32_t r = p;
+        while (r < m && (rows[size_t(r) * rowWords + pw] & bit(p)) == 0)
+          r++;
+        if (r == m)
+          return; // P is singular; there is no systematic generator
+        uint64_t *pivot = &rows[size_t(p) * rowWords];
+        if (r != p)
+          std::swap_ranges(pivot, pivot + rowWords, &rows[size_t(r) * rowWords]);
+        // Columns left of p are already clear in the pivot row
+        for (uint32_t i = 0; i < m; i++)
+        {
+          uint64_t *row = &rows[size_t(i) * rowWords];
+          if (i != p && (row[pw] & bit(p)) != 0)
+            for (uint32_t w = pw; w < rowWords; w++)
+              row[w] ^= pivot[w];
+        }
+      }
+
+      uint32_t words = (m + 63) / 64;
+      m_qcGenerator.assign(size_t(m_k) * words, 0);
+      for (uint32_t r = 0; r < m; r++)
+      {
+        const uint64_t *row = &rows[size_t(r) * rowWords];
+        for (uint32_t i = 0; i < m_k; i++)
+          if (row[(m + i) / 64] & bit(m + i))
+            m_qcGenerator[size_t(i) * words + r / 64] |= bit(r);
+      }
+      m_qcGeneratorWords = words;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
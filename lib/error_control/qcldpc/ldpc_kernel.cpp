@@ -0,0 +1,135 @@
+/*!
+ * @file ldpc_kernel.cpp
+ * @author Steven Knudsen
+ * @date June 10, 2021
+ *
+ * @details Portable LDPC decoder kernels and run time kernel selection.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cstdint>
+
+#include "ldpc_kernel.h"
+#include "ldpc_kernel_impl.h"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    /*!
+     * @brief Plain arrays standing in for SIMD registers. The fixed size loops
+     * are simple enough for the compiler to vectorize for the build target.
+     */
+    struct GenericVector
+    {
+      static const uint32_t W = 16;
+      struct T {
+        int8_t v[W];
+      };
+
+      static inline T load(const int8_t *p) {
+        T a;
+        for (uint32_t i = 0; i < W; i++) a.v[i] = p[i];
+        return a;
+      }
+      static inline void store(int8_t *p, const T &a) {
+        for (uint32_t i = 0; i < W; i++) p[i] = a.v[i];
+      }
+      static inline T set1(int8_t x) {
+        T a;
+        for (uint32_t i = 0; i < W; i++) a.v[i] = x;
+        return a;
+      }
+      static inline T zero() {
+        return set1(0);
+      }
+      static inline int8_t saturate(int x) {
+        return (int8_t) std::min(127, std::max(-128, x));
+      }
+      static inline T adds(const T &a, const T &b) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = saturate(a.v[i] + b.v[i]);
+        return c;
+      }
+      static inline T subs(const T &a, const T &b) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = saturate(a.v[i] - b.v[i]);
+        return c;
+      }
+      static inline T min(const T &a, const T &b) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = std::min(a.v[i], b.v[i]);
+        return c;
+      }
+      static inline T max(const T &a, const T &b) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = std::max(a.v[i], b.v[i]);
+        return c;
+      }
+      static inline T abs(const T &a) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = saturate(a.v[i] < 0 ? -a.v[i] : a.v[i]);
+        return c;
+      }
+      static inline T bxor(const T &a, const T &b) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = a.v[i] ^ b.v[i];
+        return c;
+      }
+      static inline T eq(const T &a, const T &b) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = a.v[i] == b.v[i] ? -1 : 0;
+        return c;
+      }
+      static inline T select(const T &mask, const T &a, const T &b) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = mask.v[i] ? a.v[i] : b.v[i];
+        return c;
+      }
+      static inline T sign(const T &a, const T &s) {
+        T c;
+        for (uint32_t i = 0; i < W; i++) c.v[i] = s.v[i] < 0 ? -a.v[i] : a.v[i];
+        return c;
+      }
+      static inline uint32_t negativeMask(const T &a) {
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < W; i++) mask |= (a.v[i] < 0 ? 1u : 0u) << i;
+        return mask;
+      }
+    };
+
+    const LDPCKernels &
+    ldpcKernelsGeneric()
+    {
+      static const LDPCKernels kernels = {
+        ldpcLayerUpdate<GenericVector>,
+        ldpcLayerSyndrome<GenericVector>,
+        GenericVector::W,
+        ldpcInterleavedLayerUpdate<GenericVector>,
+        ldpcInterleavedLayerSyndrome<GenericVector>,
+        "generic"
+      };
+      return kernels;
+    }
+
+    const LDPCKernels &
+    ldpcKernels()
+    {
+      static const LDPCKernels * best = []() {
+        const LDPCKernels * k;
+        if ((k = ldpcKernelsAVX2()) != nullptr) return k;
+        if ((k = ldpcKernelsSSE41()) != nullptr) return k;
+        if ((k = ldpcKernelsNEON()) != nullptr) return k;
+        return &ldpcKernelsGeneric();
+      }();
+      return *best;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
@@ -0,0 +1,130 @@
+/*!
+ * @file ldpc_kernel_avx2.cpp
+ * @author Steven Knudsen
+ * @date June 10, 2021
+ *
+ * @details AVX2 LDPC decoder kernels, 32 lanes per vector.
+ *
+ * Only the kernels in this file are built for AVX2; they are used only if
+ * the CPU reports AVX2 at run time.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <cstdint>
+
+#include "ldpc_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+#include "ldpc_kernel_impl.h"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    struct AVX2Vector
+    {
+      typedef __m256i T;
+      static const uint32_t W = 32;
+
+      static inline T load(const int8_t *p) {
+        return _mm256_loadu_si256((const __m256i *) p);
+      }
+      static inline void store(int8_t *p, T a) {
+        _mm256_storeu_si256((__m256i *) p, a);
+      }
+      static inline T set1(int8_t x) {
+        return _mm256_set1_epi8(x);
+      }
+      static inline T zero() {
+        return _mm256_setzero_si256();
+      }
+      static inline T adds(T a, T b) {
+        return _mm256_adds_epi8(a, b);
+      }
+      static inline T subs(T a, T b) {
+        return _mm256_subs_epi8(a, b);
+      }
+      static inline T min(T a, T b) {
+        return _mm256_min_epi8(a, b);
+      }
+      static inline T max(T a, T b) {
+        return _mm256_max_epi8(a, b);
+      }
+      static inline T abs(T a) {
+        return _mm256_abs_epi8(a);
+      }
+      static inline T bxor(T a, T b) {
+        return _mm256_xor_si256(a, b);
+      }
+      static inline T eq(T a, T b) {
+        return _mm256_cmpeq_epi8(a, b);
+      }
+      static inline T select(T mask, T a, T b) {
+        return _mm256_blendv_epi8(b, a, mask);
+      }
+      static inline T sign(T a, T s) {
+        // _mm256_sign_epi8 zeroes lanes where s is zero; setting the low bit
+        // keeps the sign of s and makes it nonzero
+        return _mm256_sign_epi8(a, _mm256_or_si256(s, _mm256_set1_epi8(1)));
+      }
+      static inline uint32_t negativeMask(T a) {
+        return (uint32_t) _mm256_movemask_epi8(a);
+      }
+    };
+
+    static const LDPCKernels kernelsAVX2 = {
+      ldpcLayerUpdate<AVX2Vector>,
+      ldpcLayerSyndrome<AVX2Vector>,
+      AVX2Vector::W,
+      ldpcInterleavedLayerUpdate<AVX2Vector>,
+      ldpcInterleavedLayerSyndrome<AVX2Vector>,
+      "avx2"
+    };
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#pragma GCC pop_options
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    const LDPCKernels *
+    ldpcKernelsAVX2()
+    {
+      return __builtin_cpu_supports("avx2") ? &kernelsAVX2 : nullptr;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#else
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    const LDPCKernels *
+    ldpcKernelsAVX2()
+    {
+      return nullptr;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif
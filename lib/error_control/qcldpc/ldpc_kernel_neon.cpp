@@ -0,0 +1,122 @@
+/*!
+ * @file ldpc_kernel_neon.cpp
+ * @author Steven Knudsen
+ * @date June 10, 2021
+ *
+ * @details NEON LDPC decoder kernels, 16 lanes per vector.
+ *
+ * NEON is chosen at compile time; the kernels are built only if the target
+ * supports it.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <cstdint>
+
+#include "ldpc_kernel.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+#include "ldpc_kernel_impl.h"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    struct NEONVector
+    {
+      typedef int8x16_t T;
+      static const uint32_t W = 16;
+
+      static inline T load(const int8_t *p) {
+        return vld1q_s8(p);
+      }
+      static inline void store(int8_t *p, T a) {
+        vst1q_s8(p, a);
+      }
+      static inline T set1(int8_t x) {
+        return vdupq_n_s8(x);
+      }
+      static inline T zero() {
+        return vdupq_n_s8(0);
+      }
+      static inline T adds(T a, T b) {
+        return vqaddq_s8(a, b);
+      }
+      static inline T subs(T a, T b) {
+        return vqsubq_s8(a, b);
+      }
+      static inline T min(T a, T b) {
+        return vminq_s8(a, b);
+      }
+      static inline T max(T a, T b) {
+        return vmaxq_s8(a, b);
+      }
+      static inline T abs(T a) {
+        return vqabsq_s8(a);
+      }
+      static inline T bxor(T a, T b) {
+        return veorq_s8(a, b);
+      }
+      static inline T eq(T a, T b) {
+        return vreinterpretq_s8_u8(vceqq_s8(a, b));
+      }
+      static inline T select(T mask, T a, T b) {
+        return vbslq_s8(vreinterpretq_u8_s8(mask), a, b);
+      }
+      static inline T sign(T a, T s) {
+        return vbslq_s8(vcltq_s8(s, vdupq_n_s8(0)), vnegq_s8(a), a);
+      }
+      static inline uint32_t negativeMask(T a) {
+        // There is no movemask, and this is only used once per layer to count
+        // unsatisfied checks, so do it by hand
+        int8_t lanes[W];
+        vst1q_s8(lanes, a);
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < W; i++)
+          mask |= (lanes[i] < 0 ? 1u : 0u) << i;
+        return mask;
+      }
+    };
+
+    static const LDPCKernels kernelsNEON = {
+      ldpcLayerUpdate<NEONVector>,
+      ldpcLayerSyndrome<NEONVector>,
+      NEONVector::W,
+      ldpcInterleavedLayerUpdate<NEONVector>,
+      ldpcInterleavedLayerSyndrome<NEONVector>,
+      "neon"
+    };
+
+    const LDPCKernels *
+    ldpcKernelsNEON()
+    {
+      return &kernelsNEON;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#else
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    const LDPCKernels *
+    ldpcKernelsNEON()
+    {
+      return nullptr;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif
@@ -0,0 +1,130 @@
+/*!
+ * @file ldpc_kernel_sse41.cpp
+ * @author Steven Knudsen
+ * @date June 10, 2021
+ *
+ * @details SSE4.1 LDPC decoder kernels, 16 lanes per vector.
+ *
+ * Only the kernels in this file are built for SSE4.1; they are used only if
+ * the CPU reports SSE4.1 at run time.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <cstdint>
+
+#include "ldpc_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+
+#include "ldpc_kernel_impl.h"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    struct SSE41Vector
+    {
+      typedef __m128i T;
+      static const uint32_t W = 16;
+
+      static inline T load(const int8_t *p) {
+        return _mm_loadu_si128((const __m128i *) p);
+      }
+      static inline void store(int8_t *p, T a) {
+        _mm_storeu_si128((__m128i *) p, a);
+      }
+      static inline T set1(int8_t x) {
+        return _mm_set1_epi8(x);
+      }
+      static inline T zero() {
+        return _mm_setzero_si128();
+      }
+      static inline T adds(T a, T b) {
+        return _mm_adds_epi8(a, b);
+      }
+      static inline T subs(T a, T b) {
+        return _mm_subs_epi8(a, b);
+      }
+      static inline T min(T a, T b) {
+        return _mm_min_epi8(a, b);
+      }
+      static inline T max(T a, T b) {
+        return _mm_max_epi8(a, b);
+      }
+      static inline T abs(T a) {
+        return _mm_abs_epi8(a);
+      }
+      static inline T bxor(T a, T b) {
+        return _mm_xor_si128(a, b);
+      }
+      static inline T eq(T a, T b) {
+        return _mm_cmpeq_epi8(a, b);
+      }
+      static inline T select(T mask, T a, T b) {
+        return _mm_blendv_epi8(b, a, mask);
+      }
+      static inline T sign(T a, T s) {
+        // _mm_sign_epi8 zeroes lanes where s is zero; setting the low bit
+        // keeps the sign of s and makes it nonzero
+        return _mm_sign_epi8(a, _mm_or_si128(s, _mm_set1_epi8(1)));
+      }
+      static inline uint32_t negativeMask(T a) {
+        return (uint32_t) _mm_movemask_epi8(a);
+      }
+    };
+
+    static const LDPCKernels kernelsSSE41 = {
+      ldpcLayerUpdate<SSE41Vector>,
+      ldpcLayerSyndrome<SSE41Vector>,
+      SSE41Vector::W,
+      ldpcInterleavedLayerUpdate<SSE41Vector>,
+      ldpcInterleavedLayerSyndrome<SSE41Vector>,
+      "sse4.1"
+    };
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#pragma GCC pop_options
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    const LDPCKernels *
+    ldpcKernelsSSE41()
+    {
+      return __builtin_cpu_supports("sse4.1") ? &kernelsSSE41 : nullptr;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#else
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    const LDPCKernels *
+    ldpcKernelsSSE41()
+    {
+      return nullptr;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
+
+#endif
@@ -12,6 +12,7 @@
  */
 
 #include "parity_check.h"
+#include "proto_h.h"
 
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
@@ -21,11 +22,9 @@
 #include <stdexcept>
 #include <sys/stat.h>
 
-#include "matrix2d.h"
-
-namespace xiphos
+namespace ex2
 {
-  namespace darkstar
+  namespace sdr
   {
     class ParityCheckException: public std::exception {
     private:
@@ -42,17 +41,25 @@ namespace xiphos
 
 
     ParityCheck::ParityCheck (
-        ErrorCorrection::ErrorCorrectionCoding errorCorrectionCoding,
-        ErrorCorrection::CodingRate codingRate)
+        ErrorCorrection::ErrorCorrectionScheme ecScheme,
+        const std::string &protoHPath) :
+            m_protoHPath(protoHPath)
     {
-      m_errorCorrection = new ErrorCorrection(errorCorrectionCoding, codingRate);
-      m_makeParityCheckMatrix();
-      m_rank = m_parityCheckMatrix.rows();
+      m_errorCorrection = new ErrorCorrection(ecScheme);
+      try {
+        m_prototypeMatrix = m_protoHPath.empty() ? m_builtin_proto_h() : m_read_proto_h();
+      }
+      catch (std::runtime_error& re) {
+        m_valid = false;
+        throw ParityCheckException("Unable to read parity check prototype");
+      }
+      m_rank = m_submatrixSize() * m_prototypeMatrix.rows();
       m_valid = m_rank > 0;
     }
 
     ParityCheck::~ParityCheck ()
     {
+      delete m_errorCorrection;
     }
 
     bool ParityCheck::isValid() const
@@ -60,26 +67,34 @@ namespace xiphos
       return m_valid;
     }
 
-    Eigen::MatrixXi & ParityCheck::parityCheckMatrix()
+    const Eigen::MatrixXi & ParityCheck::parityCheckMatrix() const
     {
+      std::call_once(m_parityCheckMatrixOnce, &ParityCheck::m_makeParityCheckMatrix, this);
       return m_parityCheckMatrix;
     }
 
-    Eigen::MatrixXd  & ParityCheck::parityCheckMatrixDouble()
+    const Eigen::MatrixXd  & ParityCheck::parityCheckMatrixDouble() const
     {
+      std::call_once(m_parityCheckMatrixOnce, &ParityCheck::m_makeParityCheckMatrix, this);
       return m_parityCheckMatrixDouble;
     }
 
-    Eigen::SparseMatrix<double>  & ParityCheck::parityCheckMatrixSparse()
+    const Eigen::SparseMatrix<double>  & ParityCheck::parityCheckMatrixSparse() const
     {
+      std::call_once(m_parityCheckMatrixOnce, &ParityCheck::m_makeParityCheckMatrix, this);
       return m_parityCheckMatrixSparse;
     }
 
-    unsigned int ParityCheck::prototypeMatrixSize()
+    unsigned int ParityCheck::prototypeMatrixSize() const
     {
       return m_submatrixSize();
     }
 
+    const Eigen::MatrixXi & ParityCheck::prototypeMatrix() const
+    {
+      return m_prototypeMatrix;
+    }
+
     unsigned int ParityCheck::rank()
     {
       return m_rank;
@@ -89,26 +104,26 @@ namespace xiphos
     ParityCheck::m_submatrixSize() const
     {
       unsigned int size = 0;
-      switch(m_errorCorrection->errorCorrection()) {
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_IEEE_648:
+      switch(m_errorCorrection->getCodewordLen()) {
+        case 648:
           size = k_submatrix27x27Size;
           break;
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_IEEE_1296:
+        case 1296:
           size = k_submatrix54x54Size;
           break;
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_IEEE_1944:
+        case 1944:
           size = k_submatrix81x81Size;
           break;
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_DVB_S2_64800:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_ARxA_1024:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_ARxA_4096:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_ARxA_16384:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_CCSDS_131_1024:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_CCSDS_131_4096:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_CCSDS_131_8160:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_CCSDS_131_16384:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_FIRST:
-        case ErrorCorrection::ErrorCorrectionCoding::LDPC_LAST:
+        // CCSDS AR4JA, k = 1024: M / 4
+        case 1280:
+          size = 32;
+          break;
+        case 1536:
+          size = 64;
+          break;
+        case 2048:
+          size = 128;
+          break;
         default:
           break;
       }
@@ -119,7 +134,7 @@ namespace xiphos
     ParityCheck::m_submatricesPerColumn() const
     {
       int spc = 0;
-      switch (m_errorCorrection->codingRate()) {
+      switch (m_errorCorrection->getCodingRate()) {
         case ErrorCorrection::CodingRate::RATE_1_2:
           spc = 12;
           break;
@@ -132,26 +147,62 @@ namespace xiphos
         case ErrorCorrection::CodingRate::RATE_5_6:
           spc = 4;
           break;
+        case ErrorCorrection::CodingRate::RATE_1_6:
+        case ErrorCorrection::CodingRate::RATE_1_5:
         case ErrorCorrection::CodingRate::RATE_1_4:
         case ErrorCorrection::CodingRate::RATE_1_3:
-        case ErrorCorrection::CodingRate::RATE_2_5:
-        case ErrorCorrection::CodingRate::RATE_3_5:
         case ErrorCorrection::CodingRate::RATE_4_5:
+        case ErrorCorrection::CodingRate::RATE_7_8:
         case ErrorCorrection::CodingRate::RATE_8_9:
-        case ErrorCorrection::CodingRate::RATE_9_10:
         case ErrorCorrection::CodingRate::RATE_NA:
-        case ErrorCorrection::CodingRate::RATE_FIRST:
-        case ErrorCorrection::CodingRate::RATE_LAST:
         default:
           break;
       }
       return spc;
     }
 
+    Eigen::MatrixXi ParityCheck::m_builtin_proto_h()
+    {
+      switch (m_errorCorrection->getCodewordLen()) {
+        case 1280:
+        case 1536:
+        case 2048:
+          return m_ar4ja_proto_h();
+        default:
+          break;
+      }
+
+      uint32_t rows;
+      const int8_t *table = ieee80211nPrototypeMatrix(m_errorCorrection->getCodewordLen(),
+          m_errorCorrection->getCodingRate(), rows);
+      if (table == nullptr || rows != m_submatricesPerColumn())
+        throw std::runtime_error("ParityCheck: No built in prototype matrix for this scheme.");
+
+      Eigen::MatrixXi protoH(rows, k_submatricesPerRow);
+      for (unsigned int i = 0; i < rows; i++)
+        for (unsigned int j = 0; j < k_submatricesPerRow; j++)
+          protoH(i, j) = table[i * PROTO_H_COLUMNS + j];
+      return protoH;
+    }
+
+    Eigen::MatrixXi ParityCheck::m_ar4ja_proto_h()
+    {
+      uint32_t cols, Z;
+      std::vector<int8_t> table = ccsdsAR4JAPrototypeMatrix(m_errorCorrection->getCodingRate(), cols, Z);
+      if (table.empty() || Z != m_submatrixSize())
+        throw std::runtime_error("ParityCheck: No AR4JA prototype matrix for this scheme.");
+
+      Eigen::MatrixXi protoH(AR4JA_PROTO_H_ROWS, cols);
+      for (unsigned int i = 0; i < AR4JA_PROTO_H_ROWS; i++)
+        for (unsigned int j = 0; j < cols; j++)
+          protoH(i, j) = table[i * cols + j];
+      return protoH;
+    }
+
     Eigen::MatrixXi ParityCheck::m_read_proto_h()
     {
       // check if correct prototype file exists
-      std::string pathToPrototypeHfile(PATH_TO_PROTO_H);
+      std::string pathToPrototypeHfile(m_protoHPath);
       pathToPrototypeHfile.append("/");
       pathToPrototypeHfile.append(m_proto_h_filename());
 
@@ -202,33 +253,28 @@ namespace xiphos
       return protoH;
     }
 
-    void ParityCheck::m_makeParityCheckMatrix()
+    void ParityCheck::m_makeParityCheckMatrix() const
     {
-      unsigned int submatrix_size = m_submatrixSize();
-      unsigned int cols = submatrix_size*k_submatricesPerRow;
-      unsigned int rows = submatrix_size*m_submatricesPerColumn();
+      const Eigen::MatrixXi &proto_h = m_prototypeMatrix;
 
-      Eigen::MatrixXi proto_h;
-      try {
-        proto_h = m_read_proto_h();
-      }
-      catch (std::runtime_error& re) {
-        m_valid = false;
-        throw ParityCheckException("Unable to read parity check prototype");
-      }
+      unsigned int submatrix_size = m_submatrixSize();
+      unsigned int cols = submatrix_size*proto_h.cols();
+      unsigned int rows = submatrix_size*proto_h.rows();
 
       m_parityCheckMatrix = Eigen::MatrixXi::Zero(rows,cols);
 
       unsigned int iH, jH;
-      for (unsigned int i = 0; i < m_submatricesPerColumn(); i++) {
-        for (unsigned int j = 0; j < k_submatricesPerRow; j++) {
+      for (unsigned int i = 0; i < proto_h.rows(); i++) {
+        for (unsigned int j = 0; j < proto_h.cols(); j++) {
           if (proto_h(i,j) >= 0)
           {
-            Eigen::MatrixXi A = Eigen::MatrixXi::Identity(submatrix_size,submatrix_size);
+            // Each submatrix is the identity with its columns cyclically
+            // shifted right by the prototype value k
             unsigned int k = proto_h(i,j);
             iH = i*submatrix_size;
             jH = j*submatrix_size;
-            m_parityCheckMatrix.block(iH,jH,submatrix_size,submatrix_size) = rotate<Eigen::MatrixXi> (A,0,false,k,false);
+            for (unsigned int r = 0; r < submatrix_size; r++)
+              m_parityCheckMatrix(iH + r, jH + (r + k) % submatrix_size) = 1;
           }
         }
       }
@@ -237,5 +283,5 @@ namespace xiphos
       m_parityCheckMatrixSparse = m_parityCheckMatrixDouble.sparseView();
     }
 
-  } /* namespace darkstar */
-} /* namespace xiphos */
+  } /* namespace sdr */
+} /* namespace ex2 */
@@ -0,0 +1,321 @@
+/*!
+ * @file proto_h.cpp
+ * @author Steven Knudsen
+ * @date June 16, 2021
+ *
+ * @details The IEEE 802.11n QC-LDPC prototype matrices, generated from the
+ * files in fec/ldpc/802.11/proto_H. Some of those mark all zero submatrices
+ * with other negative values; here they are all -1.
+ *
+ * The CCSDS AR4JA prototype matrices are lifted from the protograph and
+ * permutation tables of CCSDS 131.0-B, section 7.4.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include "proto_h.h"
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    // n = 648, rate 1/2
+    constexpr int8_t k_protoH648_12[12][PROTO_H_COLUMNS] = {
+      {  0, -1, -1, -1,  0,  0, -1, -1,  0, -1, -1,  0,  1,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 22,  0, -1, -1, 17, -1,  0,  0, 12, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      {  6, -1,  0, -1, 10, -1, -1, -1, 24, -1,  0, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1 },
+      {  2, -1, -1,  0, 20, -1, -1, -1, 25,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1 },
+      { 23, -1, -1, -1,  3, -1, -1, -1,  0, -1,  9, 11, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1 },
+      { 24, -1, 23,  1, 17, -1,  3, -1, 10, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1 },
+      { 25, -1, -1, -1,  8, -1, -1, -1,  7, 18, -1, -1,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1 },
+      { 13, 24, -1, -1,  0, -1,  8, -1,  6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1 },
+      {  7, 20, -1, 16, 22, 10, -1, -1, 23, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1 },
+      { 11, -1, -1, -1, 19, -1, -1, -1, 13, -1,  3, 17, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1 },
+      { 25, -1,  8, -1, 23, 18, -1, 14,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0 },
+      {  3, -1, -1, -1, 16, -1, -1,  2, 25,  5, -1, -1,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 648, rate 2/3
+    constexpr int8_t k_protoH648_23[8][PROTO_H_COLUMNS] = {
+      { 25, 26, 14, -1, 20, -1,  2, -1,  4, -1, -1,  8, -1, 16, -1, 18,  1,  0, -1, -1, -1, -1, -1, -1 },
+      { 10,  9, 15, 11, -1,  0, -1,  1, -1, -1, 18, -1,  8, -1, 10, -1, -1,  0,  0, -1, -1, -1, -1, -1 },
+      { 16,  2, 20, 26, 21, -1,  6, -1,  1, 26, -1,  7, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1 },
+      { 10, 13,  5,  0, -1,  3, -1,  7, -1, -1, 26, -1, -1, 13, -1, 16, -1, -1, -1,  0,  0, -1, -1, -1 },
+      { 23, 14, 24, -1, 12, -1, 19, -1, 17, -1, -1, -1, 20, -1, 21, -1,  0, -1, -1, -1,  0,  0, -1, -1 },
+      {  6, 22,  9, 20, -1, 25, -1, 17, -1,  8, -1, 14, -1, 18, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1 },
+      { 14, 23, 21, 11, 20, -1, 24, -1, 18, -1, 19, -1, -1, -1, -1, 22, -1, -1, -1, -1, -1, -1,  0,  0 },
+      { 17, 11, 11, 20, -1, 21, -1, 26, -1,  3, -1, -1, 18, -1, 26, -1,  1, -1, -1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 648, rate 3/4
+    constexpr int8_t k_protoH648_34[6][PROTO_H_COLUMNS] = {
+      { 16, 17, 22, 24,  9,  3, 14, -1,  4,  2,  7, -1, 26, -1,  2, -1, 21, -1,  1,  0, -1, -1, -1, -1 },
+      { 25, 12, 12,  3,  3, 26,  6, 21, -1, 15, 22, -1, 15, -1,  4, -1, -1, 16, -1,  0,  0, -1, -1, -1 },
+      { 25, 18, 26, 16, 22, 23,  9, -1,  0, -1,  4, -1,  4, -1,  8, 23, 11, -1, -1, -1,  0,  0, -1, -1 },
+      {  9,  7,  0,  1, 17, -1, -1,  7,  3, -1,  3, 23, -1, 16, -1, -1, 21, -1,  0, -1, -1,  0,  0, -1 },
+      { 24,  5, 26,  7,  1, -1, -1, 15, 24, 15, -1,  8, -1, 13, -1, 13, -1, 11, -1, -1, -1, -1,  0,  0 },
+      {  2,  2, 19, 14, 24,  1, 15, 19, -1, 21, -1,  2, -1, 24, -1,  3, -1,  2,  1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 648, rate 5/6
+    constexpr int8_t k_protoH648_56[4][PROTO_H_COLUMNS] = {
+      { 17, 13,  8, 21,  9,  3, 18, 12, 10,  0,  4, 15, 19,  2,  5, 10, 26, 19, 13, 13,  1,  0, -1, -1 },
+      {  3, 12, 11, 14, 11, 25,  5, 18,  0,  9,  2, 26, 26, 10, 24,  7, 14, 20,  4,  2, -1,  0,  0, -1 },
+      { 22, 16,  4,  3, 10, 21, 12,  5, 21, 14, 19,  5, -1,  8,  5, 18, 11,  5,  5, 15,  0, -1,  0,  0 },
+      {  7,  7, 14, 14,  4, 16, 16, 24, 24, 10,  1,  7, 15,  6, 10, 26,  8, 18, 21, 14,  1, -1, -1,  0 }
+    };
+
+    // n = 1296, rate 1/2
+    constexpr int8_t k_protoH1296_12[12][PROTO_H_COLUMNS] = {
+      { 40, -1, -1, -1, 22, -1, 49, 23, 43, -1, -1, -1,  1,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 50,  1, -1, -1, 48, 35, -1, -1, 13, -1, 30, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 39, 50, -1, -1,  4, -1,  2, -1, -1, -1, -1, 49, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 33, -1, -1, 38, 37, -1, -1,  4,  1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1 },
+      { 45, -1, -1, -1,  0, 22, -1, -1, 20, 42, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1 },
+      { 51, -1, -1, 48, 35, -1, -1, -1, 44, -1, 18, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1 },
+      { 47, 11, -1, -1, -1, 17, -1, -1, 51, -1, -1, -1,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1 },
+      {  5, -1, 25, -1,  6, -1, 45, -1, 13, 40, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1 },
+      { 33, -1, -1, 34, 24, -1, -1, -1, 23, -1, -1, 46, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1 },
+      {  1, -1, 27, -1,  1, -1, -1, -1, 38, -1, 44, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1 },
+      { -1, 18, -1, -1, 23, -1, -1,  8,  0, 35, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0 },
+      { 49, -1, 17, -1, 30, -1, -1, -1, 34, -1, -1, 19,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 1296, rate 2/3
+    constexpr int8_t k_protoH1296_23[8][PROTO_H_COLUMNS] = {
+      { 39, 31, 22, 43, -1, 40,  4, -1, 11, -1, -1, 50, -1, -1, -1,  6,  1,  0, -1, -1, -1, -1, -1, -1 },
+      { 25, 52, 41,  2,  6, -1, 14, -1, 34, -1, -1, -1, 24, -1, 37, -1, -1,  0,  0, -1, -1, -1, -1, -1 },
+      { 43, 31, 29,  0, 21, -1, 28, -1, -1,  2, -1, -1,  7, -1, 17, -1, -1, -1,  0,  0, -1, -1, -1, -1 },
+      { 20, 33, 48, -1,  4, 13, -1, 26, -1, -1, 22, -1, -1, 46, 42, -1, -1, -1, -1,  0,  0, -1, -1, -1 },
+      { 45,  7, 18, 51, 12, 25, -1, -1, -1, 50, -1, -1,  5, -1, -1, -1,  0, -1, -1, -1,  0,  0, -1, -1 },
+      { 35, 40, 32, 16,  5, -1, -1, 18, -1, -1, 43, 51, -1, 32, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1 },
+      {  9, 24, 13, 22, 28, -1, -1, 37, -1, -1, 25, -1, -1, 52, -1, 13, -1, -1, -1, -1, -1, -1,  0,  0 },
+      { 32, 22,  4, 21, 16, -1, -1, -1, 27, 28, -1, 38, -1, -1, -1,  8,  1, -1, -1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 1296, rate 3/4
+    constexpr int8_t k_protoH1296_34[6][PROTO_H_COLUMNS] = {
+      { 39, 40, 51, 41,  3, 29,  8, 36, -1, 14, -1,  6, -1, 33, -1, 11, -1,  4,  1,  0, -1, -1, -1, -1 },
+      { 48, 21, 47,  9, 48, 35, 51, -1, 38, -1, 28, -1, 34, -1, 50, -1, 50, -1, -1,  0,  0, -1, -1, -1 },
+      { 30, 39, 28, 42, 50, 39,  5, 17, -1,  6, -1, 18, -1, 20, -1, 15, -1, 40, -1, -1,  0,  0, -1, -1 },
+      { 29,  0,  1, 43, 36, 30, 47, -1, 49, -1, 47, -1,  3, -1, 35, -1, 34, -1,  0, -1, -1,  0,  0, -1 },
+      {  1, 32, 11, 23, 10, 44, 12,  7, -1, 48, -1,  4, -1,  9, -1, 17, -1, 16, -1, -1, -1, -1,  0,  0 },
+      { 13,  7, 15, 47, 23, 16, 47, -1, 43, -1, 29, -1, 52, -1,  2, -1, 53, -1,  1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 1296, rate 5/6
+    constexpr int8_t k_protoH1296_56[4][PROTO_H_COLUMNS] = {
+      { 48, 29, 37, 52,  2, 16,  6, 14, 53, 31, 34,  5, 18, 42, 53, 31, 45, -1, 46, 52,  1,  0, -1, -1 },
+      { 17,  4, 30,  7, 43, 11, 24,  6, 14, 21,  6, 39, 17, 40, 47,  7, 15, 41, 19, -1, -1,  0,  0, -1 },
+      {  7,  2, 51, 31, 46, 23, 16, 11, 53, 40, 10,  7, 46, 53, 33, 35, -1, 25, 35, 38,  0, -1,  0,  0 },
+      { 19, 48, 41,  1, 10,  7, 36, 47,  5, 29, 52, 52, 31, 10, 26,  6,  3,  2, -1, 51,  1, -1, -1,  0 }
+    };
+
+    // n = 1944, rate 1/2
+    constexpr int8_t k_protoH1944_12[12][PROTO_H_COLUMNS] = {
+      { 57, -1, -1, -1, 50, -1, 11, -1, 50, -1, 79, -1,  1,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      {  3, -1, 28, -1,  0, -1, -1, -1, 55,  7, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 30, -1, -1, -1, 24, 37, -1, -1, 56, 14, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1, -1 },
+      { 62, 53, -1, -1, 53, -1, -1,  3, 35, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1, -1 },
+      { 40, -1, -1, 20, 66, -1, -1, 22, 28, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1, -1 },
+      {  0, -1, -1, -1,  8, -1, 42, -1, 50, -1, -1,  8, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1 },
+      { 69, 79, 79, -1, -1, -1, 56, -1, 52, -1, -1, -1,  0, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1 },
+      { 65, -1, -1, -1, 38, 57, -1, -1, 72, -1, 27, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1 },
+      { 64, -1, -1, -1, 14, 52, -1, -1, 30, -1, -1, 32, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1, -1 },
+      { -1, 45, -1, 70,  0, -1, -1, -1, 77,  9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0, -1 },
+      {  2, 56, -1, 57, 35, -1, -1, -1, -1, -1, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  0 },
+      { 24, -1, 61, -1, 60, -1, -1, 27, 51, -1, -1, 16,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 1944, rate 2/3
+    constexpr int8_t k_protoH1944_23[8][PROTO_H_COLUMNS] = {
+      { 61, 75,  4, 63, 56, -1, -1, -1, -1, -1, -1,  8, -1,  2, 17, 25,  1,  0, -1, -1, -1, -1, -1, -1 },
+      { 56, 74, 77, 20, -1, -1, -1, 64, 24,  4, 67, -1,  7, -1, -1, -1, -1,  0,  0, -1, -1, -1, -1, -1 },
+      { 28, 21, 68, 10,  7, 14, 65, -1, -1, -1, 23, -1, -1, -1, 75, -1, -1, -1,  0,  0, -1, -1, -1, -1 },
+      { 48, 38, 43, 78, 76, -1, -1, -1, -1,  5, 36, -1, 15, 72, -1, -1, -1, -1, -1,  0,  0, -1, -1, -1 },
+      { 40,  2, 53, 25, -1, 52, 62, -1, 20, -1, -1, 44, -1, -1, -1, -1,  0, -1, -1, -1,  0,  0, -1, -1 },
+      { 69, 23, 64, 10, 22, -1, 21, -1, -1, -1, -1, -1, 68, 23, 29, -1, -1, -1, -1, -1, -1,  0,  0, -1 },
+      { 12,  0, 68, 20, 55, 61, -1, 40, -1, -1, -1, 52, -1, -1, -1, 44, -1, -1, -1, -1, -1, -1,  0,  0 },
+      { 58,  8, 34, 64, 78, -1, -1, 11, 78, 24, -1, -1, -1, -1, -1, 58,  1, -1, -1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 1944, rate 3/4
+    constexpr int8_t k_protoH1944_34[6][PROTO_H_COLUMNS] = {
+      { 48, 29, 28, 39,  9, 61, -1, -1, -1, 63, 45, 80, -1, -1, -1, 37, 32, 22,  1,  0, -1, -1, -1, -1 },
+      {  4, 49, 42, 48, 11, 30, -1, -1, -1, 49, 17, 41, 37, 15, -1, 54, -1, -1, -1,  0,  0, -1, -1, -1 },
+      { 35, 76, 78, 51, 37, 35, 21, -1, 17, 64, -1, -1, -1, 59,  7, -1, -1, 32, -1, -1,  0,  0, -1, -1 },
+      {  9, 65, 44,  9, 54, 56, 73, 34, 42, -1, -1, -1, 35, -1, -1, -1, 46, 39,  0, -1, -1,  0,  0, -1 },
+      {  3, 62,  7, 80, 68, 26, -1, 80, 55, -1, 36, -1, 26, -1,  9, -1, 72, -1, -1, -1, -1, -1,  0,  0 },
+      { 26, 75, 33, 21, 69, 59,  3, 38, -1, -1, -1, 35, -1, 62, 36, 26, -1, -1,  1, -1, -1, -1, -1,  0 }
+    };
+
+    // n = 1944, rate 5/6
+    constexpr int8_t k_protoH1944_56[4][PROTO_H_COLUMNS] = {
+      { 13, 48, 80, 66,  4, 74,  7, 30, 76, 52, 37, 60, -1, 49, 73, 31, 74, 73, 23, -1,  1,  0, -1, -1 },
+      { 69, 63, 74, 56, 64, 77, 57, 65,  6, 16, 51, -1, 64, -1, 68,  9, 48, 62, 54, 27, -1,  0,  0, -1 },
+      { 51, 15,  0, 80, 24, 25, 42, 54, 44, 71, 71,  9, 67, 35, -1, 58, -1, 29, -1, 53,  0, -1,  0,  0 },
+      { 16, 29, 36, 41, 44, 56, 59, 37, 50, 24, -1, 65,  4, 65, 52, -1,  4, -1, 73, 52,  1, -1, -1,  0 }
+    };
+
+    const int8_t *
+    ieee80211nPrototypeMatrix(uint32_t codewordLength,
+        ErrorCorrection::CodingRate rate, uint32_t &rows)
+    {
+#define PROTO_H(table) \
+      rows = sizeof(table) / sizeof(table[0]); \
+      return &table[0][0];
+
+      switch (codewordLength) {
+        case 648:
+          switch (rate) {
+            case ErrorCorrection::CodingRate::RATE_1_2: PROTO_H(k_protoH648_12)
+            case ErrorCorrection::CodingRate::RATE_2_3: PROTO_H(k_protoH648_23)
+            case ErrorCorrection::CodingRate::RATE_3_4: PROTO_H(k_protoH648_34)
+            case ErrorCorrection::CodingRate::RATE_5_6: PROTO_H(k_protoH648_56)
+            default: break;
+          }
+          break;
+        case 1296:
+          switch (rate) {
+            case ErrorCorrection::CodingRate::RATE_1_2: PROTO_H(k_protoH1296_12)
+            case ErrorCorrection::CodingRate::RATE_2_3: PROTO_H(k_protoH1296_23)
+            case ErrorCorrection::CodingRate::RATE_3_4: PROTO_H(k_protoH1296_34)
+            case ErrorCorrection::CodingRate::RATE_5_6: PROTO_H(k_protoH1296_56)
+            default: break;
+          }
+          break;
+        case 1944:
+          switch (rate) {
+            case ErrorCorrection::CodingRate::RATE_1_2: PROTO_H(k_protoH1944_12)
+            case ErrorCorrection::CodingRate::RATE_2_3: PROTO_H(k_protoH1944_23)
+            case ErrorCorrection::CodingRate::RATE_3_4: PROTO_H(k_protoH1944_34)
+            case ErrorCorrection::CodingRate::RATE_5_6: PROTO_H(k_protoH1944_56)
+            default: break;
+          }
+          break;
+        default:
+          break;
+      }
+#undef PROTO_H
+
+      rows = 0;
+      return nullptr;
+    }
+
+    // theta_k of CCSDS 131.0-B Table 7-2, k = 1..26
+    constexpr uint8_t k_ar4jaTheta[26] = {
+      3, 0, 1, 2, 2, 3, 0, 1, 0, 1, 2, 0, 2, 3, 0, 1, 2, 0, 1, 2, 0, 1, 2, 1, 2, 3
+    };
+
+    // phi_k(j, M) of CCSDS 131.0-B Tables 7-3 and 7-4, k = 1..26, for
+    // j = 0..3 and M = 128, 256, 512
+    constexpr uint8_t k_ar4jaPhi[26][4][3] = {
+      { {  1, 59,  16 }, {  0,  0,   0 }, {  0,  0,   0 }, {  0,  0,   0 } },
+      { { 22, 18, 103 }, { 27, 32,  53 }, { 12, 46,   8 }, { 13, 44,  35 } },
+      { {  0, 52, 105 }, { 30, 21,  74 }, { 30, 45, 119 }, { 19, 51,  97 } },
+      { { 26, 23,   0 }, { 28, 36,  45 }, { 18, 27,  89 }, { 14, 12, 112 } },
+      { {  0, 11,  50 }, {  7, 30,  47 }, { 10, 48,  31 }, { 15, 15,  64 } },
+      { { 10,  7,  29 }, {  1, 29,   0 }, { 16, 37, 122 }, { 20, 12,  93 } },
+      { {  5, 22, 115 }, {  8, 44,  59 }, { 13, 41,   1 }, { 17,  4,  99 } },
+      { { 18, 25,  30 }, { 20, 29, 102 }, {  9, 13,  69 }, {  4,  7,  94 } },
+      { {  3, 27,  92 }, { 26, 39,  25 }, {  7,  9,  92 }, {  4,  2, 103 } },
+      { { 22, 30,  78 }, { 28, 14,   3 }, { 15, 49,  47 }, { 11, 30,  91 } },
+      { {  3, 43,  70 }, { 27, 30,  27 }, { 16, 36,  11 }, { 17, 53,   3 } },
+      { {  8, 14,  66 }, {  7, 22, 102 }, { 18, 10,  31 }, { 20, 23,   6 } },
+      { { 25, 46,  39 }, {  5, 43,  77 }, {  4, 11,  19 }, {  8, 29,  39 } },
+      { { 25, 62,  84 }, { 27, 60,  96 }, { 23, 18,  66 }, { 22, 37, 113 } },
+      { {  2, 44,  79 }, { 14, 34, 124 }, {  5,  0,  49 }, { 19, 42,  92 } },
+      { { 27, 12,  70 }, { 22, 11,  27 }, {  3, 58,  81 }, { 15, 48, 119 } },
+      { {  7, 38,  29 }, {  5, 28,  13 }, { 29,  3, 105 }, {  5,  4,   7 } },
+      { {  7, 47,  32 }, { 13, 62,  80 }, { 19, 23, 119 }, { 11, 34, 114 } },
+      { { 15,  1,  45 }, { 31, 53,  13 }, { 23,  7,  48 }, { 13, 57,  32 } },
+      { { 10, 52, 113 }, {  3, 26,  40 }, { 27, 40,  65 }, { 24, 20,  38 } },
+      { {  4, 61,  99 }, { 19, 62,  41 }, { 10, 56,  82 }, { 11, 15,  62 } },
+      { { 19, 56, 117 }, { 12, 54,  57 }, { 12, 49,  86 }, { 22, 15, 112 } },
+      { {  7, 63,  67 }, { 17, 51, 107 }, { 25, 60,  30 }, {  3,  6,  42 } },
+      { {  9, 39,  94 }, {  2,  2,  62 }, {  8, 37,  26 }, { 24, 49,  44 } },
+      { { 26, 26,  76 }, { 31,  5,  14 }, { 15, 18,  21 }, { 25, 30,  41 } },
+      { { 17, 15,  77 }, { 28, 61, 122 }, {  2, 23, 108 }, { 31, 22,  47 } }
+    };
+
+    // The M x M blocks of the rate 4/5 parity check matrix; bit 0 is the
+    // identity and bit k is pi_k. The rate 2/3 and 1/2 matrices are its last
+    // 7 and 5 block columns.
+    constexpr uint32_t k_ar4jaIdentity = 1;
+#define PI(k) (1u << (k))
+    constexpr uint32_t k_ar4jaBlocks[3][11] = {
+      { 0, 0, 0, 0, 0, 0, 0, 0, k_ar4jaIdentity, 0, k_ar4jaIdentity | PI(1) },
+      { PI(21) | PI(22) | PI(23), k_ar4jaIdentity, PI(15) | PI(16) | PI(17), k_ar4jaIdentity,
+        PI(9) | PI(10) | PI(11), k_ar4jaIdentity,
+        k_ar4jaIdentity, k_ar4jaIdentity, 0, k_ar4jaIdentity, PI(2) | PI(3) | PI(4) },
+      { k_ar4jaIdentity, PI(24) | PI(25) | PI(26), k_ar4jaIdentity, PI(18) | PI(19) | PI(20),
+        k_ar4jaIdentity, PI(12) | PI(13) | PI(14),
+        k_ar4jaIdentity, PI(5) | PI(6), 0, PI(7) | PI(8), k_ar4jaIdentity }
+    };
+#undef PI
+
+    std::vector<int8_t>
+    ccsdsAR4JAPrototypeMatrix(ErrorCorrection::CodingRate rate,
+        uint32_t &cols, uint32_t &Z)
+    {
+      // k = 1024 fixes M; see CCSDS 131.0-B Table 7-1
+      uint32_t blockCols, M, m;
+      switch (rate) {
+        case ErrorCorrection::CodingRate::RATE_1_2:
+          blockCols = 5;
+          M = 512;
+          m = 2;
+          break;
+        case ErrorCorrection::CodingRate::RATE_2_3:
+          blockCols = 7;
+          M = 256;
+          m = 1;
+          break;
+        case ErrorCorrection::CodingRate::RATE_4_5:
+          blockCols = 11;
+          M = 128;
+          m = 0;
+          break;
+        default:
+          cols = 0;
+          Z = 0;
+          return std::vector<int8_t>();
+      }
+      Z = M / 4;
+      cols = blockCols * 4;
+
+      std::vector<int8_t> protoH(AR4JA_PROTO_H_ROWS * cols, -1);
+      const uint32_t firstBlock = 11 - blockCols;
+      for (uint32_t bi = 0; bi < 3; bi++) {
+        for (uint32_t bj = 0; bj < blockCols; bj++) {
+          uint32_t blocks = k_ar4jaBlocks[bi][firstBlock + bj];
+          for (uint32_t k = 0; k <= 26; k++) {
+            if ((blocks & (1u << k)) == 0)
+              continue;
+            // pi_k sends rows jZ..jZ+Z-1 of the block to the columns of
+            // quarter (theta_k + j) mod 4, cyclically shifted by phi_k(j, M)
+            for (uint32_t j = 0; j < 4; j++) {
+              uint32_t col = k == 0 ? j : (k_ar4jaTheta[k - 1] + j) % 4;
+              uint32_t shift = k == 0 ? 0 : k_ar4jaPhi[k - 1][j][m];
+              int8_t &entry = protoH[(bi * 4 + j) * cols + bj * 4 + col];
+              // Two permutations of a sum landing on the same submatrix
+              // would not be a single shifted identity
+              if (entry >= 0 || shift >= Z) {
+                cols = 0;
+                Z = 0;
+                return std::vector<int8_t>();
+              }
+              entry = shift;
+            }
+          }
+        }
+      }
+      return protoH;
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
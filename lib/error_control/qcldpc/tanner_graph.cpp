@@ -0,0 +1,105 @@
+/*!
+ * @file tanner_graph.cpp
+ * @author Steven Knudsen
+ * @date June 9, 2021
+ *
+ * @details Edge-indexed Tanner graph used to store LDPC decoder messages.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include "tanner_graph.h"
+
+#include <stdexcept>
+
+namespace ex2
+{
+  namespace sdr
+  {
+
+    TannerGraph::TannerGraph () :
+        m_checkEdgeStart(1, 0),
+        m_symbolEdgeStart(1, 0),
+        m_maxCheckDegree(0)
+    {
+    }
+
+    TannerGraph::TannerGraph (
+        const Eigen::MatrixXi &N,
+        const Eigen::VectorXi &numSymbolNodes,
+        const Eigen::MatrixXi &M,
+        const Eigen::VectorXi &numCheckNodes) :
+            m_maxCheckDegree(0)
+    {
+      uint32_t numChecks = numSymbolNodes.size();
+      uint32_t numSymbols = numCheckNodes.size();
+
+      // Number the edges check node by check node
+      m_checkEdgeStart.resize(numChecks + 1);
+      m_checkEdgeStart[0] = 0;
+      for (uint32_t i = 0; i < numChecks; i++) {
+        m_checkEdgeStart[i + 1] = m_checkEdgeStart[i] + numSymbolNodes(i);
+        if ((uint32_t) numSymbolNodes(i) > m_maxCheckDegree)
+          m_maxCheckDegree = numSymbolNodes(i);
+      }
+
+      uint32_t numEdges = m_checkEdgeStart[numChecks];
+      m_edgeSymbol.resize(numEdges);
+      m_edgeCheck.resize(numEdges);
+      for (uint32_t i = 0; i < numChecks; i++) {
+        for (int j = 0; j < numSymbolNodes(i); j++) {
+          m_edgeSymbol[m_checkEdgeStart[i] + j] = N(i, j);
+          m_edgeCheck[m_checkEdgeStart[i] + j] = i;
+        }
+      }
+
+      // The symbol node view. Since M lists check nodes in increasing order
+      // and the edges are numbered in check node order, walking the edges
+      // once and appending each to its symbol node keeps the same ordering.
+      m_symbolEdgeStart.resize(numSymbols + 1);
+      m_symbolEdgeStart[0] = 0;
+      for (uint32_t j = 0; j < numSymbols; j++)
+        m_symbolEdgeStart[j + 1] = m_symbolEdgeStart[j] + numCheckNodes(j);
+
+      if (m_symbolEdgeStart[numSymbols] != numEdges)
+        throw std::runtime_error("TannerGraph: Check and symbol node edge counts differ.");
+
+      m_symbolEdges.resize(numEdges);
+      std::vector<uint32_t> fill(m_symbolEdgeStart.begin(), m_symbolEdgeStart.end() - 1);
+      for (uint32_t e = 0; e < numEdges; e++)
+        m_symbolEdges[fill[m_edgeSymbol[e]]++] = e;
+
+      m_symbolCheck.resize(numEdges);
+      for (uint32_t p = 0; p < numEdges; p++)
+        m_symbolCheck[p] = m_edgeCheck[m_symbolEdges[p]];
+
+      // Sanity check against M
+      for (uint32_t j = 0; j < numSymbols; j++)
+        for (int c = 0; c < numCheckNodes(j); c++)
+          if (m_symbolCheck[m_symbolEdgeStart[j] + c] != (uint32_t) M(j, c))
+            throw std::runtime_error("TannerGraph: Check and symbol node views differ.");
+    }
+
+    uint32_t
+    TannerGraph::syndrome(const uint8_t *bits, uint8_t *syndrome) const
+    {
+      uint32_t unsatisfied = 0;
+      for (uint32_t i = 0; i < numChecks(); i++) {
+        uint8_t parity = 0;
+        for (uint32_t e = m_checkEdgeStart[i]; e < m_checkEdgeStart[i + 1]; e++)
+          parity ^= bits[m_edgeSymbol[e]];
+        syndrome[i] = parity;
+        unsatisfied += parity;
+      }
+      return unsatisfied;
+    }
+
+    TannerGraph::~TannerGraph ()
+    {
+    }
+
+  } /* namespace sdr */
+} /* namespace ex2 */
@@ -69,6 +69,32 @@ namespace ex2 {
 
     }
 
+    MPDUHeader::MPDUHeader (const std::vector<float> &samples){
+
+      // A transparent mode packet is 129 bytes, Data Field 1 first
+      if (samples.size() != 129 * 8) {
+        throw MPDUHeaderException("MPDUHeader: Bad transparent mode packet length; ");
+      }
+
+      // Skip the 8 samples of Data Field 1; the 3 codewords follow
+      uint16_t decoded[3];
+      for (uint16_t i = 0; i < 3; i++) {
+        decoded[i] = golay_decode_soft(&samples[8 + 24 * i]);
+      }
+      unpackMACHeader(decoded[0], decoded[1], decoded[2]);
+
+      // Maximum likelihood decoding always finds a codeword, so the FEC
+      // scheme is the only check left
+      if (m_errorCorrectionScheme != ErrorCorrection::ErrorCorrectionScheme::NO_FEC &&
+          m_errorCorrectionScheme >= ErrorCorrection::ErrorCorrectionScheme::LAST) {
+        throw MPDUHeaderException("MPDUHeader: Bad transparent mode packet data; ErrorCorrectionScheme not allowed.");
+      }
+
+      m_headerPayload.resize(9,0);
+      encodeMACHeader();
+      m_headerValid = true;
+    }
+
     MPDUHeader::MPDUHeader (MPDUHeader& header)
     {
       m_rfModeNumber = header.m_rfModeNumber;
@@ -93,61 +119,44 @@ namespace ex2 {
       uint16_t headerStart = 0;
       if (dataField1Included) headerStart++;
 
-      // Remember, the first byte is the Data Field 1, the packet length
-      // Decode the first 3 bytes (24 bits)
-      uint32_t recd = ((packet[headerStart++] << 16) & 0x00FF0000);
-      recd = recd | ((packet[headerStart++] << 8 ) & 0x0000FF00);
-      recd = recd | (packet[headerStart++] & 0x000000FF);
-      int16_t decodedFirst = golay_decode(recd);
-
-      if (decodedFirst < 0) {
-        // there were 4 errors in the codeword, so we know it's bad
-        return false;
-      }
-
-      // Decode the middle 3 bytes (24 bits)
-      recd = ((packet[headerStart++] << 16) & 0x00FF0000);
-      recd = recd | ((packet[headerStart++] << 8 ) & 0x0000FF00);
-      recd = recd | (packet[headerStart++] & 0x000000FF);
-      int16_t decodedSecond = golay_decode(recd);
-
-      if (decodedSecond < 0) {
-        // there were 4 errors in the codeword, so we know it's bad
-        return false;
-      }
-
-      // Decode the last 3 bytes (24 bits)
-      recd = ((packet[headerStart++] << 16) & 0x00FF0000);
-      recd = recd | ((packet[headerStart++] << 8 ) & 0x0000FF00);
-      recd = recd | (packet[headerStart++] & 0x000000FF);
-      int16_t decodedThird = golay_decode(recd);
-
-      if (decodedThird < 0) {
-        // there were 4 errors in the codeword, so we know it's bad
+      // Remember, the first byte is the Data Field 1, the packet length.
+      // Decode the 9 bytes (3 24-bit codewords) to 3 12-bit words packed in
+      // 5 bytes
+      uint8_t decoded[5];
+      if (golay_decode_bulk(&packet[headerStart], 3, decoded) != 0) {
+        // there were 4 errors in a codeword, so we know it's bad
         return false;
       }
+      uint16_t decodedFirst = (decoded[0] << 4) | (decoded[1] >> 4);
+      uint16_t decodedSecond = ((decoded[1] & 0x0F) << 8) | decoded[2];
+      uint16_t decodedThird = (decoded[3] << 4) | (decoded[4] >> 4);
 
       // We may have good message bits, but if there were more than 4 errors in
       // either codeword, we won't know. That has to be checked outside of here.
+      unpackMACHeader(decodedFirst, decodedSecond, decodedThird);
 
-      // decodedFirst comprises from msb to lsb rfMode, fecScheme, and 3 msb of
+      return true;
+    } // decodeMACHeader
+
+    void
+    MPDUHeader::unpackMACHeader(uint16_t first, uint16_t second,
+      uint16_t third) {
+      // first comprises from msb to lsb rfMode, fecScheme, and 3 msb of
       // codeword fragment index
-      // decodedSecond comprises the 4 lsb of codeword fragment index and 8 msb
+      // second comprises the 4 lsb of codeword fragment index and 8 msb
       // of user packet length.
-      // decodedThird comprises 4 lsb of user packet length and the 8 bits of
+      // third comprises 4 lsb of user packet length and the 8 bits of
       // user packet fragment index
       m_rfModeNumber =
-          static_cast<RF_Mode::RF_ModeNumber>((decodedFirst >> 9) & 0x0007); // 3 bits
+          static_cast<RF_Mode::RF_ModeNumber>((first >> 9) & 0x0007); // 3 bits
       m_errorCorrectionScheme =
-          static_cast<ErrorCorrection::ErrorCorrectionScheme>((decodedFirst >> 3) & 0x003F); // 6 bits
-      m_codewordFragmentIndex = (decodedFirst & 0x0007) << 4;     // top 3 bits
-      m_codewordFragmentIndex |= ((decodedSecond >> 8) & 0x000F); // bottom 4 bits
-      m_userPacketLength = (decodedSecond & 0x00FF) << 4;         // top 8 bits
-      m_userPacketLength |= ((decodedThird >> 8) & 0x000F);       // bottom 4 bits
-      m_userPacketFragmentIndex = decodedThird & 0x00FF;
-
-      return true;
-    } // decodeMACHeader
+          static_cast<ErrorCorrection::ErrorCorrectionScheme>((first >> 3) & 0x003F); // 6 bits
+      m_codewordFragmentIndex = (first & 0x0007) << 4;     // top 3 bits
+      m_codewordFragmentIndex |= ((second >> 8) & 0x000F); // bottom 4 bits
+      m_userPacketLength = (second & 0x00FF) << 4;         // top 8 bits
+      m_userPacketLength |= ((third >> 8) & 0x000F);       // bottom 4 bits
+      m_userPacketFragmentIndex = third & 0x00FF;
+    } // unpackMACHeader
 
     void
     MPDUHeader::encodeMACHeader() {
@@ -156,38 +165,28 @@ namespace ex2 {
       uint16_t msgBits = ((uint16_t) m_rfModeNumber << 9) & 0x0E00; // 3 bits
       msgBits = msgBits | (((uint16_t) m_errorCorrectionScheme << 3) & 0x01F8); // 6 bits
       msgBits = msgBits | ((m_codewordFragmentIndex >> 4) & 0x0007); // top 3 bits
-
-      uint32_t codeword = golay_encode(msgBits);
-
-      m_headerPayload[2] = (uint8_t)(codeword & 0x000000FF);
-      codeword >>= 8;
-      m_headerPayload[1] = (uint8_t)(codeword & 0x000000FF);
-      codeword >>= 8;
-      m_headerPayload[0] = (uint8_t)(codeword & 0x000000FF);
+      uint16_t first = msgBits;
 
       msgBits = 0;
       msgBits = (m_codewordFragmentIndex << 8) & 0x00000F00;        // bottom 4 bits
       msgBits = msgBits | ((m_userPacketLength >> 4) & 0x000000FF); // top 8 bits
-
-      codeword = golay_encode(msgBits);
-
-      m_headerPayload[5] = (uint8_t)(codeword & 0x000000FF);
-      codeword >>= 8;
-      m_headerPayload[4] = (uint8_t)(codeword & 0x000000FF);
-      codeword >>= 8;
-      m_headerPayload[3] = (uint8_t)(codeword & 0x000000FF);
+      uint16_t second = msgBits;
 
       msgBits = 0;
       msgBits = (m_userPacketLength << 8) & 0x00000F00;
       msgBits = msgBits | (m_userPacketFragmentIndex & 0x000000FF);
-
-      codeword = golay_encode(msgBits);
-
-      m_headerPayload[8] = (uint8_t)(codeword & 0x000000FF);
-      codeword >>= 8;
-      m_headerPayload[7] = (uint8_t)(codeword & 0x000000FF);
-      codeword >>= 8;
-      m_headerPayload[6] = (uint8_t)(codeword & 0x000000FF);
+      uint16_t third = msgBits;
+
+      // Pack the 3 12-bit words in 5 bytes and encode them to the 9 header
+      // bytes
+      uint8_t message[5] = {
+          (uint8_t) (first >> 4),
+          (uint8_t) ((first << 4) | (second >> 8)),
+          (uint8_t) second,
+          (uint8_t) (third >> 4),
+          (uint8_t) (third << 4)
+      };
+      golay_encode_bulk(message, 3, m_headerPayload.data());
     } // encodeMACHeader
 
 
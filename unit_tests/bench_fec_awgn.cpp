@@ -0,0 +1,399 @@
+/*!
+ * @file bench_fec_awgn.cpp
+ * @author Steven Knudsen
+ * @date June 17, 2021
+ *
+ * @details Benchmark the error correction schemes over an AWGN channel.
+ *
+ * For every implemented ErrorCorrectionScheme, random messages are encoded,
+ * BPSK modulated, passed through an AWGN channel and decoded, at each Eb/N0
+ * of a sweep. The frame error rate (FER), bit error rate (BER), average
+ * decode iterations per codeword and encoder and decoder throughput are
+ * reported as CSV or JSON, so that a change to an algorithm can be judged on
+ * its speed and its coding gain together.
+ *
+ * The schemes are
+ *   - the CCSDS AR4JA and IEEE 802.11n LDPC codes, sent with
+ *     LDPC::encodeShortened so that punctured symbols are not transmitted,
+ *     and decoded with the chosen decode algorithm
+ *   - NO_FEC, uncoded BPSK with hard decisions, as the reference for the
+ *     coding gain
+ *   - the extended Golay (24,12) code used for the packet headers, with hard
+ *     decisions, which is not an ErrorCorrectionScheme but is shown for
+ *     comparison
+ *
+ * A frame is one LDPC codeword, or FRAME_BITS message bits for the other
+ * schemes.
+ *
+ * The frames of each point are split into blocks of BLOCK_FRAMES frames
+ * that the worker threads take in turn. Each block has its own random number
+ * stream, seeded from the seed, the scheme, the Eb/N0 and the block number,
+ * so the error counts do not depend on the number of threads or on which
+ * thread ran which block. The throughputs are message bits per second of
+ * encoder or decoder time on one thread; multiply by the threads for the
+ * throughput of the whole machine.
+ *
+ * Usage: bench_fec_awgn [first Eb/N0 dB [last Eb/N0 dB [step dB
+ *   [frames per point [threads [algorithm [csv|json [seed]]]]]]]]
+ *
+ * where algorithm is one of BP, NMS, OMS, LNMS, LOMS, FXP or ILV, and 0
+ * threads means one per hardware thread.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "golay.h"
+#include "ldpc.h"
+
+using namespace std;
+using namespace ex2::sdr;
+
+/*!
+ * @brief Message bits per frame for the schemes that are not LDPC codes; a
+ * multiple of 12 for the Golay code.
+ */
+const uint32_t FRAME_BITS = 1020;
+
+/*!
+ * @brief Frames per block of work, and per random number stream
+ */
+const uint32_t BLOCK_FRAMES = 16;
+
+/*!
+ * @brief Not an ErrorCorrectionScheme; stands for the Golay code in a row
+ */
+const uint16_t GOLAY_24_12 = 0xffff;
+
+struct Algorithm
+{
+  const char *name;
+  LDPC::DecodeAlgorithm algorithm;
+  LDPC::DecodeSchedule schedule;
+};
+
+const Algorithm algorithms[] = {
+  { "BP", LDPC::DecodeAlgorithm::PROBABILITY_DOMAIN_BP, LDPC::DecodeSchedule::FLOODING },
+  { "NMS", LDPC::DecodeAlgorithm::NORMALIZED_MIN_SUM, LDPC::DecodeSchedule::FLOODING },
+  { "OMS", LDPC::DecodeAlgorithm::OFFSET_MIN_SUM, LDPC::DecodeSchedule::FLOODING },
+  { "LNMS", LDPC::DecodeAlgorithm::NORMALIZED_MIN_SUM, LDPC::DecodeSchedule::LAYERED },
+  { "LOMS", LDPC::DecodeAlgorithm::OFFSET_MIN_SUM, LDPC::DecodeSchedule::LAYERED },
+  { "FXP", LDPC::DecodeAlgorithm::FIXED_POINT_MIN_SUM, LDPC::DecodeSchedule::LAYERED },
+  { "ILV", LDPC::DecodeAlgorithm::INTERLEAVED_MIN_SUM, LDPC::DecodeSchedule::LAYERED }
+};
+
+/*!
+ * @brief The counts for one point of one scheme, or one worker's share of
+ * them
+ */
+struct Result
+{
+  uint64_t frames = 0;
+  uint64_t frameErrors = 0;
+  uint64_t bitErrors = 0;
+  uint64_t messageBits = 0;
+  double iterations = 0.0;
+  double encodeSeconds = 0.0;
+  double decodeSeconds = 0.0;
+
+  void add(const Result &r)
+  {
+    frames += r.frames;
+    frameErrors += r.frameErrors;
+    bitErrors += r.bitErrors;
+    messageBits += r.messageBits;
+    iterations += r.iterations;
+    encodeSeconds += r.encodeSeconds;
+    decodeSeconds += r.decodeSeconds;
+  }
+};
+
+/*!
+ * @brief Encodes, transmits and decodes blocks of frames of one scheme.
+ *
+ * @details Each worker thread has its own, as an LDPC object may only
+ * decode on one thread at a time. The LDPC objects share their code.
+ */
+class Trial
+{
+public:
+  Trial(uint16_t scheme, const Algorithm &algorithm) :
+    m_scheme(scheme)
+  {
+    if (isLDPC(scheme)) {
+      m_ldpc.reset(new LDPC(false, static_cast<ErrorCorrection::ErrorCorrectionScheme>(scheme)));
+      m_ldpc->setDecodeAlgorithm(algorithm.algorithm);
+      m_ldpc->setDecodeSchedule(algorithm.schedule);
+      m_frameBits = m_ldpc->getMessageLength();
+      m_transmittedBits = m_ldpc->rateMatching(m_frameBits).transmittedBits;
+
+      // The encoder tables are built on first use; keep that out of the timing
+      PPDU_u8 warmUp(PPDU_u8::payload_t(m_frameBits, 0), PPDU_u8::BitsPerSymbol::BPSymb_1);
+      m_ldpc->encodeShortened(warmUp);
+    }
+    else {
+      m_frameBits = FRAME_BITS;
+      m_transmittedBits = scheme == GOLAY_24_12 ? 2 * FRAME_BITS : FRAME_BITS;
+    }
+  }
+
+  static bool isLDPC(uint16_t scheme)
+  {
+    return scheme >= static_cast<uint16_t>(ErrorCorrection::ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280) &&
+        scheme <= static_cast<uint16_t>(ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_5_6);
+  }
+
+  static string name(uint16_t scheme)
+  {
+    if (scheme == GOLAY_24_12)
+      return "Golay (24,12)";
+    return ErrorCorrection::ErrorCorrectionName(static_cast<ErrorCorrection::ErrorCorrectionScheme>(scheme));
+  }
+
+  /*!
+   * @brief Message bits per transmitted bit
+   */
+  double rate() const
+  {
+    return (double) m_frameBits / m_transmittedBits;
+  }
+
+  /*!
+   * @brief Run @p numFrames frames with the random numbers from @p generator
+   */
+  Result run(uint32_t numFrames, float ebn0dB, mt19937_64 &generator)
+  {
+    Result result;
+    uint32_t k = m_frameBits;
+
+    PPDU_u8::payload_t messages(numFrames * k);
+    for (uint32_t i = 0; i < messages.size(); i++)
+      messages[i] = generator() & 0x01;
+
+    // Encode
+    auto start = chrono::steady_clock::now();
+    PPDU_u8::payload_t transmitted;
+    if (m_ldpc) {
+      PPDU_u8 messagePPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+      transmitted = m_ldpc->encodeShortened(messagePPDU).getPayload();
+    }
+    else if (m_scheme == GOLAY_24_12) {
+      transmitted.resize(2 * messages.size());
+      for (uint32_t w = 0; w < messages.size() / 12; w++) {
+        uint16_t word = 0;
+        for (uint32_t b = 0; b < 12; b++)
+          word |= messages[w * 12 + b] << b;
+        uint32_t codeword = golay_encode(word);
+        for (uint32_t b = 0; b < 24; b++)
+          transmitted[w * 24 + b] = (codeword >> b) & 0x01;
+      }
+    }
+    else
+      transmitted = messages;
+    result.encodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // BPSK maps a 1 bit to +1 and a 0 bit to -1. The noise variance follows
+    // from Es/N0 = R * Eb/N0 for unit energy symbols.
+    double esn0 = pow(10.0, ebn0dB / 10.0) * rate();
+    double sigma2 = 1.0 / (2.0 * esn0);
+    float snrEstimate = 10.0 * log10(1.0 / sigma2);
+    normal_distribution<float> noise(0.0f, sqrt(sigma2));
+    PPDU_f::payload_t received(transmitted.size());
+    for (uint32_t i = 0; i < transmitted.size(); i++)
+      received[i] = (transmitted[i] ? 1.0f : -1.0f) + noise(generator);
+
+    // Decode
+    start = chrono::steady_clock::now();
+    PPDU_u8::payload_t decoded(messages.size());
+    if (m_ldpc) {
+      m_ldpc->decodeShortened(received, snrEstimate, messages.size(), 0, decoded);
+      result.iterations = m_ldpc->getAverageIterations() * numFrames;
+    }
+    else if (m_scheme == GOLAY_24_12) {
+      for (uint32_t w = 0; w < messages.size() / 12; w++) {
+        uint32_t codeword = 0;
+        for (uint32_t b = 0; b < 24; b++)
+          codeword |= (uint32_t) (received[w * 24 + b] > 0.0f) << b;
+        // Keep the received data bits if the errors cannot be corrected
+        int16_t word = golay_decode(codeword);
+        if (word < 0)
+          word = codeword & 0x0fff;
+        for (uint32_t b = 0; b < 12; b++)
+          decoded[w * 12 + b] = (word >> b) & 0x01;
+      }
+    }
+    else
+      for (uint32_t i = 0; i < received.size(); i++)
+        decoded[i] = received[i] > 0.0f;
+    result.decodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    for (uint32_t f = 0; f < numFrames; f++) {
+      uint32_t errors = 0;
+      for (uint32_t i = 0; i < k; i++)
+        errors += decoded[f * k + i] != messages[f * k + i];
+      result.bitErrors += errors;
+      result.frameErrors += errors > 0;
+    }
+    result.frames = numFrames;
+    result.messageBits = messages.size();
+
+    return result;
+  }
+
+private:
+  uint16_t m_scheme;
+  unique_ptr<LDPC> m_ldpc;
+  uint32_t m_frameBits;
+  uint32_t m_transmittedBits;
+};
+
+/*!
+ * @brief Run one point on all the workers
+ */
+Result runPoint(vector<unique_ptr<Trial>> &trials, uint16_t scheme,
+  uint32_t pointIndex, float ebn0dB, uint32_t numFrames, uint64_t seed)
+{
+  uint32_t numBlocks = (numFrames + BLOCK_FRAMES - 1) / BLOCK_FRAMES;
+  uint32_t numThreads = min((uint32_t) trials.size(), numBlocks);
+
+  atomic<uint32_t> nextBlock(0);
+  vector<Result> results(numThreads);
+  vector<exception_ptr> errors(numThreads);
+
+  auto worker = [&](uint32_t w) {
+    try {
+      uint32_t block;
+      while ((block = nextBlock++) < numBlocks) {
+        seed_seq sequence{ (uint32_t) seed, (uint32_t) (seed >> 32), (uint32_t) scheme,
+          pointIndex, block };
+        mt19937_64 generator(sequence);
+        uint32_t count = min(BLOCK_FRAMES, numFrames - block * BLOCK_FRAMES);
+        results[w].add(trials[w]->run(count, ebn0dB, generator));
+      }
+    }
+    catch (...) {
+      errors[w] = current_exception();
+    }
+  };
+
+  vector<thread> threads;
+  for (uint32_t w = 1; w < numThreads; w++)
+    threads.emplace_back(worker, w);
+  worker(0);
+  for (thread &t : threads)
+    t.join();
+
+  for (exception_ptr &e : errors)
+    if (e)
+      rethrow_exception(e);
+
+  Result total;
+  for (const Result &r : results)
+    total.add(r);
+  return total;
+}
+
+int main(int argc, char *argv[])
+{
+  float firstEbN0dB = 0.0f;
+  float lastEbN0dB = 4.0f;
+  float stepdB = 1.0f;
+  uint32_t numFrames = 64;
+  uint32_t numThreads = 0;
+  const char *algorithmName = "FXP";
+  bool json = false;
+  uint64_t seed = 12345;
+  if (argc > 1) firstEbN0dB = atof(argv[1]);
+  if (argc > 2) lastEbN0dB = atof(argv[2]);
+  if (argc > 3) stepdB = atof(argv[3]);
+  if (argc > 4) numFrames = atoi(argv[4]);
+  if (argc > 5) numThreads = atoi(argv[5]);
+  if (argc > 6) algorithmName = argv[6];
+  if (argc > 7) json = strcmp(argv[7], "json") == 0;
+  if (argc > 8) seed = strtoull(argv[8], nullptr, 0);
+
+  const Algorithm *algorithm = nullptr;
+  for (const Algorithm &a : algorithms)
+    if (strcmp(a.name, algorithmName) == 0)
+      algorithm = &a;
+  if (algorithm == nullptr || stepdB <= 0.0f || numFrames == 0) {
+    fprintf(stderr, "Usage: %s [first Eb/N0 dB [last Eb/N0 dB [step dB [frames per point"
+      " [threads [BP|NMS|OMS|LNMS|LOMS|FXP|ILV [csv|json [seed]]]]]]]]\n", argv[0]);
+    return 1;
+  }
+
+  if (numThreads == 0)
+    numThreads = max(1u, thread::hardware_concurrency());
+
+  vector<uint16_t> schemes;
+  schemes.push_back(static_cast<uint16_t>(ErrorCorrection::ErrorCorrectionScheme::NO_FEC));
+  schemes.push_back(GOLAY_24_12);
+  for (uint16_t s = static_cast<uint16_t>(ErrorCorrection::ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280);
+      s <= static_cast<uint16_t>(ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_5_6);
+      s++)
+    schemes.push_back(s);
+
+  if (json)
+    printf("{\n  \"algorithm\": \"%s\",\n  \"threads\": %u,\n  \"seed\": %llu,\n  \"results\": [",
+      algorithm->name, numThreads, (unsigned long long) seed);
+  else
+    printf("code,rate,algorithm,ebn0_db,frames,frame_errors,fer,bit_errors,ber,iterations,encode_mbps,decode_mbps\n");
+
+  bool first = true;
+  for (uint16_t scheme : schemes) {
+    vector<unique_ptr<Trial>> trials;
+    for (uint32_t w = 0; w < numThreads; w++)
+      trials.emplace_back(new Trial(scheme, *algorithm));
+    const char *algorithmColumn = Trial::isLDPC(scheme) ? algorithm->name : "HARD";
+
+    uint32_t pointIndex = 0;
+    for (float ebn0dB = firstEbN0dB; ebn0dB <= lastEbN0dB + stepdB / 2; ebn0dB = firstEbN0dB + ++pointIndex * stepdB) {
+      Result r = runPoint(trials, scheme, pointIndex, ebn0dB, numFrames, seed);
+
+      double fer = (double) r.frameErrors / r.frames;
+      double ber = (double) r.bitErrors / r.messageBits;
+      double iterations = r.iterations / r.frames;
+      double encodeMbps = r.encodeSeconds > 0.0 ? r.messageBits / r.encodeSeconds / 1.0e6 : 0.0;
+      double decodeMbps = r.decodeSeconds > 0.0 ? r.messageBits / r.decodeSeconds / 1.0e6 : 0.0;
+      string code = Trial::name(scheme);
+
+      if (json) {
+        printf("%s\n    { \"code\": \"%s\", \"rate\": %.4f, \"algorithm\": \"%s\", \"ebn0_db\": %.2f,"
+          " \"frames\": %llu, \"frame_errors\": %llu, \"fer\": %.4e, \"bit_errors\": %llu,"
+          " \"ber\": %.4e, \"iterations\": %.2f, \"encode_mbps\": %.3f, \"decode_mbps\": %.3f }",
+          first ? "" : ",", code.c_str(), trials[0]->rate(), algorithmColumn, ebn0dB,
+          (unsigned long long) r.frames, (unsigned long long) r.frameErrors, fer,
+          (unsigned long long) r.bitErrors, ber, iterations, encodeMbps, decodeMbps);
+      }
+      else {
+        printf("\"%s\",%.4f,%s,%.2f,%llu,%llu,%.4e,%llu,%.4e,%.2f,%.3f,%.3f\n",
+          code.c_str(), trials[0]->rate(), algorithmColumn, ebn0dB,
+          (unsigned long long) r.frames, (unsigned long long) r.frameErrors, fer,
+          (unsigned long long) r.bitErrors, ber, iterations, encodeMbps, decodeMbps);
+      }
+      fflush(stdout);
+      first = false;
+    }
+  }
+
+  if (json)
+    printf("\n  ]\n}\n");
+
+  return 0;
+}
@@ -0,0 +1,288 @@
+/*!
+ * @file bench_golay.cpp
+ * @author Steven Knudsen
+ * @date June 22, 2021
+ *
+ * @details Exhaustively verify the Golay (24,12) codec and benchmark it.
+ *
+ * Every one of the 2^12 messages is encoded and every error pattern of
+ * weight 4 or less is applied to its codeword, for 4096 x 12951 received
+ * words. Each received word must be
+ *   - corrected, with golay_errors returning the error pattern, if the
+ *     weight is 3 or less
+ *   - detected, with golay_decode returning -1, if the weight is 4
+ * and golay_decode_bulk must agree with golay_decode on all of a message's
+ * received words. The messages are shared out among the worker threads.
+ *
+ * The encode and decode throughputs of the one word and bulk functions are
+ * then measured over the same received words with all threads running, and
+ * reported in millions of words per second for the whole machine. The soft
+ * decoder, which is much slower, is timed over one received word per
+ * message.
+ *
+ * The exit status is nonzero if any check fails, so this is also a
+ * regression test.
+ *
+ * Usage: bench_golay [threads [repetitions]]
+ *
+ * where 0 threads means one per hardware thread, and the throughput is the
+ * best of the repetitions.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "golay.h"
+
+using namespace std;
+
+namespace
+{
+  const uint32_t NUM_MESSAGES = 4096;
+
+  /*!
+   * @brief Most failures of each kind to print
+   */
+  const uint32_t MAX_REPORTED = 10;
+
+  /*!
+   * @brief Every 24 bit error pattern of weight 4 or less, in order of weight
+   */
+  vector<uint32_t> errorPatterns()
+  {
+    vector<uint32_t> patterns;
+    patterns.push_back(0);
+    for (uint32_t weight = 1; weight <= 4; weight++)
+      for (uint32_t p = 1; p < (1u << 24); p++)
+        if ((uint32_t) __builtin_popcount(p) == weight)
+          patterns.push_back(p);
+    return patterns;
+  }
+
+  /*!
+   * @brief Pack 24 bit codewords, 3 bytes each, most significant byte first
+   */
+  void packCodewords(const uint32_t *codewords, uint32_t numWords, uint8_t *bytes)
+  {
+    for (uint32_t i = 0; i < numWords; i++) {
+      bytes[3 * i] = codewords[i] >> 16;
+      bytes[3 * i + 1] = codewords[i] >> 8;
+      bytes[3 * i + 2] = codewords[i];
+    }
+  }
+
+  /*!
+   * @brief The @p i th 12 bit word packed by golay_decode_bulk
+   */
+  uint16_t unpackWord(const uint8_t *data, uint32_t i)
+  {
+    const uint8_t *d = &data[3 * (i / 2)];
+    if (i & 1)
+      return ((d[1] & 0x0f) << 8) | d[2];
+    return (d[0] << 4) | (d[1] >> 4);
+  }
+
+  /*!
+   * @brief Run @p work on every message, with the messages shared out among
+   * @p numThreads threads.
+   *
+   * @param[in] work Called with the thread number and the message
+   * @return The wall clock time in seconds
+   */
+  double forEachMessage(uint32_t numThreads, const function<void(uint32_t, uint16_t)> &work)
+  {
+    atomic<uint32_t> nextMessage(0);
+    auto worker = [&](uint32_t w) {
+      uint32_t message;
+      while ((message = nextMessage++) < NUM_MESSAGES)
+        work(w, message);
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (uint32_t w = 1; w < numThreads; w++)
+      threads.emplace_back(worker, w);
+    worker(0);
+    for (thread &t : threads)
+      t.join();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  }
+
+  /*!
+   * @brief Print a failed check unless too many have been printed already
+   */
+  void report(atomic<uint32_t> &failures, const char *what, uint16_t message, uint32_t pattern,
+    int32_t got, int32_t expected)
+  {
+    if (failures++ < MAX_REPORTED)
+      fprintf(stderr, "FAIL %s: message 0x%03x pattern 0x%06x got %d expected %d\n", what,
+        message, pattern, got, expected);
+  }
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  uint32_t numThreads = 0;
+  uint32_t repetitions = 3;
+  if (argc > 1) numThreads = atoi(argv[1]);
+  if (argc > 2) repetitions = max(1, atoi(argv[2]));
+  if (numThreads == 0)
+    numThreads = max(1u, thread::hardware_concurrency());
+
+  const vector<uint32_t> patterns = errorPatterns();
+  const uint32_t numPatterns = patterns.size();
+  const double numWords = (double) NUM_MESSAGES * numPatterns;
+
+  printf("Golay (24,12): %u messages x %u error patterns, %u threads\n", NUM_MESSAGES,
+    numPatterns, numThreads);
+
+  // Per thread buffers for one message's received words
+  vector<vector<uint32_t>> received(numThreads, vector<uint32_t>(numPatterns));
+  vector<vector<uint8_t>> bytes(numThreads, vector<uint8_t>(3 * numPatterns));
+  vector<vector<uint8_t>> decoded(numThreads, vector<uint8_t>((3 * numPatterns + 1) / 2));
+
+  // ---------------------------------------------------------------------
+  // Verification
+  // ---------------------------------------------------------------------
+  atomic<uint32_t> failures(0);
+  double seconds = forEachMessage(numThreads, [&](uint32_t w, uint16_t message) {
+    uint32_t codeword = golay_encode(message);
+    if ((codeword & 0x0fff) != message)
+      report(failures, "golay_encode data bits", message, 0, codeword & 0x0fff, message);
+
+    for (uint32_t i = 0; i < numPatterns; i++) {
+      uint32_t pattern = patterns[i];
+      uint32_t recd = codeword ^ pattern;
+      received[w][i] = recd;
+
+      int16_t d = golay_decode(recd);
+      if (__builtin_popcount(pattern) <= 3) {
+        if (d != (int16_t) message)
+          report(failures, "golay_decode", message, pattern, d, message);
+        int32_t e = golay_errors(recd);
+        if (e != (int32_t) pattern)
+          report(failures, "golay_errors", message, pattern, e, pattern);
+      }
+      else if (d != -1) {
+        report(failures, "golay_decode detect", message, pattern, d, -1);
+      }
+    }
+
+    // The bulk decoder passes uncorrectable words' data bits through
+    packCodewords(received[w].data(), numPatterns, bytes[w].data());
+    uint32_t uncorrectable = golay_decode_bulk(bytes[w].data(), numPatterns, decoded[w].data());
+    uint32_t expectedUncorrectable = 0;
+    for (uint32_t i = 0; i < numPatterns; i++) {
+      int16_t d = golay_decode(received[w][i]);
+      if (d < 0) {
+        expectedUncorrectable++;
+        d = received[w][i] & 0x0fff;
+      }
+      uint16_t b = unpackWord(decoded[w].data(), i);
+      if (b != d)
+        report(failures, "golay_decode_bulk", message, patterns[i], b, d);
+    }
+    if (uncorrectable != expectedUncorrectable)
+      report(failures, "golay_decode_bulk count", message, 0, uncorrectable, expectedUncorrectable);
+  });
+  printf("verified %.0f received words in %.2f s: %u failures\n", numWords, seconds,
+    failures.load());
+
+  // ---------------------------------------------------------------------
+  // Throughput
+  // ---------------------------------------------------------------------
+
+  // Keep the results live so the work is not optimized away
+  vector<uint32_t> sinks(numThreads, 0);
+
+  // The bulk functions are timed on their own, without the packing of their
+  // input, on each thread; the machine's time is the threads' mean
+  vector<double> threadSeconds(numThreads);
+  auto timed = [&](uint32_t w, const function<void()> &call) {
+    auto start = chrono::steady_clock::now();
+    call();
+    threadSeconds[w] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  };
+
+  auto best = [&](bool perThread, const function<void(uint32_t, uint16_t)> &work) {
+    double fastest = 0.0;
+    for (uint32_t r = 0; r < repetitions; r++) {
+      fill(threadSeconds.begin(), threadSeconds.end(), 0.0);
+      double s = forEachMessage(numThreads, work);
+      if (perThread) {
+        s = 0.0;
+        for (double t : threadSeconds)
+          s += t / numThreads;
+      }
+      fastest = r == 0 ? s : min(fastest, s);
+    }
+    return fastest;
+  };
+
+  printf("%-20s %12s\n", "function", "Mwords/s");
+
+  seconds = best(false, [&](uint32_t w, uint16_t message) {
+    uint32_t sink = 0;
+    for (uint32_t i = 0; i < numPatterns; i++)
+      sink ^= golay_encode((message + i) & 0x0fff);
+    sinks[w] ^= sink;
+  });
+  printf("%-20s %12.2f\n", "golay_encode", numWords / seconds / 1.0e6);
+
+  seconds = best(true, [&](uint32_t w, uint16_t message) {
+    uint8_t *data = decoded[w].data();
+    for (uint32_t i = 0; i < decoded[w].size(); i++)
+      data[i] = message + i;
+    timed(w, [&]() { golay_encode_bulk(data, numPatterns, bytes[w].data()); });
+    sinks[w] ^= bytes[w][message % bytes[w].size()];
+  });
+  printf("%-20s %12.2f\n", "golay_encode_bulk", numWords / seconds / 1.0e6);
+
+  seconds = best(false, [&](uint32_t w, uint16_t message) {
+    uint32_t codeword = golay_encode(message);
+    uint32_t sink = 0;
+    for (uint32_t i = 0; i < numPatterns; i++)
+      sink ^= golay_decode(codeword ^ patterns[i]);
+    sinks[w] ^= sink;
+  });
+  printf("%-20s %12.2f\n", "golay_decode", numWords / seconds / 1.0e6);
+
+  seconds = best(true, [&](uint32_t w, uint16_t message) {
+    uint32_t codeword = golay_encode(message);
+    for (uint32_t i = 0; i < numPatterns; i++)
+      received[w][i] = codeword ^ patterns[i];
+    packCodewords(received[w].data(), numPatterns, bytes[w].data());
+    timed(w, [&]() {
+      sinks[w] ^= golay_decode_bulk(bytes[w].data(), numPatterns, decoded[w].data());
+    });
+  });
+  printf("%-20s %12.2f\n", "golay_decode_bulk", numWords / seconds / 1.0e6);
+
+  // One received word per message, as soft BPSK samples
+  seconds = best(false, [&](uint32_t w, uint16_t message) {
+    uint32_t recd = golay_encode(message) ^ patterns[numPatterns - 1 - message];
+    float samples[24];
+    for (uint32_t i = 0; i < 24; i++)
+      samples[23 - i] = ((recd >> i) & 1) ? 1.0f : -1.0f;
+    sinks[w] ^= golay_decode_soft(samples);
+  });
+  printf("%-20s %12.4f\n", "golay_decode_soft", NUM_MESSAGES / seconds / 1.0e6);
+
+  static volatile uint32_t sink;
+  for (uint32_t s : sinks)
+    sink = sink ^ s;
+
+  return failures == 0 ? 0 : 1;
+}
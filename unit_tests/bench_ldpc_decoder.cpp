@@ -0,0 +1,156 @@
+/*!
+ * @file bench_ldpc_decoder.cpp
+ * @author Steven Knudsen
+ * @date June 8, 2021
+ *
+ * @details Benchmark the LDPC decode algorithms.
+ *
+ * For each of the IEEE 802.11n QC-LDPC codes, random messages are encoded,
+ * BPSK modulated, passed through an AWGN channel and decoded with each of the
+ * decode algorithms and schedules. The frame error rate (FER), bit error rate
+ * (BER), average decode iterations per codeword and decoder throughput in
+ * message bits per second are reported.
+ *
+ * The fixed point decoder is also run through LDPC::decodeParallel (FXP-MT)
+ * with the given number of worker threads, one per hardware thread by default.
+ * The interleaved decoder (ILV) is run through LDPC::decodeBatch with one
+ * codeword per payload, as a stream of short packets would be.
+ *
+ * A nonzero stall count turns on LDPC::setStallIterations, which stops
+ * decoding frames that have stopped making progress.
+ *
+ * Usage: bench_ldpc_decoder [Eb/N0 dB [frames per code [threads [stall]]]]
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ldpc.h"
+#include "ldpc_kernel.h"
+
+using namespace std;
+using namespace ex2::sdr;
+
+int main(int argc, char *argv[])
+{
+  float ebn0dB = 3.0f;
+  uint32_t numFrames = 20;
+  uint32_t numThreads = 0;
+  uint32_t stallIterations = LDPC::DECODE_STALL_ITERATIONS_DEFAULT;
+  if (argc > 1) ebn0dB = atof(argv[1]);
+  if (argc > 2) numFrames = atoi(argv[2]);
+  if (argc > 3) numThreads = atoi(argv[3]);
+  if (argc > 4) stallIterations = atoi(argv[4]);
+
+  const LDPC::DecodeAlgorithm algorithms[] = {
+    LDPC::DecodeAlgorithm::PROBABILITY_DOMAIN_BP,
+    LDPC::DecodeAlgorithm::NORMALIZED_MIN_SUM,
+    LDPC::DecodeAlgorithm::OFFSET_MIN_SUM,
+    LDPC::DecodeAlgorithm::NORMALIZED_MIN_SUM,
+    LDPC::DecodeAlgorithm::OFFSET_MIN_SUM,
+    LDPC::DecodeAlgorithm::FIXED_POINT_MIN_SUM,
+    LDPC::DecodeAlgorithm::FIXED_POINT_MIN_SUM,
+    LDPC::DecodeAlgorithm::INTERLEAVED_MIN_SUM
+  };
+  const LDPC::DecodeSchedule schedules[] = {
+    LDPC::DecodeSchedule::FLOODING,
+    LDPC::DecodeSchedule::FLOODING,
+    LDPC::DecodeSchedule::FLOODING,
+    LDPC::DecodeSchedule::LAYERED,
+    LDPC::DecodeSchedule::LAYERED,
+    LDPC::DecodeSchedule::LAYERED,
+    LDPC::DecodeSchedule::LAYERED,
+    LDPC::DecodeSchedule::LAYERED
+  };
+  const bool parallel[] = { false, false, false, false, false, false, true, false };
+  const bool batch[] = { false, false, false, false, false, false, false, true };
+  const char *algorithmNames[] = { "BP", "NMS", "OMS", "LNMS", "LOMS", "FXP", "FXP-MT", "ILV" };
+
+  mt19937 generator(12345);
+
+  printf("Eb/N0 = %.2f dB, %d frames per code, stall %d, FXP kernels %s\n", ebn0dB,
+    numFrames, stallIterations, ldpcKernels().name);
+  printf("%-40s %-6s %10s %12s %8s %12s\n", "code", "alg", "FER", "BER", "iter", "Mbps");
+
+  for (uint16_t s = static_cast<uint16_t>(ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+      s <= static_cast<uint16_t>(ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_5_6);
+      s++) {
+    ErrorCorrection::ErrorCorrectionScheme scheme = static_cast<ErrorCorrection::ErrorCorrectionScheme>(s);
+    LDPC ldpc(false, scheme);
+    ldpc.setDecodeThreads(numThreads);
+    ldpc.setStallIterations(stallIterations);
+    uint32_t k = ldpc.getMessageLength();
+    uint32_t n = ldpc.getCodewordLength();
+
+    // Make the messages and encode them
+    PPDU_u8::payload_t messages(numFrames * k);
+    for (uint32_t i = 0; i < messages.size(); i++)
+      messages[i] = generator() & 0x01;
+    PPDU_u8 messagePPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    PPDU_u8::payload_t codewords = ldpc.encodeSparse(messagePPDU).getPayload();
+
+    // BPSK maps a 1 bit to +1 and a 0 bit to -1. The noise variance follows
+    // from Es/N0 = R * Eb/N0 for unit energy symbols.
+    double esn0 = pow(10.0, ebn0dB / 10.0) * k / n;
+    double sigma2 = 1.0 / (2.0 * esn0);
+    float snrEstimate = 10.0 * log10(1.0 / sigma2);
+    normal_distribution<float> noise(0.0f, sqrt(sigma2));
+    PPDU_f::payload_t received(codewords.size());
+    for (uint32_t i = 0; i < codewords.size(); i++)
+      received[i] = (codewords[i] ? 1.0f : -1.0f) + noise(generator);
+
+    // The same codewords as separate payloads for decodeBatch
+    vector<PPDU_f::payload_t> receivedPayloads(numFrames);
+    vector<PPDU_u8::payload_t> decodedPayloads(numFrames);
+    for (uint32_t f = 0; f < numFrames; f++)
+      receivedPayloads[f].assign(received.begin() + f * n, received.begin() + (f + 1) * n);
+
+    for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+      ldpc.setDecodeAlgorithm(algorithms[a]);
+      ldpc.setDecodeSchedule(schedules[a]);
+      PPDU_u8::payload_t decoded;
+
+      auto start = chrono::steady_clock::now();
+      if (parallel[a])
+        ldpc.decodeParallel(received, snrEstimate, decoded);
+      else if (batch[a])
+        ldpc.decodeBatch(receivedPayloads.data(), numFrames, snrEstimate, decodedPayloads.data());
+      else
+        ldpc.decode(received, snrEstimate, decoded);
+      double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+      if (batch[a])
+        for (uint32_t f = 0; f < numFrames; f++)
+          decoded.insert(decoded.end(), decodedPayloads[f].begin(), decodedPayloads[f].end());
+
+      uint32_t frameErrors = 0;
+      uint32_t bitErrors = 0;
+      for (uint32_t f = 0; f < numFrames; f++) {
+        uint32_t errors = 0;
+        for (uint32_t i = 0; i < k; i++)
+          errors += decoded[f * k + i] != messages[f * k + i];
+        bitErrors += errors;
+        frameErrors += errors > 0;
+      }
+
+      printf("%-40s %-6s %10.3e %12.3e %8.2f %12.3f\n",
+        ErrorCorrection::ErrorCorrectionName(scheme).c_str(),
+        algorithmNames[a],
+        (double) frameErrors / numFrames,
+        (double) bitErrors / (numFrames * k),
+        ldpc.getAverageIterations(),
+        (numFrames * k) / elapsed / 1.0e6);
+    }
+  }
+
+  return 0;
+}
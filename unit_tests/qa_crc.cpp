@@ -0,0 +1,240 @@
+/*!
+ * @file qa_crc.cpp
+ * @author Steven Knudsen
+ * @date June 23, 2021
+ *
+ * @details Unit test for the CRC engine and the crc class.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "crc.hpp"
+#include "crc_engine.hpp"
+#include "ppdu_u8.hpp"
+
+using namespace std;
+using namespace ex2::sdr;
+
+#include "gtest/gtest.h"
+
+/*!
+ * @brief One bit at a time CRC, straight from the definition.
+ */
+uint32_t bitwiseCRC(uint32_t width, uint32_t poly, bool reflected, uint32_t init,
+  uint32_t xorOut, const uint8_t *data, size_t length)
+{
+  uint32_t top = 1u << (width - 1);
+  uint32_t mask = top | (top - 1);
+  uint32_t r = 0;
+  // Run the register in normal (most significant first) order
+  for (uint32_t i = 0; i < width; i++)
+    if ((init >> i) & 1)
+      r |= reflected ? 1u << (width - 1 - i) : 1u << i;
+  for (size_t n = 0; n < length; n++) {
+    for (uint32_t b = 0; b < 8; b++) {
+      uint32_t bit = reflected ? (data[n] >> b) & 1 : (data[n] >> (7 - b)) & 1;
+      bool feedback = ((r & top) != 0) != (bit != 0);
+      r = (r << 1) & mask;
+      if (feedback)
+        r ^= poly;
+    }
+  }
+  uint32_t out = r;
+  if (reflected) {
+    out = 0;
+    for (uint32_t i = 0; i < width; i++)
+      if ((r >> i) & 1)
+        out |= 1u << (width - 1 - i);
+  }
+  return (out ^ xorOut) & mask;
+}
+
+/*!
+ * @brief Compare an engine with the bitwise CRC for lengths and alignments
+ * that use the tables alone and the folding kernel, and when the data is
+ * split or combined.
+ */
+template<class Engine>
+void checkEngine(uint32_t width, uint32_t poly, bool reflected, uint32_t init,
+  uint32_t xorOut, uint32_t checkValue)
+{
+  const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  EXPECT_EQ(Engine::compute(check, sizeof(check)), checkValue);
+
+  mt19937 generator(2021);
+  vector<uint8_t> buffer(3000);
+  for (uint8_t &b : buffer)
+    b = generator();
+
+  for (size_t length = 0; length < 1100; length += (length < 300 ? 1 : 37)) {
+    for (size_t offset = 0; offset < 3; offset++) {
+      ASSERT_EQ(Engine::compute(&buffer[offset], length),
+        bitwiseCRC(width, poly, reflected, init, xorOut, &buffer[offset], length))
+        << "length " << length << " offset " << offset;
+    }
+  }
+
+  for (uint32_t trial = 0; trial < 100; trial++) {
+    size_t length = generator() % buffer.size();
+    size_t split = generator() % (length + 1);
+    uint32_t state = Engine::update(Engine::INITIAL, buffer.data(), split);
+    state = Engine::update(state, &buffer[split], length - split);
+    ASSERT_EQ(Engine::finish(state), Engine::compute(buffer.data(), length))
+      << "length " << length << " split " << split;
+
+    uint32_t stateB = Engine::update(Engine::INITIAL, &buffer[split], length - split);
+    state = Engine::combine(Engine::update(Engine::INITIAL, buffer.data(), split), stateB,
+      length - split);
+    ASSERT_EQ(Engine::finish(state), Engine::compute(buffer.data(), length))
+      << "combine, length " << length << " split " << split;
+  }
+}
+
+TEST(crc, Engines )
+{
+  checkEngine<CRC16ARC>(16, 0x8005, true, 0x0000, 0x0000, 0xbb3d);
+  checkEngine<CRC16AX25>(16, 0x1021, true, 0xffff, 0xffff, 0x906e);
+  checkEngine<CRC16CCSDS>(16, 0x1021, false, 0xffff, 0x0000, 0x29b1);
+  checkEngine<CRC32>(32, 0x04c11db7, true, 0xffffffff, 0xffffffff, 0xcbf43926);
+  checkEngine<CRC32C>(32, 0x1edc6f41, true, 0xffffffff, 0xffffffff, 0xe3069283);
+}
+
+/*!
+ * @brief Add a CRC to a PDU, check and remove it, and check that a
+ * corrupted PDU fails.
+ */
+TEST(crc, AddAndCheck )
+{
+  mt19937 generator(2021);
+  crc c;
+
+  for (crc::crc_size_t crcSize : { crc::CRC_16_BITS, crc::CRC_32_BITS }) {
+    for (uint32_t length : { 1u, 17u, 129u, 1000u }) {
+      PPDU_u8::payload_t payload(length);
+      for (uint8_t &b : payload)
+        b = generator();
+
+      PPDU_u8 pdu(payload);
+      c.add(pdu, crcSize);
+      ASSERT_EQ(pdu.payloadLength(), length + crcSize / 8);
+
+      PPDU_u8::payload_t bad = pdu.getPayload();
+      c.check(pdu, crcSize);
+      EXPECT_EQ(pdu.getPayload(), payload);
+
+      bad[generator() % length] ^= 1 << (generator() % 8);
+      PPDU_u8 badPDU(bad);
+      EXPECT_THROW(c.check(badPDU, crcSize), std::runtime_error);
+    }
+  }
+}
+
+/*!
+ * @brief Check a payload that arrives as 128 byte fragments, in order and
+ * out of order, against the CRC that crc::add appended.
+ */
+TEST(crc, Fragments )
+{
+  const uint32_t fragmentLength = 128;
+  mt19937 generator(2021);
+  crc c;
+
+  for (crc::crc_size_t crcSize : { crc::CRC_16_BITS, crc::CRC_32_BITS }) {
+    for (uint32_t length : { 1u, 128u, 500u, 4095u }) {
+      PPDU_u8::payload_t payload(length);
+      for (uint8_t &b : payload)
+        b = generator();
+      PPDU_u8 pdu(payload);
+      c.add(pdu, crcSize);
+      const uint8_t *trailer = &pdu.getPayload()[length];
+
+      uint32_t numFragments = (length + fragmentLength - 1) / fragmentLength;
+      vector<PPDU_u8> fragments;
+      for (uint32_t f = 0; f < numFragments; f++) {
+        uint32_t start = f * fragmentLength;
+        uint32_t end = min(length, start + fragmentLength);
+        fragments.emplace_back(PPDU_u8::payload_t(&payload[start], &payload[0] + end));
+      }
+
+      crc::Context inOrder(crcSize);
+      for (const PPDU_u8 &fragment : fragments)
+        inOrder.update(fragment);
+      EXPECT_EQ(inOrder.length(), length);
+      EXPECT_TRUE(inOrder.matches(trailer)) << "length " << length;
+
+      // Each fragment's CRC as it arrives, then combined in order
+      vector<uint32_t> arrival(numFragments);
+      for (uint32_t f = 0; f < numFragments; f++)
+        arrival[f] = f;
+      shuffle(arrival.begin(), arrival.end(), generator);
+      vector<crc::Context> contexts(numFragments, crc::Context(crcSize));
+      for (uint32_t f : arrival)
+        contexts[f].update(fragments[f]);
+      crc::Context outOfOrder(crcSize);
+      for (const crc::Context &context : contexts)
+        outOfOrder.combine(context);
+      EXPECT_EQ(outOfOrder.checksum(), inOrder.checksum()) << "length " << length;
+      EXPECT_TRUE(outOfOrder.matches(trailer)) << "length " << length;
+
+      payload[generator() % length] ^= 0x10;
+      crc::Context bad(crcSize);
+      bad.update(payload.data(), payload.size());
+      EXPECT_FALSE(bad.matches(trailer)) << "length " << length;
+    }
+  }
+
+  crc::Context c16(crc::CRC_16_BITS);
+  EXPECT_THROW(c16.combine(crc::Context(crc::CRC_32_BITS)), std::runtime_error);
+}
+
+/*!
+ * @brief Verify good, corrupted, short frames and a bad CRC size without
+ * exceptions.
+ */
+TEST(crc, Verify )
+{
+  mt19937 generator(2021);
+  crc c;
+
+  for (crc::crc_size_t crcSize : { crc::CRC_16_BITS, crc::CRC_32_BITS }) {
+    PPDU_u8::payload_t payload(129);
+    for (uint8_t &b : payload)
+      b = generator();
+    PPDU_u8 pdu(payload);
+    c.add(pdu, crcSize);
+    PPDU_u8::payload_t frame = pdu.getPayload();
+    uint32_t expected = crcSize == crc::CRC_16_BITS ?
+      CRC16ARC::compute(payload.data(), payload.size()) :
+      CRC32::compute(payload.data(), payload.size());
+
+    crc::crc_result_t result = crc::verify(frame.data(), frame.size(), crcSize);
+    EXPECT_EQ(result.status, crc::CRC_PASS);
+    EXPECT_EQ(result.computed, expected);
+    EXPECT_EQ(result.received, expected);
+
+    frame[5] ^= 0x01;
+    result = crc::verify(frame.data(), frame.size(), crcSize);
+    EXPECT_EQ(result.status, crc::CRC_FAIL);
+    EXPECT_NE(result.computed, expected);
+    EXPECT_EQ(result.received, expected);
+
+    result = crc::verify(frame.data(), crcSize / 8 - 1, crcSize);
+    EXPECT_EQ(result.status, crc::CRC_TOO_SHORT);
+
+    PPDU_u8 shortPDU(PPDU_u8::payload_t(crcSize / 8 - 1, 0));
+    EXPECT_THROW(c.check(shortPDU, crcSize), std::runtime_error);
+  }
+
+  uint8_t data[8] = { 0 };
+  crc::crc_result_t result = crc::verify(data, sizeof(data), static_cast<crc::crc_size_t>(8));
+  EXPECT_EQ(result.status, crc::CRC_BAD_SIZE);
+}
@@ -32,7 +32,7 @@ using namespace std;
  */
 uint64_t factorial(uint16_t n) {
   uint64_t f = 1;
-  for (uint16_t i = 0; i < n; i++) {
+  for (uint16_t i = 2; i <= n; i++) {
     f *= i;
   }
   return f;
@@ -47,18 +47,17 @@ uint64_t combination (uint16_t k, uint16_t n) {
 /*!
  * @brief Generate an error pattern of n bits for a 24 bit word.
  *
- *
- * @param n
- * @return
+ * @param n The number of bits in error
+ * @param generator The source of the bit positions
+ * @return The error pattern
  */
-
-uint32_t nBitErrorPattern(uint8_t n) {
+uint32_t nBitErrorPattern(uint8_t n, mt19937 &generator) {
   uint32_t pattern = 0;
 
   vector<uint8_t> positions(24,0);
   uint8_t count = 0;
   while (count < n) {
-    uint8_t bitPosition = random() % (24);
+    uint8_t bitPosition = generator() % (24);
     if (positions[bitPosition] == 0) {
       positions[bitPosition] = 1;
       uint32_t bitPattern = (0x00000001 << bitPosition) & 0x00ffffff;
@@ -79,29 +78,24 @@ TEST(golay, CheckManyCorrectableErrors )
    * Confirm Golay codec corrects 1, 2, and 3 errors
    * ---------------------------------------------------------------------
    */
-  srandom(time(NULL));
+  mt19937 generator(2021);
   /*
    * data = 12 information bits, an information polynomial i(x)
    */
   for (uint8_t numBitErrors = 1; numBitErrors <= 3; numBitErrors++) {
     for (uint16_t nt = 0; nt < numTrials; nt++) {
       // Golay encodes 12 bits
-      uint16_t data = random() & 0x0fff;
+      uint16_t data = generator() & 0x0fff;
       uint32_t codeword = golay_encode(data);
       // Generate the bit error pattern
-      uint32_t pattern = nBitErrorPattern(numBitErrors);
+      uint32_t pattern = nBitErrorPattern(numBitErrors, generator);
       // Apply the bit error tothe codeword to get received codeword
       uint32_t recd = codeword ^ pattern;
       // Decode
       int16_t decoded = golay_decode(recd);
-      printf("data     0x%08x\n", data);
-      printf("codeword 0x%08x\n", codeword);
-      printf("pattern  0x%08x\n", pattern);
-      printf("recd     0x%08x\n", recd);
-      printf("decode 0x%08x\n", decoded);
-      printf("-------------------\n");
       // Check decoded is same as data
-      ASSERT_TRUE(data == decoded) << "Oops, Golay failed!";
+      ASSERT_TRUE(data == decoded) << "Oops, Golay failed! data " << data
+        << " pattern " << pattern;
     } // num trials
   } // 1, 2, and 3 bits in error
 }
@@ -116,24 +110,175 @@ TEST(golay, CheckManyUncorrectableErrors )
    * Confirm Golay codec corrects 1, 2, and 3 errors
    * ---------------------------------------------------------------------
    */
-  srandom(time(NULL));
+  mt19937 generator(2021);
   /*
    * data = 12 information bits, an information polynomial i(x)
    */
   for (uint8_t numBitErrors = 4; numBitErrors <= 10; numBitErrors++) {
     for (uint16_t nt = 0; nt < numTrials; nt++) {
       // Golay encodes 12 bits
-      uint16_t data = random() & 0x00000fff;
+      uint16_t data = generator() & 0x00000fff;
       uint32_t codeword = golay_encode(data);
       // Generate the bit error pattern
-      uint32_t pattern = nBitErrorPattern(numBitErrors);
+      uint32_t pattern = nBitErrorPattern(numBitErrors, generator);
       // Apply the bit error tothe codeword to get received codeword
       uint32_t recd = codeword ^ pattern;
-      printf("pattern 0x%08x codeword 0x%08x recd 0x%08x\n", pattern, codeword, recd);
       // Decode
       int16_t decoded = golay_decode(recd);
       // Check decoded is same as data
-      ASSERT_TRUE(data != decoded) << "Oops, Golay succeeded correcting too many errors!";
+      ASSERT_TRUE(data != decoded) << "Oops, Golay succeeded correcting too many errors! data "
+        << data << " pattern " << pattern;
     } // num trials
   } // 1, 2, and 3 bits in error
 }
+
+/*!
+ * @brief Test that every error pattern of 3 or fewer bits is found, and
+ * that every pattern of 4 bits is detected, for a few data words.
+ */
+TEST(golay, AllErrorPatternsOfFourOrFewerBits )
+{
+  const uint16_t words[] = { 0x000, 0xfff, 0xa5c, 0x123 };
+  for (uint16_t data : words) {
+    uint32_t codeword = golay_encode(data);
+    ASSERT_EQ(golay_errors(codeword), 0) << "data " << data;
+    for (uint32_t a = 0; a < 24; a++) {
+      for (uint32_t b = a; b < 24; b++) {
+        for (uint32_t c = b; c < 24; c++) {
+          // a == b or b == c gives the patterns of fewer bits
+          uint32_t pattern = (1u << a) ^ (1u << b) ^ (1u << c);
+          ASSERT_EQ(golay_errors(codeword ^ pattern), (int32_t) pattern)
+            << "data " << data << " pattern " << pattern;
+          ASSERT_EQ(golay_decode(codeword ^ pattern), (int16_t) data)
+            << "data " << data << " pattern " << pattern;
+          for (uint32_t d = c + 1; d < 24; d++) {
+            if (a == b || b == c)
+              continue;
+            pattern = (1u << a) | (1u << b) | (1u << c) | (1u << d);
+            ASSERT_EQ(golay_decode(codeword ^ pattern), -1)
+              << "data " << data << " pattern " << pattern;
+          }
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * @brief Test that the bulk encoder and decoder agree with the one word
+ * functions, for lengths that use the SIMD code, the scalar code, or both.
+ */
+TEST(golay, BulkMatchesOneWord )
+{
+  mt19937 generator(2021);
+
+  for (uint32_t numWords = 0; numWords < 100; numWords++) {
+    // Pack random words two to three bytes
+    vector<uint16_t> words(numWords);
+    vector<uint8_t> data((3 * numWords + 1) / 2, 0);
+    for (uint32_t i = 0; i < numWords; i++) {
+      words[i] = generator() & 0x0fff;
+      uint8_t *d = &data[3 * (i / 2)];
+      if (i & 1) {
+        d[1] |= words[i] >> 8;
+        d[2] = words[i] & 0xff;
+      }
+      else {
+        d[0] = words[i] >> 4;
+        d[1] = (words[i] & 0x0f) << 4;
+      }
+    }
+
+    vector<uint8_t> codewords(3 * numWords);
+    golay_encode_bulk(data.data(), numWords, codewords.data());
+
+    // Up to 5 errors per codeword
+    uint32_t uncorrectable = 0;
+    vector<uint8_t> expected((3 * numWords + 1) / 2, 0);
+    for (uint32_t i = 0; i < numWords; i++) {
+      uint32_t codeword = (codewords[3 * i] << 16) | (codewords[3 * i + 1] << 8) | codewords[3 * i + 2];
+      ASSERT_EQ(codeword, golay_encode(words[i])) << numWords << " words, word " << i;
+
+      uint32_t recd = codeword ^ nBitErrorPattern(generator() % 6, generator);
+      codewords[3 * i] = recd >> 16;
+      codewords[3 * i + 1] = recd >> 8;
+      codewords[3 * i + 2] = recd;
+
+      int16_t decoded = golay_decode(recd);
+      if (decoded < 0) {
+        uncorrectable++;
+        decoded = recd & 0x0fff;
+      }
+      uint8_t *d = &expected[3 * (i / 2)];
+      if (i & 1) {
+        d[1] |= decoded >> 8;
+        d[2] = decoded & 0xff;
+      }
+      else {
+        d[0] = decoded >> 4;
+        d[1] = (decoded & 0x0f) << 4;
+      }
+    }
+
+    vector<uint8_t> decoded(expected.size(), 0x5a);
+    EXPECT_EQ(golay_decode_bulk(codewords.data(), numWords, decoded.data()), uncorrectable)
+      << numWords << " words";
+    EXPECT_EQ(decoded, expected) << numWords << " words";
+  }
+}
+
+/*!
+ * @brief Test the soft decoder on noiseless samples, on samples with more
+ * errors than the hard decoder can correct, and against a brute force
+ * maximum likelihood search on noisy samples.
+ */
+TEST(golay, SoftDecodeCorrectsBeyondHard )
+{
+  mt19937 generator(2021);
+  normal_distribution<float> noise(0.0f, 0.8f);
+  float samples[24];
+
+  for (uint32_t trial = 0; trial < 1000; trial++) {
+    uint16_t data = generator() & 0x0fff;
+    uint32_t codeword = golay_encode(data);
+    for (uint32_t i = 0; i < 24; i++) {
+      samples[23 - i] = ((codeword >> i) & 1) ? 1.0f : -1.0f;
+    }
+    ASSERT_EQ(golay_decode_soft(samples), data) << "data " << data;
+
+    // Any other codeword differs in at least 8 bits, so up to 6 weak errors
+    // still leave the transmitted codeword the most likely
+    uint32_t pattern = nBitErrorPattern(4 + trial % 3, generator);
+    for (uint32_t i = 0; i < 24; i++) {
+      if ((pattern >> i) & 1) {
+        samples[23 - i] *= -0.2f;
+      }
+    }
+    // The hard decoder detects 4 errors and miscorrects more
+    ASSERT_NE(golay_decode(codeword ^ pattern), (int16_t) data) << "data " << data;
+    ASSERT_EQ(golay_decode_soft(samples), data)
+      << "data " << data << " pattern " << pattern;
+  }
+
+  for (uint32_t trial = 0; trial < 200; trial++) {
+    uint32_t codeword = golay_encode(generator() & 0x0fff);
+    for (uint32_t i = 0; i < 24; i++) {
+      samples[23 - i] = (((codeword >> i) & 1) ? 1.0f : -1.0f) + noise(generator);
+    }
+
+    float best = 0.0f;
+    uint16_t bestData = 0;
+    for (uint32_t w = 0; w < 4096; w++) {
+      uint32_t c = golay_encode(w);
+      float metric = 0.0f;
+      for (uint32_t i = 0; i < 24; i++) {
+        metric += ((c >> i) & 1) ? samples[23 - i] : -samples[23 - i];
+      }
+      if (w == 0 || metric > best) {
+        best = metric;
+        bestData = w;
+      }
+    }
+    EXPECT_EQ(golay_decode_soft(samples), bestData) << "trial " << trial;
+  }
+}
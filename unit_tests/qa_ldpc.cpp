@@ -0,0 +1,1116 @@
+/*!
+ * @file qa_ldpc.cpp
+ * @author Steven Knudsen
+ * @date June 14, 2021
+ *
+ * @details Unit test for the LDPC encoders, decoder workspace and soft output.
+ *
+ * This unit test checks that once a decoder workspace has been used, decoding
+ * with it does no heap allocation, for every decode algorithm, and that the
+ * a-posteriori LLRs returned by decodeSoft agree with the hard decisions. It
+ * also checks the packed quasi-cyclic encoder against encodeSparse and the
+ * built in prototype matrices against the prototype matrix files, that
+ * LDPC objects share their code, the CCSDS AR4JA codes end to end, and the
+ * decode time budget.
+ *
+ * @copyright AlbertaSat 2021
+ *
+ * @license
+ * This software may not be modified or distributed in any form, except as described in the LICENSE file.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ldpc.h"
+#include "ldpc_kernel.h"
+#include "parity_check.h"
+
+using namespace std;
+using namespace ex2::sdr;
+
+#include "gtest/gtest.h"
+
+/*
+ * Allocation counting test hook. With glibc, malloc and friends are
+ * interposed so that allocations made by Eigen are counted as well as those
+ * made through operator new; elsewhere only operator new is counted.
+ */
+static atomic<uint64_t> g_allocations(0);
+
+#if defined(__GLIBC__)
+extern "C" {
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t count, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+  void *__libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void *ptr);
+
+  void *malloc(size_t size) {
+    g_allocations++;
+    return __libc_malloc(size);
+  }
+  void *calloc(size_t count, size_t size) {
+    g_allocations++;
+    return __libc_calloc(count, size);
+  }
+  void *realloc(void *ptr, size_t size) {
+    g_allocations++;
+    return __libc_realloc(ptr, size);
+  }
+  void *memalign(size_t alignment, size_t size) {
+    g_allocations++;
+    return __libc_memalign(alignment, size);
+  }
+  void *aligned_alloc(size_t alignment, size_t size) {
+    g_allocations++;
+    return __libc_memalign(alignment, size);
+  }
+  int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    g_allocations++;
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+  }
+  void free(void *ptr) {
+    __libc_free(ptr);
+  }
+}
+#else
+void *operator new(size_t size) {
+  g_allocations++;
+  void *ptr = std::malloc(size ? size : 1);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+#endif
+
+/*!
+ * @brief Encode random messages and pass them through an AWGN channel.
+ *
+ * @param[in] ldpc The codec
+ * @param[in] numCodewords The number of codewords
+ * @param[in] ebn0dB The Eb/N0 in dB
+ * @param[out] snrEstimate The SNR to give the decoder
+ * @param[out] sent If not null, the messages that were encoded
+ * @return The received samples
+ */
+PPDU_f::payload_t noisyCodewords(LDPC &ldpc, uint32_t numCodewords, float ebn0dB,
+  float &snrEstimate, PPDU_u8::payload_t *sent = nullptr)
+{
+  mt19937 generator(1234);
+  uint32_t k = ldpc.getMessageLength();
+  uint32_t n = ldpc.getCodewordLength();
+
+  PPDU_u8::payload_t messages(numCodewords * k);
+  for (uint32_t i = 0; i < messages.size(); i++)
+    messages[i] = generator() & 0x01;
+  if (sent)
+    *sent = messages;
+  PPDU_u8 messagePPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+  PPDU_u8::payload_t codewords = ldpc.encodeSparse(messagePPDU).getPayload();
+
+  double sigma2 = 1.0 / (2.0 * pow(10.0, ebn0dB / 10.0) * k / n);
+  snrEstimate = 10.0 * log10(1.0 / sigma2);
+  normal_distribution<float> noise(0.0f, sqrt(sigma2));
+  PPDU_f::payload_t received(codewords.size());
+  for (uint32_t i = 0; i < codewords.size(); i++)
+    received[i] = (codewords[i] ? 1.0f : -1.0f) + noise(generator);
+  return received;
+}
+
+const LDPC::DecodeAlgorithm algorithms[] = {
+  LDPC::DecodeAlgorithm::PROBABILITY_DOMAIN_BP,
+  LDPC::DecodeAlgorithm::NORMALIZED_MIN_SUM,
+  LDPC::DecodeAlgorithm::OFFSET_MIN_SUM,
+  LDPC::DecodeAlgorithm::NORMALIZED_MIN_SUM,
+  LDPC::DecodeAlgorithm::OFFSET_MIN_SUM,
+  LDPC::DecodeAlgorithm::FIXED_POINT_MIN_SUM,
+  LDPC::DecodeAlgorithm::INTERLEAVED_MIN_SUM
+};
+const LDPC::DecodeSchedule schedules[] = {
+  LDPC::DecodeSchedule::FLOODING,
+  LDPC::DecodeSchedule::FLOODING,
+  LDPC::DecodeSchedule::FLOODING,
+  LDPC::DecodeSchedule::LAYERED,
+  LDPC::DecodeSchedule::LAYERED,
+  LDPC::DecodeSchedule::LAYERED,
+  LDPC::DecodeSchedule::LAYERED
+};
+
+/*!
+ * @brief Test that a prepared workspace makes decoding allocation free.
+ */
+TEST(ldpc, DecodeWorkspaceNoAllocation)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_1_2);
+  float snrEstimate;
+  PPDU_f::payload_t received = noisyCodewords(ldpc, 4, 2.5f, snrEstimate);
+
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    ldpc.setDecodeAlgorithm(algorithms[a]);
+    ldpc.setDecodeSchedule(schedules[a]);
+
+    LDPC::DecoderWorkspace workspace(ldpc);
+    PPDU_u8::payload_t first;
+    PPDU_u8::payload_t second;
+    ldpc.decode(received, snrEstimate, first, workspace);
+    second.reserve(first.size());
+
+    g_allocations = 0;
+    ldpc.decode(received, snrEstimate, second, workspace);
+    uint64_t allocations = g_allocations;
+
+    EXPECT_EQ(allocations, 0u) << "algorithm " << a;
+    EXPECT_EQ(first, second) << "algorithm " << a;
+  }
+}
+
+/*!
+ * @brief Test that decode and decodeBatch without a workspace stop
+ * allocating once the LDPC object's own workspace has been used.
+ */
+TEST(ldpc, DecodeOwnWorkspaceNoAllocation)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  ldpc.setDecodeAlgorithm(LDPC::DecodeAlgorithm::INTERLEAVED_MIN_SUM);
+  float snrEstimate;
+  PPDU_f::payload_t received = noisyCodewords(ldpc, 40, 3.0f, snrEstimate);
+  uint32_t n = ldpc.getCodewordLength();
+
+  PPDU_u8::payload_t decoded;
+  ldpc.decode(received, snrEstimate, decoded);
+  g_allocations = 0;
+  ldpc.decode(received, snrEstimate, decoded);
+  EXPECT_EQ(g_allocations, 0u);
+
+  // One codeword per payload
+  vector<PPDU_f::payload_t> receivedPayloads(received.size() / n);
+  vector<PPDU_u8::payload_t> decodedPayloads(receivedPayloads.size());
+  for (uint32_t p = 0; p < receivedPayloads.size(); p++)
+    receivedPayloads[p].assign(received.begin() + p * n, received.begin() + (p + 1) * n);
+
+  ldpc.decodeBatch(receivedPayloads.data(), receivedPayloads.size(), snrEstimate,
+    decodedPayloads.data());
+  g_allocations = 0;
+  ldpc.decodeBatch(receivedPayloads.data(), receivedPayloads.size(), snrEstimate,
+    decodedPayloads.data());
+  EXPECT_EQ(g_allocations, 0u);
+
+  PPDU_u8::payload_t batchDecoded;
+  for (uint32_t p = 0; p < decodedPayloads.size(); p++)
+    batchDecoded.insert(batchDecoded.end(), decodedPayloads[p].begin(), decodedPayloads[p].end());
+  EXPECT_EQ(decoded, batchDecoded);
+}
+
+/*!
+ * @brief Test that decodeBatch sizes the workspace for the algorithm it
+ * uses, when it is the first decode of an LDPC object and after switching
+ * algorithms, and gives the same messages as decode.
+ */
+TEST(ldpc, DecodeBatchSizesWorkspace)
+{
+  const ErrorCorrection::ErrorCorrectionScheme scheme =
+      ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2;
+  LDPC reference(false, scheme);
+  float snrEstimate;
+  // More than one interleaved group, and part of another
+  PPDU_f::payload_t received = noisyCodewords(reference, 37, 2.0f, snrEstimate);
+  uint32_t n = reference.getCodewordLength();
+
+  // Two payloads of different lengths
+  uint32_t split = 13 * n;
+  PPDU_f::payload_t receivedPayloads[2] = {
+    PPDU_f::payload_t(received.begin(), received.begin() + split),
+    PPDU_f::payload_t(received.begin() + split, received.end())
+  };
+
+  LDPC switching(false, scheme);
+  LDPC::DecoderWorkspace workspace(switching);
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    reference.setDecodeAlgorithm(algorithms[a]);
+    reference.setDecodeSchedule(schedules[a]);
+    PPDU_u8::payload_t expected;
+    uint32_t expectedErrors = reference.decode(received, snrEstimate, expected);
+
+    LDPC fresh(false, scheme);
+    fresh.setDecodeAlgorithm(algorithms[a]);
+    fresh.setDecodeSchedule(schedules[a]);
+    switching.setDecodeAlgorithm(algorithms[a]);
+    switching.setDecodeSchedule(schedules[a]);
+
+    PPDU_u8::payload_t freshDecoded[2], switchedDecoded[2], workspaceDecoded[2];
+    EXPECT_EQ(fresh.decodeBatch(receivedPayloads, 2, snrEstimate, freshDecoded),
+        expectedErrors) << "algorithm " << a;
+    EXPECT_EQ(switching.decodeBatch(receivedPayloads, 2, snrEstimate, switchedDecoded),
+        expectedErrors) << "algorithm " << a;
+    // A workspace last sized for the previous algorithm
+    EXPECT_EQ(switching.decodeBatch(receivedPayloads, 2, snrEstimate, workspaceDecoded,
+        workspace), expectedErrors) << "algorithm " << a;
+
+    for (PPDU_u8::payload_t *decoded : { freshDecoded, switchedDecoded, workspaceDecoded }) {
+      PPDU_u8::payload_t joined(decoded[0]);
+      joined.insert(joined.end(), decoded[1].begin(), decoded[1].end());
+      EXPECT_EQ(joined, expected) << "algorithm " << a;
+    }
+  }
+}
+
+/*!
+ * @brief Test that one workspace can serve codes of different sizes without
+ * allocating again.
+ */
+TEST(ldpc, DecodeWorkspaceSharedByCodes)
+{
+  LDPC ldpcLong(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_1_2);
+  LDPC ldpcShort(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  ldpcLong.setDecodeAlgorithm(LDPC::DecodeAlgorithm::OFFSET_MIN_SUM);
+  ldpcShort.setDecodeAlgorithm(LDPC::DecodeAlgorithm::OFFSET_MIN_SUM);
+  ldpcLong.setDecodeSchedule(LDPC::DecodeSchedule::LAYERED);
+  ldpcShort.setDecodeSchedule(LDPC::DecodeSchedule::LAYERED);
+
+  float snrLong;
+  float snrShort;
+  PPDU_f::payload_t receivedLong = noisyCodewords(ldpcLong, 2, 3.0f, snrLong);
+  PPDU_f::payload_t receivedShort = noisyCodewords(ldpcShort, 6, 3.0f, snrShort);
+
+  LDPC::DecoderWorkspace workspace(ldpcLong);
+  PPDU_u8::payload_t decodedLong;
+  PPDU_u8::payload_t decodedShort;
+  ldpcLong.decode(receivedLong, snrLong, decodedLong, workspace);
+  decodedShort.reserve(6 * ldpcShort.getMessageLength());
+
+  g_allocations = 0;
+  ldpcShort.decode(receivedShort, snrShort, decodedShort, workspace);
+  ldpcLong.decode(receivedLong, snrLong, decodedLong, workspace);
+  EXPECT_EQ(g_allocations, 0u);
+}
+
+/*!
+ * @brief Test that decodeSoft gives the same hard decisions as decode, and
+ * a-posteriori LLRs that agree with them, for every decode algorithm.
+ */
+TEST(ldpc, DecodeSoftMatchesHardDecisions)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  float snrEstimate;
+  PPDU_f::payload_t received = noisyCodewords(ldpc, 5, 2.0f, snrEstimate);
+  uint32_t k = ldpc.getMessageLength();
+  uint32_t n = ldpc.getCodewordLength();
+
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    ldpc.setDecodeAlgorithm(algorithms[a]);
+    ldpc.setDecodeSchedule(schedules[a]);
+
+    PPDU_u8::payload_t hard;
+    PPDU_u8::payload_t soft;
+    vector<float> posteriorLLRs(received.size(), NAN);
+    uint32_t hardErrors = ldpc.decode(received, snrEstimate, hard);
+    uint32_t softErrors = ldpc.decodeSoft(received, snrEstimate, soft, posteriorLLRs.data());
+
+    EXPECT_EQ(hardErrors, softErrors) << "algorithm " << a;
+    EXPECT_EQ(hard, soft) << "algorithm " << a;
+
+    // Every LLR is written, and a nonzero message bit LLR has the sign of
+    // the decoded bit
+    for (uint32_t c = 0; c < received.size() / n; c++)
+      for (uint32_t i = 0; i < n; i++) {
+        float llr = posteriorLLRs[c * n + i];
+        ASSERT_FALSE(std::isnan(llr)) << "algorithm " << a << " bit " << i;
+        if (i < k && llr != 0.0f) {
+          EXPECT_EQ(soft[c * k + i], llr < 0.0f ? 1 : 0) << "algorithm " << a << " bit " << i;
+        }
+      }
+  }
+}
+
+/*!
+ * @brief Test that the packed quasi-cyclic encoder gives the same codewords
+ * as encodeSparse, and that they satisfy every parity check, for all codes.
+ */
+TEST(ldpc, EncodeQCMatchesEncodeSparse)
+{
+  mt19937 generator(4321);
+
+  for (uint32_t s = (uint32_t) ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2;
+      s <= (uint32_t) ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_5_6; s++) {
+    LDPC ldpc(false, (ErrorCorrection::ErrorCorrectionScheme) s);
+    uint32_t k = ldpc.getMessageLength();
+    uint32_t n = ldpc.getCodewordLength();
+
+    // Not a whole number of messages, so the last one is zero padded
+    PPDU_u8::payload_t messages(3 * k + 5);
+    for (uint32_t i = 0; i < messages.size(); i++)
+      messages[i] = generator() & 0x01;
+    PPDU_u8 sparsePPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    PPDU_u8 qcPPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+
+    PPDU_u8::payload_t sparse = ldpc.encodeSparse(sparsePPDU).getPayload();
+    PPDU_u8 qc = ldpc.encodeQC(qcPPDU);
+    EXPECT_EQ(qc.getBps(), PPDU_u8::BitsPerSymbol::BPSymb_8);
+    qc.repack(PPDU_u8::BitsPerSymbol::BPSymb_1);
+    PPDU_u8::payload_t codewords = qc.getPayload();
+
+    ASSERT_EQ(codewords.size(), sparse.size()) << "scheme " << s;
+    for (uint32_t i = 0; i < sparse.size(); i++)
+      sparse[i] &= 0x01;
+    EXPECT_EQ(codewords, sparse) << "scheme " << s;
+
+    Eigen::MatrixXi H = ldpc.getParityMatrix();
+    for (uint32_t c = 0; c < codewords.size() / n; c++) {
+      Eigen::VectorXi x(n);
+      for (uint32_t i = 0; i < n; i++)
+        x[i] = codewords[c * n + i];
+      Eigen::VectorXi syndrome = H * x;
+      for (uint32_t i = 0; i < syndrome.size(); i++)
+        ASSERT_EQ(syndrome[i] % 2, 0) << "scheme " << s << " codeword " << c;
+    }
+  }
+}
+
+/*!
+ * @brief Test that every instruction set's decoder kernels give the same
+ * messages, LLRs and syndromes as the generic ones, bit for bit, on random
+ * layers of random LLRs.
+ *
+ * The interleaved kernels of each instruction set are run on
+ * LDPC_KERNEL_LANE_ALIGN codewords, frameLanes at a time, so that kernels of
+ * different widths can be compared codeword by codeword.
+ */
+TEST(ldpc, KernelsMatchGeneric)
+{
+  const LDPCKernels &generic = ldpcKernelsGeneric();
+  vector<const LDPCKernels *> kernels;
+  for (const LDPCKernels *k : { ldpcKernelsSSE41(), ldpcKernelsAVX2(), ldpcKernelsNEON() })
+    if (k != nullptr)
+      kernels.push_back(k);
+
+  const uint32_t numBlockColumns = 24;
+  const uint32_t numCodewords = LDPC_KERNEL_LANE_ALIGN;
+  const uint32_t submatrixSizes[] = { 27, 54, 81, 32, 64, 128 };
+  mt19937 generator(97531);
+  uniform_int_distribution<int> llr(-128, 127);
+  uniform_int_distribution<int> message(-LDPC_KERNEL_MESSAGE_MAX, LDPC_KERNEL_MESSAGE_MAX);
+  uniform_int_distribution<int> offset(0, 4);
+
+  for (uint32_t Z : submatrixSizes) {
+    uint32_t laneStride = ldpcKernelLaneStride(Z);
+    uint32_t stride = ldpcKernelLaneStride(2 * Z + LDPC_KERNEL_LANE_ALIGN);
+
+    for (uint32_t trial = 0; trial < 20; trial++) {
+      // A layer of distinct block columns in increasing order, as in a code
+      vector<uint32_t> blockColumns(numBlockColumns);
+      for (uint32_t j = 0; j < numBlockColumns; j++)
+        blockColumns[j] = j;
+      shuffle(blockColumns.begin(), blockColumns.end(), generator);
+      uint32_t degree = 2 + generator() % (numBlockColumns - 1);
+      blockColumns.resize(degree);
+      sort(blockColumns.begin(), blockColumns.end());
+      vector<uint32_t> shifts(degree);
+      for (uint32_t c = 0; c < degree; c++)
+        shifts[c] = generator() % Z;
+      int8_t o = offset(generator);
+
+      // Codeword f's LLRs and messages, and whether it is active
+      vector<vector<int8_t>> llrs(numCodewords, vector<int8_t>(numBlockColumns * Z));
+      vector<vector<int8_t>> messages(numCodewords, vector<int8_t>(degree * Z));
+      vector<int8_t> active(numCodewords);
+      for (uint32_t f = 0; f < numCodewords; f++) {
+        for (int8_t &x : llrs[f])
+          x = llr(generator);
+        for (int8_t &x : messages[f])
+          x = message(generator);
+        active[f] = generator() & 1 ? -1 : 0;
+      }
+
+      // One codeword at a time, laid out as in ldpc_kernel.h
+      auto layer = [&](const LDPCKernels &k, uint32_t f, vector<int8_t> &outLLRs,
+          vector<int8_t> &outMessages, uint32_t &before, uint32_t &after) {
+        vector<int8_t> posterior(numBlockColumns * stride, 0);
+        vector<int8_t> m(degree * laneStride, 0);
+        vector<int8_t> scratch(degree * LDPC_KERNEL_LANE_ALIGN);
+        for (uint32_t j = 0; j < numBlockColumns; j++) {
+          memcpy(&posterior[j * stride], &llrs[f][j * Z], Z);
+          memcpy(&posterior[j * stride + Z], &llrs[f][j * Z], Z);
+        }
+        for (uint32_t c = 0; c < degree; c++)
+          memcpy(&m[c * laneStride], &messages[f][c * Z], Z);
+
+        before = k.layerSyndrome(blockColumns.data(), shifts.data(), degree, Z, stride,
+            posterior.data());
+        k.layerUpdate(blockColumns.data(), shifts.data(), degree, Z, stride, o,
+            posterior.data(), m.data(), scratch.data());
+        after = k.layerSyndrome(blockColumns.data(), shifts.data(), degree, Z, stride,
+            posterior.data());
+
+        // Both copies of each block column, and each circulant's messages
+        outLLRs.clear();
+        for (uint32_t j = 0; j < numBlockColumns; j++)
+          outLLRs.insert(outLLRs.end(), &posterior[j * stride], &posterior[j * stride + 2 * Z]);
+        outMessages.clear();
+        for (uint32_t c = 0; c < degree; c++)
+          outMessages.insert(outMessages.end(), &m[c * laneStride], &m[c * laneStride + Z]);
+      };
+
+      // All codewords, frameLanes at a time; the results are de-interleaved
+      auto interleaved = [&](const LDPCKernels &k, vector<vector<int8_t>> &outLLRs,
+          vector<vector<int8_t>> &outMessages, vector<uint32_t> &unsatisfied,
+          vector<bool> &failed) {
+        uint32_t W = k.frameLanes;
+        vector<int8_t> posterior(numBlockColumns * Z * W);
+        vector<int8_t> m(degree * Z * W);
+        vector<int8_t> scratch(degree * W);
+        vector<uint16_t> counts(W);
+        outLLRs.assign(numCodewords, vector<int8_t>(numBlockColumns * Z));
+        outMessages.assign(numCodewords, vector<int8_t>(degree * Z));
+        unsatisfied.assign(numCodewords, 0);
+        failed.assign(numCodewords, false);
+        for (uint32_t first = 0; first < numCodewords; first += W) {
+          for (uint32_t f = 0; f < W; f++) {
+            for (uint32_t i = 0; i < numBlockColumns * Z; i++)
+              posterior[i * W + f] = llrs[first + f][i];
+            for (uint32_t i = 0; i < degree * Z; i++)
+              m[i * W + f] = messages[first + f][i];
+          }
+          k.interleavedLayerUpdate(blockColumns.data(), shifts.data(), degree, Z, o,
+              &active[first], posterior.data(), m.data(), scratch.data());
+          fill(counts.begin(), counts.end(), 0);
+          uint32_t mask = k.interleavedLayerSyndrome(blockColumns.data(), shifts.data(),
+              degree, Z, posterior.data(), counts.data());
+          for (uint32_t f = 0; f < W; f++) {
+            for (uint32_t i = 0; i < numBlockColumns * Z; i++)
+              outLLRs[first + f][i] = posterior[i * W + f];
+            for (uint32_t i = 0; i < degree * Z; i++)
+              outMessages[first + f][i] = m[i * W + f];
+            unsatisfied[first + f] = counts[f];
+            failed[first + f] = (mask >> f) & 1;
+          }
+        }
+      };
+
+      vector<vector<int8_t>> genericLLRs(numCodewords), genericMessages(numCodewords);
+      vector<uint32_t> genericBefore(numCodewords), genericAfter(numCodewords);
+      for (uint32_t f = 0; f < numCodewords; f++)
+        layer(generic, f, genericLLRs[f], genericMessages[f], genericBefore[f], genericAfter[f]);
+      vector<vector<int8_t>> genericInterleavedLLRs, genericInterleavedMessages;
+      vector<uint32_t> genericUnsatisfied;
+      vector<bool> genericFailed;
+      interleaved(generic, genericInterleavedLLRs, genericInterleavedMessages,
+          genericUnsatisfied, genericFailed);
+
+      for (const LDPCKernels *k : kernels) {
+        for (uint32_t f = 0; f < numCodewords; f++) {
+          vector<int8_t> outLLRs, outMessages;
+          uint32_t before, after;
+          layer(*k, f, outLLRs, outMessages, before, after);
+          ASSERT_EQ(outLLRs, genericLLRs[f]) << k->name << " Z " << Z << " trial " << trial;
+          ASSERT_EQ(outMessages, genericMessages[f]) << k->name << " Z " << Z << " trial " << trial;
+          ASSERT_EQ(before, genericBefore[f]) << k->name << " Z " << Z << " trial " << trial;
+          ASSERT_EQ(after, genericAfter[f]) << k->name << " Z " << Z << " trial " << trial;
+        }
+
+        vector<vector<int8_t>> outLLRs, outMessages;
+        vector<uint32_t> unsatisfied;
+        vector<bool> failed;
+        interleaved(*k, outLLRs, outMessages, unsatisfied, failed);
+        ASSERT_EQ(outLLRs, genericInterleavedLLRs) << k->name << " Z " << Z << " trial " << trial;
+        ASSERT_EQ(outMessages, genericInterleavedMessages) << k->name << " Z " << Z << " trial " << trial;
+        ASSERT_EQ(unsatisfied, genericUnsatisfied) << k->name << " Z " << Z << " trial " << trial;
+        ASSERT_EQ(failed, genericFailed) << k->name << " Z " << Z << " trial " << trial;
+      }
+    }
+  }
+}
+
+#ifdef PROTO_H_DIR
+/*!
+ * @brief Test that the built in prototype matrices give the same parity
+ * check matrices as the prototype matrix files.
+ */
+TEST(ldpc, BuiltinPrototypeMatchesFiles)
+{
+  for (uint32_t s = (uint32_t) ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2;
+      s <= (uint32_t) ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1944_R_5_6; s++) {
+    ParityCheck builtin((ErrorCorrection::ErrorCorrectionScheme) s);
+    ParityCheck fromFile((ErrorCorrection::ErrorCorrectionScheme) s, PROTO_H_DIR);
+
+    ASSERT_TRUE(builtin.isValid()) << "scheme " << s;
+    ASSERT_TRUE(fromFile.isValid()) << "scheme " << s;
+    EXPECT_TRUE(builtin.parityCheckMatrix() == fromFile.parityCheckMatrix()) << "scheme " << s;
+  }
+}
+#endif
+
+/*!
+ * @brief Test that LDPC objects, in any thread, share one copy of each
+ * scheme's code.
+ */
+TEST(ldpc, CodeSharedBetweenObjects)
+{
+  const ErrorCorrection::ErrorCorrectionScheme scheme =
+      ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1296_R_2_3;
+
+  vector<shared_ptr<const LDPCCode> > codes(8);
+  vector<thread> threads;
+  for (uint32_t t = 0; t < codes.size(); t++)
+    threads.emplace_back([&codes, t, scheme]() { codes[t] = LDPCCode::get(scheme); });
+  for (thread &t : threads)
+    t.join();
+  for (uint32_t t = 1; t < codes.size(); t++)
+    EXPECT_EQ(codes[t], codes[0]);
+
+  LDPC first(false, scheme);
+  LDPC second(true, scheme);
+  EXPECT_EQ(&first.getParityMatrix(), &codes[0]->getParityMatrix());
+  EXPECT_EQ(&second.getParityMatrix(), &codes[0]->getParityMatrix());
+
+  LDPC other(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_1296_R_3_4);
+  EXPECT_NE(&other.getParityMatrix(), &codes[0]->getParityMatrix());
+}
+
+/*!
+ * @brief Test that a code saved to a file and loaded again encodes and
+ * decodes exactly like the built code, and that damaged files are refused.
+ */
+TEST(ldpc, CodeFileRoundTrip)
+{
+  const ErrorCorrection::ErrorCorrectionScheme scheme =
+      ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_3_4;
+  const string path = testing::TempDir() + LDPCCode::cacheFileName(scheme);
+
+  LDPC built(false, scheme);
+  LDPCCode::get(scheme)->save(path);
+  shared_ptr<const LDPCCode> code = LDPCCode::load(path);
+  ASSERT_EQ(code->getErrorCorrectionScheme(), scheme);
+  EXPECT_NE(code, LDPCCode::get(scheme));
+  LDPC loaded(code);
+  EXPECT_EQ(loaded.getMessageLength(), built.getMessageLength());
+  EXPECT_EQ(loaded.getCodewordLength(), built.getCodewordLength());
+  EXPECT_TRUE(loaded.getParityMatrix() == built.getParityMatrix());
+
+  mt19937 generator(2468);
+  PPDU_u8::payload_t messages(4 * built.getMessageLength());
+  for (uint32_t i = 0; i < messages.size(); i++)
+    messages[i] = generator() & 0x01;
+  PPDU_u8 builtPPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+  PPDU_u8 loadedPPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+  EXPECT_EQ(loaded.encode(loadedPPDU).getPayload(), built.encode(builtPPDU).getPayload());
+  EXPECT_EQ(loaded.encodeSparse(loadedPPDU).getPayload(), built.encodeSparse(builtPPDU).getPayload());
+
+  float snr;
+  PPDU_f::payload_t received = noisyCodewords(built, 8, 2.0f, snr);
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    built.setDecodeAlgorithm(algorithms[a]);
+    built.setDecodeSchedule(schedules[a]);
+    loaded.setDecodeAlgorithm(algorithms[a]);
+    loaded.setDecodeSchedule(schedules[a]);
+    PPDU_u8::payload_t builtDecoded, loadedDecoded;
+    EXPECT_EQ(loaded.decode(received, snr, loadedDecoded),
+        built.decode(received, snr, builtDecoded)) << "algorithm " << a;
+    EXPECT_EQ(loadedDecoded, builtDecoded) << "algorithm " << a;
+  }
+
+  // Damage a header field: maxLayerDegree, which sizes the decoders'
+  // buffers, is the seventh word after the magic
+  vector<char> image;
+  {
+    ifstream file(path, ios::binary);
+    image.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+  }
+  auto writeImage = [&](const vector<char> &words) {
+    ofstream file(path, ios::binary | ios::trunc);
+    file.write(words.data(), words.size());
+  };
+  {
+    vector<char> damaged(image);
+    uint32_t maxLayerDegree = 1;
+    memcpy(&damaged[32], &maxLayerDegree, sizeof(maxLayerDegree));
+    writeImage(damaged);
+  }
+  EXPECT_THROW(LDPCCode::load(path), runtime_error);
+
+  // A file with the checksum made to match is still rejected if a header
+  // field or a decoder table does not fit the code. The checksum is FNV-1a
+  // over the header's words, with the checksum word (at byte 48) zero, and
+  // then the tables'.
+  auto checksummed = [](vector<char> words) {
+    uint32_t hash = 2166136261u;
+    for (size_t b = 0; b < words.size(); b += sizeof(uint32_t)) {
+      uint32_t w = 0;
+      if (b != 48)
+        memcpy(&w, &words[b], sizeof(w));
+      hash = (hash ^ w) * 16777619u;
+    }
+    memcpy(&words[48], &hash, sizeof(hash));
+    return words;
+  };
+  writeImage(checksummed(image));
+  EXPECT_NO_THROW(LDPCCode::load(path));
+  const size_t headerFields[] = { 24, 28, 32, 36, 40, 44 };
+  for (size_t offset : headerFields) {
+    vector<char> damaged(image);
+    damaged[offset] ^= 0x01;
+    writeImage(checksummed(damaged));
+    EXPECT_THROW(LDPCCode::load(path), runtime_error) << "header byte " << offset;
+  }
+  {
+    // The second entry of the layer start table, the first table
+    vector<char> damaged(image);
+    damaged[128 + sizeof(uint32_t)] ^= 0x40;
+    writeImage(checksummed(damaged));
+    EXPECT_THROW(LDPCCode::load(path), runtime_error);
+  }
+  writeImage(image);
+
+  // Flip a bit in the last table
+  {
+    fstream file(path, ios::in | ios::out | ios::binary);
+    file.seekg(-1, ios::end);
+    char c = file.get() ^ 0x01;
+    file.seekp(-1, ios::end);
+    file.put(c);
+  }
+  EXPECT_THROW(LDPCCode::load(path), runtime_error);
+
+  {
+    ofstream file(path, ios::binary | ios::trunc);
+    file << "EX2LDPC";
+  }
+  EXPECT_THROW(LDPCCode::load(path), runtime_error);
+
+  remove(path.c_str());
+  EXPECT_THROW(LDPCCode::load(path), runtime_error);
+}
+
+/*!
+ * @brief Test that shortened and punctured messages of any length are sent
+ * without padding and decode correctly with every algorithm.
+ */
+TEST(ldpc, EncodeDecodeShortened)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  uint32_t k = ldpc.getMessageLength();
+  uint32_t n = ldpc.getCodewordLength();
+
+  // A short packet costs its own bits plus parity, not a whole codeword
+  LDPC::RateMatching single = ldpc.rateMatching(100);
+  EXPECT_EQ(single.numCodewords, 1u);
+  EXPECT_EQ(single.shortenedBits, k - 100);
+  EXPECT_EQ(single.transmittedBits, 100 + n - k);
+  EXPECT_THROW(ldpc.rateMatching(0), exception);
+  EXPECT_THROW(ldpc.rateMatching(100, n - k), exception);
+
+  mt19937 generator(1357);
+  const uint32_t messageBits = 2 * k + 37;
+  const uint32_t puncturedBits = 30;
+  PPDU_u8::payload_t message(messageBits);
+  for (uint32_t i = 0; i < messageBits; i++)
+    message[i] = generator() & 0x01;
+
+  LDPC::RateMatching layout = ldpc.rateMatching(messageBits, puncturedBits);
+  EXPECT_EQ(layout.numCodewords, 3u);
+  EXPECT_EQ(layout.transmittedBits, 3 * n - (k - 37) - puncturedBits);
+  uint32_t shortened = 0, punctured = 0;
+  for (uint32_t c = 0; c < layout.numCodewords; c++) {
+    shortened += layout.shortened(c);
+    punctured += layout.punctured(c);
+  }
+  EXPECT_EQ(shortened, layout.shortenedBits);
+  EXPECT_EQ(punctured, layout.puncturedBits);
+
+  // The transmitted bits are those of the full codewords, in order
+  PPDU_u8 messagePPDU(message, PPDU_u8::BitsPerSymbol::BPSymb_1);
+  PPDU_u8::payload_t transmitted = ldpc.encodeShortened(messagePPDU, puncturedBits).getPayload();
+  ASSERT_EQ(transmitted.size(), layout.transmittedBits);
+  {
+    PPDU_u8::payload_t padded;
+    uint32_t m = 0;
+    for (uint32_t c = 0; c < layout.numCodewords; c++) {
+      padded.insert(padded.end(), message.begin() + m, message.begin() + m + k - layout.shortened(c));
+      padded.resize((c + 1) * k, 0);
+      m += k - layout.shortened(c);
+    }
+    PPDU_u8 paddedPPDU(padded, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    PPDU_u8::payload_t codewords = ldpc.encodeSparse(paddedPPDU).getPayload();
+    uint32_t t = 0;
+    for (uint32_t c = 0; c < layout.numCodewords; c++)
+      for (uint32_t i = 0; i < n; i++)
+        if (i < k - layout.shortened(c) || (i >= k && i < n - layout.punctured(c))) {
+          ASSERT_EQ(transmitted[t++], codewords[c * n + i] & 0x01) << "codeword " << c << " bit " << i;
+        }
+  }
+
+  float ebn0dB = 4.0f;
+  double sigma2 = 1.0 / (2.0 * pow(10.0, ebn0dB / 10.0) * k / n);
+  float snr = 10.0 * log10(1.0 / sigma2);
+  normal_distribution<float> noise(0.0f, sqrt(sigma2));
+  PPDU_f::payload_t received(transmitted.size());
+  for (uint32_t i = 0; i < transmitted.size(); i++)
+    received[i] = (transmitted[i] ? 1.0f : -1.0f) + noise(generator);
+
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    ldpc.setDecodeAlgorithm(algorithms[a]);
+    ldpc.setDecodeSchedule(schedules[a]);
+    PPDU_u8::payload_t decoded;
+    EXPECT_EQ(ldpc.decodeShortened(received, snr, messageBits, puncturedBits, decoded), 0u)
+        << "algorithm " << a;
+    EXPECT_EQ(decoded, message) << "algorithm " << a;
+  }
+
+  PPDU_f::payload_t tooShort(received.begin(), received.end() - 1);
+  PPDU_u8::payload_t decoded;
+  EXPECT_THROW(ldpc.decodeShortened(tooShort, snr, messageBits, puncturedBits, decoded), exception);
+}
+
+/*!
+ * @brief Test that the CCSDS AR4JA codes encode to codewords that satisfy
+ * every parity check, are sent without their punctured symbols, decode, and
+ * survive a code file round trip.
+ */
+TEST(ldpc, AR4JAEncodeDecode)
+{
+  const LDPC::DecodeAlgorithm fastAlgorithms[] = {
+    LDPC::DecodeAlgorithm::OFFSET_MIN_SUM,
+    LDPC::DecodeAlgorithm::FIXED_POINT_MIN_SUM,
+    LDPC::DecodeAlgorithm::INTERLEAVED_MIN_SUM
+  };
+  mt19937 generator(97531);
+
+  for (uint32_t s = (uint32_t) ErrorCorrection::ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_1280;
+      s <= (uint32_t) ErrorCorrection::ErrorCorrectionScheme::CCSDS_LDPC_ORANGE_BOOK_2048; s++) {
+    ErrorCorrection::ErrorCorrectionScheme scheme = (ErrorCorrection::ErrorCorrectionScheme) s;
+    ErrorCorrection ec(scheme);
+    LDPC ldpc(false, scheme);
+    uint32_t k = ldpc.getMessageLength();
+    uint32_t n = ldpc.getCodewordLength();
+    uint32_t punctured = LDPCCode::get(scheme)->getPuncturedLength();
+    EXPECT_EQ(k, 1024u) << "scheme " << s;
+    // M punctured symbols, and 3M parity checks
+    EXPECT_EQ(3 * punctured, n - k) << "scheme " << s;
+    EXPECT_EQ(n - punctured, ec.getCodewordLen()) << "scheme " << s;
+
+    PPDU_u8::payload_t messages(2 * k);
+    for (uint32_t i = 0; i < messages.size(); i++)
+      messages[i] = generator() & 0x01;
+    PPDU_u8 messagePPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    PPDU_u8::payload_t codewords = ldpc.encode(messagePPDU).getPayload();
+    ASSERT_EQ(codewords.size(), 2 * n) << "scheme " << s;
+
+    PPDU_u8 qcPPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    PPDU_u8 qc = ldpc.encodeQC(qcPPDU);
+    qc.repack(PPDU_u8::BitsPerSymbol::BPSymb_1);
+    EXPECT_EQ(qc.getPayload(), codewords) << "scheme " << s;
+
+    Eigen::MatrixXi H = ldpc.getParityMatrix();
+    ASSERT_EQ(H.cols(), n);
+    for (uint32_t c = 0; c < 2; c++) {
+      Eigen::VectorXi x(n);
+      for (uint32_t i = 0; i < n; i++)
+        x[i] = codewords[c * n + i];
+      // Systematic
+      for (uint32_t i = 0; i < k; i++)
+        ASSERT_EQ(x[i], messages[c * k + i]) << "scheme " << s << " codeword " << c;
+      Eigen::VectorXi syndrome = H * x;
+      for (uint32_t i = 0; i < syndrome.size(); i++)
+        ASSERT_EQ(syndrome[i] % 2, 0) << "scheme " << s << " codeword " << c;
+    }
+
+    // Only the first n - M symbols of each codeword go over the air
+    PPDU_u8::payload_t transmitted = ldpc.encodeShortened(messagePPDU).getPayload();
+    ASSERT_EQ(transmitted.size(), 2 * ec.getCodewordLen()) << "scheme " << s;
+    for (uint32_t c = 0; c < 2; c++)
+      for (uint32_t i = 0; i < ec.getCodewordLen(); i++)
+        ASSERT_EQ(transmitted[c * ec.getCodewordLen() + i], codewords[c * n + i])
+            << "scheme " << s << " codeword " << c << " bit " << i;
+
+    float ebn0dB = 4.0f;
+    double sigma2 = 1.0 / (2.0 * pow(10.0, ebn0dB / 10.0) * ec.getRate());
+    float snr = 10.0 * log10(1.0 / sigma2);
+    normal_distribution<float> noise(0.0f, sqrt(sigma2));
+    PPDU_f::payload_t received(transmitted.size());
+    for (uint32_t i = 0; i < transmitted.size(); i++)
+      received[i] = (transmitted[i] ? 1.0f : -1.0f) + noise(generator);
+
+    ldpc.setDecodeSchedule(LDPC::DecodeSchedule::LAYERED);
+    for (uint32_t a = 0; a < sizeof(fastAlgorithms) / sizeof(fastAlgorithms[0]); a++) {
+      ldpc.setDecodeAlgorithm(fastAlgorithms[a]);
+      PPDU_u8::payload_t decoded;
+      EXPECT_EQ(ldpc.decodeShortened(received, snr, messages.size(), 0, decoded), 0u)
+          << "scheme " << s << " algorithm " << a;
+      EXPECT_EQ(decoded, messages) << "scheme " << s << " algorithm " << a;
+    }
+
+    // The code file carries the generator instead of encoder matrices
+    const string path = testing::TempDir() + LDPCCode::cacheFileName(scheme);
+    LDPCCode::get(scheme)->save(path);
+    LDPC loaded(LDPCCode::load(path));
+    PPDU_u8 loadedPPDU(messages, PPDU_u8::BitsPerSymbol::BPSymb_1);
+    EXPECT_EQ(loaded.encode(loadedPPDU).getPayload(), codewords) << "scheme " << s;
+    remove(path.c_str());
+  }
+}
+
+/*!
+ * @brief Test that the decode time budget stops codewords that run out of
+ * time, and that without a budget nothing is stopped.
+ */
+TEST(ldpc, DecodeTimeBudget)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  const uint32_t numCodewords = 8;
+  float snrEstimate;
+  // Too noisy to decode, so every codeword wants all its iterations
+  PPDU_f::payload_t received = noisyCodewords(ldpc, numCodewords, -1.0f, snrEstimate);
+  uint32_t k = ldpc.getMessageLength();
+
+  ldpc.setDecodeIterations(0);
+  EXPECT_EQ(ldpc.getDecodeIterations(), (uint32_t) LDPC::DECODE_ITERATIONS_DEFAULT);
+  ldpc.setDecodeIterations(50);
+  ldpc.setStallIterations(0);
+  EXPECT_EQ(ldpc.getDecodeTimeBudget().count(), 0);
+
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    ldpc.setDecodeAlgorithm(algorithms[a]);
+    ldpc.setDecodeSchedule(schedules[a]);
+    PPDU_u8::payload_t decoded;
+
+    ldpc.setDecodeTimeBudget(chrono::microseconds(0));
+    ldpc.decode(received, snrEstimate, decoded);
+    EXPECT_EQ(ldpc.getExpiredCodewords(), 0u) << "algorithm " << a;
+    EXPECT_GT(ldpc.getAverageIterations(), 1.0) << "algorithm " << a;
+
+    // Each codeword gets its first iteration, and then the time is up
+    ldpc.setDecodeTimeBudget(chrono::microseconds(1));
+    EXPECT_EQ(ldpc.getDecodeTimeBudget().count(), 1);
+    ldpc.decode(received, snrEstimate, decoded);
+    EXPECT_EQ(decoded.size(), numCodewords * k) << "algorithm " << a;
+    EXPECT_GT(ldpc.getExpiredCodewords(), 0u) << "algorithm " << a;
+    EXPECT_EQ(ldpc.getAverageIterations(), 1.0) << "algorithm " << a;
+
+    ldpc.decodeParallel(received, snrEstimate, decoded);
+    EXPECT_EQ(decoded.size(), numCodewords * k) << "algorithm " << a;
+    EXPECT_GT(ldpc.getExpiredCodewords(), 0u) << "algorithm " << a;
+    EXPECT_EQ(ldpc.getAverageIterations(), 1.0) << "algorithm " << a;
+  }
+}
+
+/*!
+ * @brief Test that decodeParallel gives the same messages and error count as
+ * decode with every algorithm, whatever the number of threads, including
+ * more threads than blocks and more threads than codewords.
+ */
+TEST(ldpc, DecodeParallelMatchesDecode)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  // Two whole blocks and part of a third, noisy enough that some codewords
+  // fail
+  const uint32_t numCodewords = 2 * LDPC::DECODE_BLOCK_CODEWORDS + 5;
+  const uint32_t threadCounts[] = { 1, 2, 3, 4, 7, numCodewords + 3 };
+  float snrEstimate;
+  PPDU_f::payload_t received = noisyCodewords(ldpc, numCodewords, 1.0f, snrEstimate);
+
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    ldpc.setDecodeAlgorithm(algorithms[a]);
+    ldpc.setDecodeSchedule(schedules[a]);
+    PPDU_u8::payload_t expected;
+    uint32_t expectedErrors = ldpc.decode(received, snrEstimate, expected);
+
+    for (uint32_t threads : threadCounts) {
+      ldpc.setDecodeThreads(threads);
+      PPDU_u8::payload_t decoded;
+      EXPECT_EQ(ldpc.decodeParallel(received, snrEstimate, decoded), expectedErrors)
+          << "algorithm " << a << " threads " << threads;
+      EXPECT_EQ(decoded, expected) << "algorithm " << a << " threads " << threads;
+    }
+
+    // Fewer codewords than threads
+    PPDU_f::payload_t few(received.begin(), received.begin() + 3 * ldpc.getCodewordLength());
+    ldpc.setDecodeThreads(8);
+    PPDU_u8::payload_t fewExpected, fewDecoded;
+    EXPECT_EQ(ldpc.decodeParallel(few, snrEstimate, fewDecoded),
+        ldpc.decode(few, snrEstimate, fewExpected)) << "algorithm " << a;
+    EXPECT_EQ(fewDecoded, fewExpected) << "algorithm " << a;
+    ldpc.setDecodeThreads(0);
+  }
+}
+
+/*!
+ * @brief Test that a decode that stops improving gives up after the
+ * configured number of stalled iterations, with every algorithm.
+ *
+ * Decoding one codeword for 1, 2, ... iterations gives the number of
+ * unsatisfied check nodes after each iteration, from which the iteration the
+ * stall check stops at follows.
+ */
+TEST(ldpc, DecodeStallIterations)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  const uint32_t maxIterations = 40;
+  float snrEstimate;
+  // Too noisy to decode, so the count wanders instead of reaching zero
+  PPDU_f::payload_t received = noisyCodewords(ldpc, 1, -1.0f, snrEstimate);
+  PPDU_u8::payload_t decoded;
+
+  for (uint32_t a = 0; a < sizeof(algorithms) / sizeof(algorithms[0]); a++) {
+    ldpc.setDecodeAlgorithm(algorithms[a]);
+    ldpc.setDecodeSchedule(schedules[a]);
+    ldpc.setStallIterations(0);
+    vector<uint32_t> unsatisfied;
+    for (uint32_t i = 1; i <= maxIterations; i++) {
+      ldpc.setDecodeIterations(i);
+      unsatisfied.push_back(ldpc.decode(received, snrEstimate, decoded));
+      if (unsatisfied.back() == 0)
+        break;
+    }
+
+    ldpc.setDecodeIterations(maxIterations);
+    for (uint32_t stallIterations = 1; stallIterations <= 4; stallIterations++) {
+      uint32_t expected = unsatisfied.size();
+      uint32_t best = unsatisfied[0], stalled = 0;
+      for (uint32_t i = 1; i < unsatisfied.size(); i++) {
+        if (unsatisfied[i] < best) {
+          best = unsatisfied[i];
+          stalled = 0;
+        }
+        else if (++stalled == stallIterations) {
+          expected = i + 1;
+          break;
+        }
+      }
+      if (stallIterations == 1) {
+        EXPECT_LT(expected, maxIterations) << "algorithm " << a;
+      }
+
+      ldpc.setStallIterations(stallIterations);
+      EXPECT_EQ(ldpc.getStallIterations(), stallIterations);
+      EXPECT_EQ(ldpc.decode(received, snrEstimate, decoded), unsatisfied[expected - 1])
+          << "algorithm " << a << " stall iterations " << stallIterations;
+      EXPECT_EQ(ldpc.getAverageIterations(), (double) expected)
+          << "algorithm " << a << " stall iterations " << stallIterations;
+    }
+  }
+}
+
+/*!
+ * @brief Test that the unsatisfied check count kept up to date by
+ * TannerGraph::flipSymbol is always the count from H x.
+ */
+TEST(ldpc, TannerGraphFlipSymbolMatchesSyndrome)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_3_4);
+  const Eigen::MatrixXi &H = ldpc.getParityMatrix();
+  uint32_t m = H.rows();
+  uint32_t n = H.cols();
+
+  // N and M as LDPCCode lays them out
+  Eigen::VectorXi numSymbolNodes = Eigen::VectorXi::Zero(m);
+  Eigen::VectorXi numCheckNodes = Eigen::VectorXi::Zero(n);
+  for (uint32_t i = 0; i < m; i++)
+    for (uint32_t j = 0; j < n; j++)
+      if (H(i, j)) {
+        numSymbolNodes[i]++;
+        numCheckNodes[j]++;
+      }
+  Eigen::MatrixXi N = Eigen::MatrixXi::Zero(m, numSymbolNodes.maxCoeff());
+  Eigen::MatrixXi M = Eigen::MatrixXi::Zero(n, numCheckNodes.maxCoeff());
+  Eigen::VectorXi rowFill = Eigen::VectorXi::Zero(m);
+  Eigen::VectorXi columnFill = Eigen::VectorXi::Zero(n);
+  for (uint32_t i = 0; i < m; i++)
+    for (uint32_t j = 0; j < n; j++)
+      if (H(i, j)) {
+        N(i, rowFill[i]++) = j;
+        M(j, columnFill[j]++) = i;
+      }
+  TannerGraph graph(N, numSymbolNodes, M, numCheckNodes);
+  ASSERT_EQ(graph.numChecks(), m);
+  ASSERT_EQ(graph.numSymbols(), n);
+
+  mt19937 generator(8642);
+  vector<uint8_t> bits(n), syndrome(m), recount(m);
+  for (uint32_t i = 0; i < n; i++)
+    bits[i] = generator() & 0x01;
+  uint32_t unsatisfied = graph.syndrome(bits.data(), syndrome.data());
+  Eigen::VectorXi x(n);
+  for (uint32_t flip = 0; flip < 2000; flip++) {
+    uint32_t j = generator() % n;
+    bits[j] ^= 1;
+    graph.flipSymbol(j, syndrome.data(), unsatisfied);
+
+    for (uint32_t i = 0; i < n; i++)
+      x[i] = bits[i];
+    Eigen::VectorXi Hx = H * x;
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < m; i++) {
+      recount[i] = Hx[i] % 2;
+      expected += recount[i];
+    }
+    ASSERT_EQ(unsatisfied, expected) << "flip " << flip;
+    ASSERT_EQ(syndrome, recount) << "flip " << flip;
+  }
+}
+
+/*!
+ * @brief Test that the normalized and offset min-sum decoders recover the
+ * messages at an Eb/N0 where the code decodes, with both schedules and with
+ * the default and other correction factors.
+ */
+TEST(ldpc, MinSumDecodesMessages)
+{
+  LDPC ldpc(false, ErrorCorrection::ErrorCorrectionScheme::IEEE_802_11N_QCLDPC_648_R_1_2);
+  const uint32_t numCodewords = 16;
+  float snrEstimate;
+  PPDU_u8::payload_t messages;
+  PPDU_f::payload_t received = noisyCodewords(ldpc, numCodewords, 4.0f, snrEstimate, &messages);
+
+  const LDPC::DecodeAlgorithm minSum[] = {
+    LDPC::DecodeAlgorithm::NORMALIZED_MIN_SUM,
+    LDPC::DecodeAlgorithm::OFFSET_MIN_SUM
+  };
+  const LDPC::DecodeSchedule bothSchedules[] = {
+    LDPC::DecodeSchedule::FLOODING,
+    LDPC::DecodeSchedule::LAYERED
+  };
+  const float corrections[][2] = {
+    { LDPC::MIN_SUM_NORMALIZATION_DEFAULT, LDPC::MIN_SUM_OFFSET_DEFAULT },
+    { 0.875f, 0.25f },
+    { 1.0f, 0.0f }
+  };
+  for (LDPC::DecodeAlgorithm algorithm : minSum)
+    for (LDPC::DecodeSchedule schedule : bothSchedules)
+      for (const float *correction : corrections) {
+        ldpc.setDecodeAlgorithm(algorithm);
+        ldpc.setDecodeSchedule(schedule);
+        ldpc.setMinSumCorrection(correction[0], correction[1]);
+        PPDU_u8::payload_t decoded;
+        EXPECT_EQ(ldpc.decode(received, snrEstimate, decoded), 0u)
+            << "algorithm " << (int) algorithm << " schedule " << (int) schedule
+            << " normalization " << correction[0] << " offset " << correction[1];
+        EXPECT_EQ(decoded, messages)
+            << "algorithm " << (int) algorithm << " schedule " << (int) schedule
+            << " normalization " << correction[0] << " offset " << correction[1];
+      }
+
+  EXPECT_THROW(ldpc.setMinSumCorrection(0.0f, 0.5f), exception);
+  EXPECT_THROW(ldpc.setMinSumCorrection(1.5f, 0.5f), exception);
+  EXPECT_THROW(ldpc.setMinSumCorrection(0.75f, -0.5f), exception);
+}